@@ -13,50 +13,23 @@
 #include <array>
 
 namespace mcvk::Renderer {
-    CommandBuffer::CommandBuffer(const Device &device, const std::unique_ptr<Swapchain> &swapchain)
-        : _device{device}, _swapchain{swapchain} {
+    CommandBuffer::CommandBuffer(const Device &device, const std::unique_ptr<RenderTarget> &target)
+        : _device{device}, _target{target} {
     }
 
     CommandBuffer::~CommandBuffer() {
         vkFreeCommandBuffers(_device.GetDevice(), _device.GetGraphicsCommandPool(), 1, &_cb);
-    }
-
-    VkCommandBuffer CommandBuffer::BeginOneTimeSubmit(const Device &device, VkCommandPool command_pool) {
-        VkCommandBufferAllocateInfo alloc_info{};
-        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        alloc_info.commandPool = command_pool;
-        alloc_info.commandBufferCount = 1;
-
-        VkCommandBuffer cb;
-        if (vkAllocateCommandBuffers(device.GetDevice(), &alloc_info, &cb) != VK_SUCCESS) {
-            Utils::Fatal("Failed to allocate memory transfer command buffer");
+        if (_acquire_cb != VK_NULL_HANDLE) {
+            vkFreeCommandBuffers(_device.GetDevice(), _device.GetGraphicsCommandPool(), 1, &_acquire_cb);
         }
-
-        VkCommandBufferBeginInfo begin_info{};
-        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        if (vkBeginCommandBuffer(cb, &begin_info) != VK_SUCCESS) {
-            Utils::Fatal("Failed to begin recording to one-time-submit command buffer");
-        }
-        return cb;
     }
 
-    void CommandBuffer::EndOneTimeSubmit(const Device &device, VkCommandPool command_pool, VkQueue queue, VkCommandBuffer cmdbuf) {
-        if (vkEndCommandBuffer(cmdbuf) != VK_SUCCESS) {
-            Utils::Fatal("Failed to record one-time-submit command buffer");
-        }
-
-        VkSubmitInfo submit_info{};
-        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers = &cmdbuf;
-
-        vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE);
-        vkQueueWaitIdle(queue);
+    VkCommandBuffer CommandBuffer::BeginOneTimeSubmit(TransientCommandPool &pool) {
+        return pool.Begin();
+    }
 
-        vkFreeCommandBuffers(device.GetDevice(), command_pool, 1, &cmdbuf);
+    TransientCommandPool::Ticket CommandBuffer::EndOneTimeSubmit(TransientCommandPool &pool, VkCommandBuffer cmdbuf) {
+        return pool.Submit(cmdbuf);
     }
 
     void CommandBuffer::End() {
@@ -65,14 +38,42 @@ namespace mcvk::Renderer {
             return;
         }
 
+        _target->RecordUpscale(_cb, _current_image_index);
+
         if (vkEndCommandBuffer(_cb) != VK_SUCCESS) {
             Utils::Fatal("Failed to record command buffer");
         }
 
-        VkResult submit = _swapchain->SubmitCommandBuffers({ _cb }, &_current_image_index);
-        if (submit == VK_ERROR_OUT_OF_DATE_KHR || submit == VK_SUBOPTIMAL_KHR || _renderer->_window.WasResized()) {
+        // submit this frame's batch of staged uploads and make the draw wait on it (and any earlier batches not yet waited on)
+        UploadScheduler &uploads = _device.GetUploadScheduler();
+        uploads.EndFrame();
+
+        std::vector<VkCommandBuffer> cmdbufs = { _cb };
+        std::vector<VkSemaphore> upload_sems;
+        if (_acquire_cb != VK_NULL_HANDLE) {
+            // ownership of uploaded resources is acquired in the same submission that waits on the uploads, ahead of the draws
+            VkCommandBufferBeginInfo begin_info{};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            if (vkBeginCommandBuffer(_acquire_cb, &begin_info) != VK_SUCCESS) {
+                Utils::Fatal("Failed to begin recording to ownership acquire command buffer");
+            }
+
+            upload_sems = uploads.TakeWaitSemaphores(_target->GetCurrentFrame(), _acquire_cb);
+
+            if (vkEndCommandBuffer(_acquire_cb) != VK_SUCCESS) {
+                Utils::Fatal("Failed to record ownership acquire command buffer");
+            }
+            if (!upload_sems.empty()) {
+                cmdbufs.insert(cmdbufs.begin(), _acquire_cb);
+            }
+        } else {
+            upload_sems = uploads.TakeWaitSemaphores(_target->GetCurrentFrame());
+        }
+
+        VkResult submit = _target->SubmitCommandBuffers(cmdbufs, upload_sems, &_current_image_index);
+        if (submit == VK_ERROR_OUT_OF_DATE_KHR || submit == VK_SUBOPTIMAL_KHR || _renderer->_WasResized()) {
             _renderer->_RecreateSwapchain();
-            _renderer->_window.CompleteResize();
         } else if (submit != VK_SUCCESS) {
             Utils::Fatal("Failed to present swap chain image");
         }
@@ -83,10 +84,10 @@ namespace mcvk::Renderer {
     void CommandBuffer::BeginRenderPass(VkClearColorValue clear_col) {
         VkRenderPassBeginInfo info{};
         info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        info.renderPass = _swapchain->GetRenderPass();
-        info.framebuffer = _swapchain->GetFramebuffer(_current_image_index);
+        info.renderPass = _target->GetFrameRenderPass();
+        info.framebuffer = _target->GetFramebuffer(_current_image_index);
 
-        info.renderArea.extent = _swapchain->GetExtent();
+        info.renderArea.extent = _target->GetRenderExtent();
         info.renderArea.offset = { 0, 0 };
 
         std::array<VkClearValue, 2> clear{};
@@ -103,7 +104,12 @@ namespace mcvk::Renderer {
     }
 
     void CommandBuffer::BindPipeline(const GraphicsPipeline &pipeline) {
+        if (pipeline.GetPipeline() == _bound_pipeline) {
+            return;
+        }
+
         vkCmdBindPipeline(_cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.GetPipeline());
+        _bound_pipeline = pipeline.GetPipeline();
     }
 
     void CommandBuffer::BindVertexBuffer(const VertexBuffer &buffer) {
@@ -119,6 +125,12 @@ namespace mcvk::Renderer {
         const std::vector<uint32_t> &dynoffsets) {
         VkPipelineLayout layout = pipeline.GetPipelineLayout();
 
+        // layouts come from the layout cache, so pipelines with matching interfaces share one and switching between them leaves
+        // their sets bound
+        if (layout == _bound_layout && sets == _bound_sets && dynoffsets == _bound_offsets) {
+            return;
+        }
+
         vkCmdBindDescriptorSets(
             _cb,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -128,6 +140,10 @@ namespace mcvk::Renderer {
             sets.data(),
             static_cast<uint32_t>(dynoffsets.size()),
             dynoffsets.data());
+
+        _bound_layout = layout;
+        _bound_sets = sets;
+        _bound_offsets = dynoffsets;
     }
 
     void CommandBuffer::Draw(uint32_t vertex_count) {
@@ -139,7 +155,7 @@ namespace mcvk::Renderer {
     }
 
     void CommandBuffer::UpdateViewportAndScissor() {
-        VkExtent2D extent = _swapchain->GetExtent();
+        VkExtent2D extent = _target->GetRenderExtent();
 
         VkViewport viewport{};
         viewport.x = 0.0f;
@@ -168,6 +184,12 @@ namespace mcvk::Renderer {
         if (vkAllocateCommandBuffers(_device.GetDevice(), &info, &_cb) != VK_SUCCESS) {
             Utils::Fatal("Failed to allocate command buffers");
         }
+
+        if (_device.GetUploadScheduler().TransfersOwnership()) {
+            if (vkAllocateCommandBuffers(_device.GetDevice(), &info, &_acquire_cb) != VK_SUCCESS) {
+                Utils::Fatal("Failed to allocate ownership acquire command buffer");
+            }
+        }
     }
 
     bool CommandBuffer::_Begin() {
@@ -176,10 +198,13 @@ namespace mcvk::Renderer {
             return false;
         }
 
-        VkResult acquire = _swapchain->AcquireNextImage(&_current_image_index);
-        if (acquire == VK_ERROR_OUT_OF_DATE_KHR || _renderer->_window.WasResized()) {
+        VkResult acquire = _target->AcquireNextImage(&_current_image_index);
+
+        // this frame slot's fence has been waited on, so the upload semaphores its last submission waited on can be reused
+        _device.GetUploadScheduler().ReleaseWaitSemaphores(_target->GetCurrentFrame());
+
+        if (acquire == VK_ERROR_OUT_OF_DATE_KHR || _renderer->_WasResized()) {
             _renderer->_RecreateSwapchain();
-            _renderer->_window.CompleteResize();
             return false;
         }
         if (acquire != VK_SUCCESS && acquire != VK_SUBOPTIMAL_KHR) {
@@ -195,6 +220,12 @@ namespace mcvk::Renderer {
             Utils::Fatal("Failed to begin recording to command buffer");
         }
 
+        // nothing is bound at the start of a recording
+        _bound_pipeline = VK_NULL_HANDLE;
+        _bound_layout = VK_NULL_HANDLE;
+        _bound_sets.clear();
+        _bound_offsets.clear();
+
         return true;
     }
 }
@@ -10,7 +10,7 @@
 #include "renderer/pipeline/graphics_pipeline.hpp"
 #include "renderer/resource/buffer.hpp"
 #include "renderer/device.hpp"
-#include "renderer/swapchain.hpp"
+#include "renderer/render_target.hpp"
 
 #include <volk/volk.h>
 
@@ -21,20 +21,22 @@ namespace mcvk::Renderer {
 
     class CommandBuffer {
     public:
-        CommandBuffer(const Device &device, const std::unique_ptr<Swapchain> &swapchain);
+        CommandBuffer(const Device &device, const std::unique_ptr<RenderTarget> &target);
         ~CommandBuffer();
 
         CommandBuffer(const CommandBuffer &) = delete;
         CommandBuffer &operator=(const CommandBuffer &) = delete;
 
-        static VkCommandBuffer BeginOneTimeSubmit(const Device &device, VkCommandPool command_pool);
-        static void EndOneTimeSubmit(const Device &device, VkCommandPool command_pool, VkQueue queue, VkCommandBuffer cmdbuf);
+        // record one-shot work into a recycled command buffer; the returned ticket can be waited on via the same pool
+        static VkCommandBuffer BeginOneTimeSubmit(TransientCommandPool &pool);
+        static TransientCommandPool::Ticket EndOneTimeSubmit(TransientCommandPool &pool, VkCommandBuffer cmdbuf);
 
         void End();
 
         void BeginRenderPass(VkClearColorValue clear_col = {0});
         void EndRenderPass();
 
+        // redundant binds (of what is already bound in this recording) are skipped
         void BindPipeline(const GraphicsPipeline &pipeline);
         void BindVertexBuffer(const VertexBuffer &buffer);
         void BindIndexBuffer(const IndexBuffer &buffer);
@@ -53,12 +55,20 @@ namespace mcvk::Renderer {
         bool _Begin();
 
         const Device &_device;
-        const std::unique_ptr<Swapchain> &_swapchain;
+        const std::unique_ptr<RenderTarget> &_target;
         Renderer *_renderer{nullptr};
 
         VkCommandBuffer _cb;
+        // records queue ownership acquires for uploaded resources, submitted ahead of _cb; only used if the upload scheduler
+        // transfers ownership
+        VkCommandBuffer _acquire_cb{VK_NULL_HANDLE};
 
         uint32_t _current_image_index{0};
         bool _frame_started{false};
+
+        VkPipeline _bound_pipeline{VK_NULL_HANDLE};
+        VkPipelineLayout _bound_layout{VK_NULL_HANDLE};
+        std::vector<VkDescriptorSet> _bound_sets;
+        std::vector<uint32_t> _bound_offsets;
     };
 }
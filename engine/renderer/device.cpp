@@ -14,26 +14,62 @@
 #include <set>
 
 namespace mcvk::Renderer {
-    Device::Device(const Window &window, const VkInstance &instance, const VkSurfaceKHR &surface)
-        : _window{window}, _instance{instance}, _surface(surface) {
+    Device::Device(const VkInstance &instance, const VkSurfaceKHR &surface, bool properties2)
+        : _instance{instance}, _surface(surface), _properties2{properties2} {
         _PickPhysicalDevice();
         _CreateLogicalDevice();
         _CreateCommandPools();
+
+        _graphics_transient_pool = std::make_unique<TransientCommandPool>(*this, _queue_families.graphics.value(), _graphics_queue);
+        _transfer_transient_pool = std::make_unique<TransientCommandPool>(*this, _queue_families.transfer.value(), _transfer_queue);
+
+        _memory_budget = std::make_unique<MemoryBudget>(*this, _memory_budget_enabled);
+        _allocator = std::make_unique<MemoryAllocator>(*this);
+        _upload_scheduler = std::make_unique<UploadScheduler>(*this, UploadScheduler::Config::Defaults());
+        _deletion_queue = std::make_unique<DeletionQueue>(*this);
+        _sampler_cache = std::make_unique<SamplerCache>(*this);
+        _shader_module_cache = std::make_unique<ShaderModuleCache>(*this);
+        _layout_cache = std::make_unique<LayoutCache>(*this);
     }
 
     Device::~Device() {
+        // anything still queued for deletion may be waiting on an upload, and the upload scheduler frees staging memory as it
+        // drains, so both go before the allocator
+        // layouts hold references to the samplers baked into them, which are released through the deletion queue
+        _layout_cache.reset();
+        _deletion_queue.reset();
+        // samplers released by their last user have been destroyed by the deletion queue by now
+        _sampler_cache.reset();
+        _shader_module_cache.reset();
+        _upload_scheduler.reset();
+        _allocator.reset();
+        _memory_budget.reset();
+        _transfer_transient_pool.reset();
+        _graphics_transient_pool.reset();
+
         vkDestroyCommandPool(_device, _transfer_command_pool, nullptr);
         vkDestroyCommandPool(_device, _graphics_command_pool, nullptr);
         vkDestroyDevice(_device, nullptr);
     }
 
-    uint32_t Device::FindMemoryType(uint32_t filter, VkMemoryPropertyFlags properties) const {
-        VkPhysicalDeviceMemoryProperties mem_props;
-        vkGetPhysicalDeviceMemoryProperties(_physical_device, &mem_props);
+    std::unique_lock<std::mutex> Device::LockQueue(VkQueue queue) const {
+        return std::unique_lock<std::mutex>{*_queue_mutexes.at(queue)};
+    }
 
-        for (uint32_t i = 0; i < mem_props.memoryTypeCount; i++) {
+    void Device::WaitIdle() const {
+        // the map isn't changed after creation, so every caller locks in the same order
+        std::vector<std::unique_lock<std::mutex>> locks;
+        for (auto &[queue, mutex] : _queue_mutexes) {
+            locks.emplace_back(*mutex);
+        }
+
+        vkDeviceWaitIdle(_device);
+    }
+
+    uint32_t Device::FindMemoryType(uint32_t filter, VkMemoryPropertyFlags properties) const {
+        for (uint32_t i = 0; i < _memory_properties.memoryTypeCount; i++) {
             if ((filter & 1) == 1) {
-                if ((mem_props.memoryTypes[i].propertyFlags & properties) == properties) {
+                if ((_memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
                     return i;
                 }
             }
@@ -60,6 +96,22 @@ namespace mcvk::Renderer {
         return VK_FORMAT_UNDEFINED;
     }
 
+    bool Device::SupportsLinearBlit(VkFormat format) const {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(_physical_device, format, &props);
+
+        VkFormatFeatureFlags required =
+            VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (props.optimalTilingFeatures & required) == required;
+    }
+
+    bool Device::SupportsSampledImage(VkFormat format) const {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(_physical_device, format, &props);
+
+        return props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    }
+
     void Device::_PickPhysicalDevice() {
         uint32_t device_count = 0;
         vkEnumeratePhysicalDevices(_instance, &device_count, nullptr);
@@ -82,13 +134,14 @@ namespace mcvk::Renderer {
         }
 
         vkGetPhysicalDeviceProperties(_physical_device, &_properties);
+        vkGetPhysicalDeviceMemoryProperties(_physical_device, &_memory_properties);
 
         Utils::Info("Using physical device (GPU): \"" + std::string{_properties.deviceName} + "\"");
 
         Utils::Info(
             "Device manager found queue family indices for chosen physical device \"" + std::string{_properties.deviceName} + "\":\n" +
             "\tGraphics: " + std::to_string(_queue_families.graphics.value()) + "\n" +
-            "\tPresent:  " + std::to_string(_queue_families.present.value()) + "\n" +
+            "\tPresent:  " + (_queue_families.present ? std::to_string(_queue_families.present.value()) : "none") + "\n" +
             "\tCompute:  " + std::to_string(_queue_families.compute.value()) + "\n" +
             "\tTransfer: " + std::to_string(_queue_families.transfer.value())
         );
@@ -98,8 +151,10 @@ namespace mcvk::Renderer {
         std::vector<VkDeviceQueueCreateInfo> queue_infos;
         std::set<uint32_t> families = {
             _queue_families.graphics.value(),
-            _queue_families.present.value(),
             _queue_families.transfer.value() };
+        if (_queue_families.present) {
+            families.insert(_queue_families.present.value());
+        }
 
         float queue_priority = 1.0f;
         for (uint32_t fam : families) {
@@ -113,12 +168,25 @@ namespace mcvk::Renderer {
 
         VkPhysicalDeviceFeatures features = _GetRequiredDeviceFeatures();
 
+        // block-compressed textures are preferred, but uncompressed ones are used where BC formats aren't supported
+        VkPhysicalDeviceFeatures supported_features;
+        vkGetPhysicalDeviceFeatures(_physical_device, &supported_features);
+        features.textureCompressionBC = supported_features.textureCompressionBC;
+        _texture_compression_bc = supported_features.textureCompressionBC;
+
         VkDeviceCreateInfo device_info{};
         device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
         device_info.pEnabledFeatures = &features;
-        device_info.enabledExtensionCount = static_cast<uint32_t>(_extensions.size());
-        device_info.ppEnabledExtensionNames = _extensions.data();
+        // memory budgets are queried through vkGetPhysicalDeviceMemoryProperties2, so the instance extension is needed as well
+        std::vector<const char *> extensions = _GetRequiredExtensions();
+        if (_properties2 && _IsExtensionAvailable(_physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            _memory_budget_enabled = true;
+        }
+
+        device_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        device_info.ppEnabledExtensionNames = extensions.data();
         // deprecated and ignored
         device_info.enabledLayerCount = 0;
         device_info.ppEnabledLayerNames = nullptr;
@@ -135,8 +203,16 @@ namespace mcvk::Renderer {
 
         // get queue handles
         vkGetDeviceQueue(_device, _queue_families.graphics.value(), 0, &_graphics_queue);
-        vkGetDeviceQueue(_device, _queue_families.present.value(), 0, &_present_queue);
+        if (_queue_families.present) {
+            vkGetDeviceQueue(_device, _queue_families.present.value(), 0, &_present_queue);
+        }
         vkGetDeviceQueue(_device, _queue_families.transfer.value(), 0, &_transfer_queue);
+
+        for (VkQueue queue : { _graphics_queue, _present_queue, _transfer_queue }) {
+            if (queue != VK_NULL_HANDLE && !_queue_mutexes.contains(queue)) {
+                _queue_mutexes.emplace(queue, std::make_unique<std::mutex>());
+            }
+        }
     }
 
     void Device::_CreateCommandPools() {
@@ -164,8 +240,9 @@ namespace mcvk::Renderer {
 
         bool exts_supported = _CheckExtensionSupport(device);
 
-        bool swap_chain_adequate = false;
-        if (exts_supported) {
+        // nothing is presented without a surface
+        bool swap_chain_adequate = _surface == VK_NULL_HANDLE;
+        if (exts_supported && !swap_chain_adequate) {
             SwapChainSupportDetails swap_chain_support = _QuerySwapChainSupport(device);
             swap_chain_adequate = !swap_chain_support.surface_formats.empty() && !swap_chain_support.present_modes.empty();
         }
@@ -192,10 +269,10 @@ namespace mcvk::Renderer {
         _queue_families = indices;
 
         return
-            indices.isComplete() && // necessary queue families were found
-            exts_supported &&       // required extensions are supported
-            swap_chain_adequate &&  // swap chain support is good
-            features_supported;     // required devices features are supported
+            indices.isComplete(_surface != VK_NULL_HANDLE) && // necessary queue families were found
+            exts_supported &&                                 // required extensions are supported
+            swap_chain_adequate &&                            // swap chain support is good
+            features_supported;                               // required devices features are supported
     }
 
     QueueFamilyIndices Device::_FindQueueFamilies(VkPhysicalDevice device) const {
@@ -221,7 +298,9 @@ namespace mcvk::Renderer {
 
             // if present support
             VkBool32 supports_present = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &supports_present);
+            if (_surface != VK_NULL_HANDLE) {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &supports_present);
+            }
             if (fam.queueCount > 0 && supports_present) {
                 indices.present = i;
 
@@ -244,7 +323,7 @@ namespace mcvk::Renderer {
                 }
             }
 
-            if (indices.isComplete()) {
+            if (indices.isComplete(_surface != VK_NULL_HANDLE)) {
                 break;
             }
 
@@ -265,7 +344,8 @@ namespace mcvk::Renderer {
             &extension_count,
             available.data());
 
-        std::set<std::string> required(_extensions.begin(), _extensions.end());
+        std::vector<const char *> extensions = _GetRequiredExtensions();
+        std::set<std::string> required(extensions.begin(), extensions.end());
 
         for (const auto &extension : available) {
             required.erase(extension.extensionName);
@@ -274,6 +354,21 @@ namespace mcvk::Renderer {
         return required.empty();
     }
 
+    bool Device::_IsExtensionAvailable(VkPhysicalDevice device, const char *name) const {
+        uint32_t extension_count;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
+
+        std::vector<VkExtensionProperties> available(extension_count);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, available.data());
+
+        for (const auto &extension : available) {
+            if (std::string{extension.extensionName} == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     SwapChainSupportDetails Device::_QuerySwapChainSupport(VkPhysicalDevice device) const {
         SwapChainSupportDetails details;
         vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, _surface, &details.capabilities);
@@ -308,4 +403,12 @@ namespace mcvk::Renderer {
 
         return features;
     }
+
+    std::vector<const char *> Device::_GetRequiredExtensions() const {
+        std::vector<const char *> extensions = _extensions;
+        if (_surface != VK_NULL_HANDLE) {
+            extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
+        return extensions;
+    }
 }
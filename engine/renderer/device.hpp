@@ -7,9 +7,18 @@
 
 #pragma once
 
-#include "renderer/window.hpp"
-
+#include "renderer/memory/allocator.hpp"
+#include "renderer/memory/deletion_queue.hpp"
+#include "renderer/pipeline/layout_cache.hpp"
+#include "renderer/resource/sampler_cache.hpp"
+#include "renderer/resource/upload_scheduler.hpp"
+#include "renderer/shader_module_cache.hpp"
+#include "renderer/transient_command_pool.hpp"
+
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 namespace mcvk::Renderer {
@@ -25,12 +34,14 @@ namespace mcvk::Renderer {
         std::optional<uint32_t> compute;
         std::optional<uint32_t> transfer;
 
-        bool isComplete() { return graphics && present && compute && transfer; }
+        // present support is only needed when rendering to a surface
+        bool isComplete(bool needs_present = true) { return graphics && (present || !needs_present) && compute && transfer; }
     };
 
     class Device {
     public:
-        Device(const Window &window, const VkInstance &instance, const VkSurfaceKHR &_surface);
+        // the surface may be null when rendering offscreen, in which case present support and swapchains aren't required
+        Device(const VkInstance &instance, const VkSurfaceKHR &surface, bool properties2);
         ~Device();
 
         Device(const Device &) = delete;
@@ -39,17 +50,41 @@ namespace mcvk::Renderer {
         Device &operator=(Device &&) = delete;
 
         inline const VkDevice &GetDevice() const { return _device; }
+        inline const VkPhysicalDevice &GetPhysicalDevice() const { return _physical_device; }
         inline const VkPhysicalDeviceProperties &GetProperties() const { return _properties; }
+        inline const VkPhysicalDeviceMemoryProperties &GetMemoryProperties() const { return _memory_properties; }
+        inline MemoryAllocator &GetAllocator() const { return *_allocator; }
+        inline MemoryBudget &GetMemoryBudget() const { return *_memory_budget; }
+        inline UploadScheduler &GetUploadScheduler() const { return *_upload_scheduler; }
+        inline DeletionQueue &GetDeletionQueue() const { return *_deletion_queue; }
+        inline SamplerCache &GetSamplerCache() const { return *_sampler_cache; }
+        inline ShaderModuleCache &GetShaderModuleCache() const { return *_shader_module_cache; }
+        inline LayoutCache &GetLayoutCache() const { return *_layout_cache; }
         inline const VkCommandPool &GetGraphicsCommandPool() const { return _graphics_command_pool; }
         inline const VkCommandPool &GetTransferCommandPool() const { return _transfer_command_pool; }
+        // recycled command buffers for one-shot work on each queue
+        inline TransientCommandPool &GetGraphicsTransientPool() const { return *_graphics_transient_pool; }
+        inline TransientCommandPool &GetTransferTransientPool() const { return *_transfer_transient_pool; }
         inline const VkQueue &GetGraphicsQueue() const { return _graphics_queue; }
+        // null if there is no surface to present to
         inline const VkQueue &GetPresentQueue() const { return _present_queue; }
         inline const VkQueue &GetTransferQueue() const { return _transfer_queue; }
+        // queues need external synchronisation, and may be shared between roles (graphics, present, transfer), so every submit
+        // and present holds the queue's lock
+        [[nodiscard]] std::unique_lock<std::mutex> LockQueue(VkQueue queue) const;
+        // vkDeviceWaitIdle(), holding every queue's lock
+        void WaitIdle() const;
         inline SwapChainSupportDetails SwapchainSupportDetails() const { return _QuerySwapChainSupport(_physical_device); }
         inline QueueFamilyIndices FindQueueFamilyIndices() const { return _FindQueueFamilies(_physical_device); }
 
         uint32_t FindMemoryType(uint32_t filter, VkMemoryPropertyFlags properties) const;
         VkFormat FindSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features) const;
+        // true if optimal-tiling images of the format can be both source and destination of a linearly-filtered blit
+        bool SupportsLinearBlit(VkFormat format) const;
+        // true if optimal-tiling images of the format can be sampled
+        bool SupportsSampledImage(VkFormat format) const;
+        // true if BC texture formats were enabled (they are optional, so are only enabled where supported)
+        inline bool SupportsBlockCompression() const { return _texture_compression_bc; }
 
     private:
         void _PickPhysicalDevice();
@@ -59,28 +94,47 @@ namespace mcvk::Renderer {
         bool _CheckDeviceSuitable(VkPhysicalDevice device);
         QueueFamilyIndices _FindQueueFamilies(VkPhysicalDevice device) const;
         bool _CheckExtensionSupport(VkPhysicalDevice device) const;
+        bool _IsExtensionAvailable(VkPhysicalDevice device, const char *name) const;
         SwapChainSupportDetails _QuerySwapChainSupport(VkPhysicalDevice device) const;
         VkPhysicalDeviceFeatures _GetRequiredDeviceFeatures() const;
+        std::vector<const char *> _GetRequiredExtensions() const;
 
-        const Window &_window;
         const VkInstance &_instance;
         const VkSurfaceKHR &_surface;
 
         VkPhysicalDevice _physical_device;
         VkPhysicalDeviceProperties _properties;
+        VkPhysicalDeviceMemoryProperties _memory_properties;
 
         VkDevice _device;
         VkQueue _graphics_queue;
-        VkQueue _present_queue;
+        VkQueue _present_queue{VK_NULL_HANDLE};
         VkQueue _transfer_queue;
 
         QueueFamilyIndices _queue_families;
 
+        // one per distinct queue; filled in at creation and not changed after, so can be looked up without locking
+        std::unordered_map<VkQueue, std::unique_ptr<std::mutex>> _queue_mutexes;
+
+        bool _properties2;
+        bool _memory_budget_enabled{false};
+        bool _texture_compression_bc{false};
+
         VkCommandPool _graphics_command_pool;
         VkCommandPool _transfer_command_pool;
 
+        std::unique_ptr<MemoryBudget> _memory_budget;
+        std::unique_ptr<MemoryAllocator> _allocator;
+        std::unique_ptr<UploadScheduler> _upload_scheduler;
+        std::unique_ptr<DeletionQueue> _deletion_queue;
+        std::unique_ptr<SamplerCache> _sampler_cache;
+        std::unique_ptr<ShaderModuleCache> _shader_module_cache;
+        std::unique_ptr<LayoutCache> _layout_cache;
+        std::unique_ptr<TransientCommandPool> _graphics_transient_pool;
+        std::unique_ptr<TransientCommandPool> _transfer_transient_pool;
+
+        // VK_KHR_swapchain is also required if there is a surface
         const std::vector<const char *> _extensions = {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 #       ifdef APPLE
             "VK_KHR_portability_subset",
 #       endif
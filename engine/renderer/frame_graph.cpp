@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "frame_graph.hpp"
+
+#include "utils/log.hpp"
+
+#include <algorithm>
+
+namespace mcvk::Renderer {
+    // access bits that write memory, and so have to be made available before anything else touches it
+    static constexpr VkAccessFlags __WRITE_ACCESS =
+        VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+    FrameGraph::PassBuilder::PassBuilder(FrameGraph &graph, uint32_t pass)
+        : _graph{graph}, _pass{pass} {
+    }
+
+    FrameGraph::PassBuilder &FrameGraph::PassBuilder::Read(Resource resource, const ResourceState &state) {
+        _graph._AddAccess(_pass, resource, state, false);
+        return *this;
+    }
+
+    FrameGraph::PassBuilder &FrameGraph::PassBuilder::Write(Resource resource, const ResourceState &state) {
+        _graph._AddAccess(_pass, resource, state, true);
+        return *this;
+    }
+
+    FrameGraph::PassBuilder &FrameGraph::PassBuilder::SetSideEffects() {
+        _graph._passes[_pass].side_effects = true;
+        return *this;
+    }
+
+    FrameGraph::FrameGraph() {
+    }
+
+    FrameGraph::~FrameGraph() {
+    }
+
+    FrameGraph::Resource FrameGraph::ImportImage(VkImage image, const VkImageSubresourceRange &range, const ResourceState &initial) {
+        _Resource resource{};
+        resource.image = image;
+        resource.range = range;
+        resource.layout = initial.layout;
+
+        // treat whatever came before as the last write if it wrote, otherwise as reads the first write has to wait for
+        resource.write_access = initial.access & __WRITE_ACCESS;
+        if (resource.write_access) {
+            resource.write_stages = initial.stages;
+        } else {
+            resource.read_stages = initial.stages;
+        }
+
+        _resources.push_back(resource);
+        return static_cast<Resource>(_resources.size() - 1);
+    }
+
+    FrameGraph::Resource FrameGraph::ImportBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const ResourceState &initial) {
+        _Resource resource{};
+        resource.buffer = buffer;
+        resource.offset = offset;
+        resource.size = size;
+        resource.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        resource.write_access = initial.access & __WRITE_ACCESS;
+        if (resource.write_access) {
+            resource.write_stages = initial.stages;
+        } else {
+            resource.read_stages = initial.stages;
+        }
+
+        _resources.push_back(resource);
+        return static_cast<Resource>(_resources.size() - 1);
+    }
+
+    void FrameGraph::MarkOutput(Resource resource, const ResourceState &final_state) {
+        if (resource >= _resources.size()) {
+            Utils::Error("Attempted to mark unknown frame graph resource " + std::to_string(resource) + " as an output");
+            return;
+        }
+
+        _resources[resource].output = true;
+        _resources[resource].final_state = final_state;
+    }
+
+    FrameGraph::PassBuilder FrameGraph::AddPass(const std::string &name, ExecuteFn execute) {
+        _passes.push_back({ name, std::move(execute), {}, false });
+        return PassBuilder{*this, static_cast<uint32_t>(_passes.size() - 1)};
+    }
+
+    void FrameGraph::Execute(VkCommandBuffer cmdbuf) {
+        std::vector<bool> live = _Cull();
+
+        for (size_t i = 0; i < _passes.size(); i++) {
+            if (!live[i]) {
+                _stats.passes_culled++;
+                continue;
+            }
+
+            _Pass &pass = _passes[i];
+            for (const _Access &access : pass.accesses) {
+                _Transition(_resources[access.resource], access.state, access.write);
+            }
+            _FlushBarriers(cmdbuf);
+
+            if (pass.execute) {
+                pass.execute(cmdbuf);
+            }
+            _stats.passes_executed++;
+        }
+
+        for (_Resource &resource : _resources) {
+            if (resource.output) {
+                _Transition(resource, resource.final_state, false);
+            }
+        }
+        _FlushBarriers(cmdbuf);
+    }
+
+    void FrameGraph::Reset() {
+        _passes.clear();
+        _resources.clear();
+    }
+
+    void FrameGraph::_AddAccess(uint32_t pass, Resource resource, const ResourceState &state, bool write) {
+        _Pass &p = _passes[pass];
+        if (resource >= _resources.size()) {
+            Utils::Error("Frame graph pass \"" + p.name + "\" uses unknown resource " + std::to_string(resource));
+            return;
+        }
+
+        // a resource used more than once by a pass is synchronised once, for the union of its uses
+        auto existing = std::find_if(p.accesses.begin(), p.accesses.end(), [resource](const _Access &a) {
+            return a.resource == resource;
+        });
+        if (existing == p.accesses.end()) {
+            p.accesses.push_back({ resource, state, write });
+            return;
+        }
+
+        if (_resources[resource].image && existing->state.layout != state.layout) {
+            Utils::Error("Frame graph pass \"" + p.name + "\" uses an image in two different layouts; ignoring the second use");
+            return;
+        }
+        existing->state.stages |= state.stages;
+        existing->state.access |= state.access;
+        existing->write = existing->write || write;
+    }
+
+    std::vector<bool> FrameGraph::_Cull() const {
+        std::vector<bool> live(_passes.size(), false);
+
+        std::vector<bool> needed(_resources.size());
+        for (size_t i = 0; i < _resources.size(); i++) {
+            needed[i] = _resources[i].output;
+        }
+
+        // walking backwards, a pass is needed if it writes something a later needed pass (or an output) depends on
+        for (size_t i = _passes.size(); i-- > 0;) {
+            const _Pass &pass = _passes[i];
+
+            bool is_live = pass.side_effects || std::any_of(pass.accesses.begin(), pass.accesses.end(), [&needed](const _Access &a) {
+                return a.write && needed[a.resource];
+            });
+            if (!is_live) {
+                continue;
+            }
+
+            live[i] = true;
+            for (const _Access &access : pass.accesses) {
+                if (!access.write) {
+                    needed[access.resource] = true;
+                }
+            }
+        }
+
+        return live;
+    }
+
+    void FrameGraph::_Transition(_Resource &resource, const ResourceState &state, bool write) {
+        bool layout_change = resource.image && state.layout != resource.layout;
+
+        VkPipelineStageFlags src_stages = 0;
+        VkAccessFlags src_access = 0;
+        bool needs_barrier = false;
+
+        if (layout_change || write) {
+            // wait for the last write and every read since, though only the write needs making available
+            src_stages = resource.write_stages | resource.read_stages;
+            src_access = resource.write_access;
+            needs_barrier = layout_change || src_stages;
+        } else if (resource.write_stages && state.access &&
+            ((state.stages & ~resource.visible_stages) || (state.access & ~resource.visible_access))) {
+            // a read that hasn't yet been made to see the last write
+            src_stages = resource.write_stages;
+            src_access = resource.write_access;
+            needs_barrier = true;
+        }
+
+        if (needs_barrier) {
+            _batch.src_stages |= src_stages;
+            _batch.dst_stages |= state.stages;
+
+            // an execution dependency suffices if there is nothing to make available and the layout is unchanged
+            if (layout_change || src_access) {
+                if (resource.image) {
+                    VkImageMemoryBarrier barrier{};
+                    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                    barrier.srcAccessMask = src_access;
+                    barrier.dstAccessMask = state.access;
+                    barrier.oldLayout = resource.layout;
+                    barrier.newLayout = state.layout;
+                    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    barrier.image = resource.image;
+                    barrier.subresourceRange = resource.range;
+                    _batch.images.push_back(barrier);
+                } else {
+                    VkBufferMemoryBarrier barrier{};
+                    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                    barrier.srcAccessMask = src_access;
+                    barrier.dstAccessMask = state.access;
+                    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    barrier.buffer = resource.buffer;
+                    barrier.offset = resource.offset;
+                    barrier.size = resource.size;
+                    _batch.buffers.push_back(barrier);
+                }
+            }
+        }
+
+        if (resource.image) {
+            resource.layout = state.layout;
+        }
+
+        if (write) {
+            resource.write_stages = state.stages;
+            resource.write_access = state.access & __WRITE_ACCESS;
+            resource.read_stages = 0;
+            resource.visible_stages = 0;
+            resource.visible_access = 0;
+        } else if (layout_change) {
+            // the transition itself is now the last write; later reads in other stages have to wait for it
+            resource.write_stages = state.stages;
+            resource.write_access = 0;
+            resource.read_stages = state.stages;
+            resource.visible_stages = state.stages;
+            resource.visible_access = state.access;
+        } else {
+            resource.read_stages |= state.stages;
+            if (needs_barrier) {
+                resource.visible_stages |= state.stages;
+                resource.visible_access |= state.access;
+            }
+        }
+    }
+
+    void FrameGraph::_FlushBarriers(VkCommandBuffer cmdbuf) {
+        if (!_batch.src_stages && !_batch.dst_stages && _batch.images.empty() && _batch.buffers.empty()) {
+            return;
+        }
+
+        // layout transitions of resources nothing has touched yet have nothing to wait for
+        VkPipelineStageFlags src_stages = _batch.src_stages ? _batch.src_stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        VkPipelineStageFlags dst_stages = _batch.dst_stages ? _batch.dst_stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+        vkCmdPipelineBarrier(cmdbuf, src_stages, dst_stages, 0, 0, nullptr,
+            static_cast<uint32_t>(_batch.buffers.size()), _batch.buffers.data(),
+            static_cast<uint32_t>(_batch.images.size()), _batch.images.data());
+
+        _stats.barrier_batches++;
+        _stats.image_barriers += static_cast<uint32_t>(_batch.images.size());
+        _stats.buffer_barriers += static_cast<uint32_t>(_batch.buffers.size());
+
+        _batch.src_stages = 0;
+        _batch.dst_stages = 0;
+        _batch.images.clear();
+        _batch.buffers.clear();
+    }
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <volk/volk.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace mcvk::Renderer {
+    // Records a frame (or part of one) as an ordered list of passes, each declaring which images and buffers it reads and writes
+    // and in what state. When executed, passes that contribute nothing to an output are culled, and the state of every resource
+    // is tracked from pass to pass so that only the barriers that are actually needed are derived - read-after-read needs none,
+    // write-after-read only an execution dependency. All of the barriers a pass needs are merged into one vkCmdPipelineBarrier
+    // call recorded just before it.
+    //
+    // Resources are imported rather than owned, along with the state the last user outside the graph left them in. A graph is
+    // cheap to build; Reset() lets one be reused each frame without reallocating.
+    class FrameGraph {
+    public:
+        using Resource = uint32_t;
+
+        // how a resource is used; layout is ignored for buffers
+        struct ResourceState {
+            VkPipelineStageFlags stages;
+            VkAccessFlags access;
+            VkImageLayout layout;
+        };
+
+        struct Stats {
+            uint32_t passes_executed{0};
+            uint32_t passes_culled{0};
+            uint32_t barrier_batches{0};
+            uint32_t image_barriers{0};
+            uint32_t buffer_barriers{0};
+        };
+
+        using ExecuteFn = std::function<void(VkCommandBuffer)>;
+
+        // declares a pass's resource usage; returned by AddPass()
+        class PassBuilder {
+        public:
+            PassBuilder &Read(Resource resource, const ResourceState &state);
+            PassBuilder &Write(Resource resource, const ResourceState &state);
+            // never cull the pass, e.g. because its results leave the graph some other way
+            PassBuilder &SetSideEffects();
+
+        private:
+            friend class FrameGraph;
+
+            PassBuilder(FrameGraph &graph, uint32_t pass);
+
+            FrameGraph &_graph;
+            uint32_t _pass;
+        };
+
+        FrameGraph();
+        ~FrameGraph();
+
+        // initial is the state the resource was last used in before the graph, which the first barrier waits on
+        Resource ImportImage(VkImage image, const VkImageSubresourceRange &range, const ResourceState &initial);
+        Resource ImportBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const ResourceState &initial);
+        // the resource's contents are needed after the graph, in the given state; passes writing it (directly or otherwise) are
+        // kept, and it is transitioned into final_state once they have all run
+        void MarkOutput(Resource resource, const ResourceState &final_state);
+
+        // passes run in the order they are added
+        PassBuilder AddPass(const std::string &name, ExecuteFn execute);
+
+        // cull passes, then record every remaining pass along with its barriers, and any final transitions for outputs
+        void Execute(VkCommandBuffer cmdbuf);
+
+        // forget all passes and resources, keeping allocations
+        void Reset();
+
+        // accumulated over every Execute() since the graph was created
+        inline const Stats &GetStats() const { return _stats; }
+
+    private:
+        struct _Access {
+            Resource resource;
+            ResourceState state;
+            bool write;
+        };
+
+        struct _Pass {
+            std::string name;
+            ExecuteFn execute;
+            std::vector<_Access> accesses;
+            bool side_effects;
+        };
+
+        struct _Resource {
+            VkImage image;
+            VkImageSubresourceRange range;
+            VkBuffer buffer;
+            VkDeviceSize offset;
+            VkDeviceSize size;
+
+            VkImageLayout layout;
+            // the last write (or layout transition) and the reads made since, which the next write must wait for
+            VkPipelineStageFlags write_stages;
+            VkAccessFlags write_access;
+            VkPipelineStageFlags read_stages;
+            // stages and accesses the last write has already been made visible to
+            VkPipelineStageFlags visible_stages;
+            VkAccessFlags visible_access;
+
+            bool output;
+            ResourceState final_state;
+        };
+
+        struct _BarrierBatch {
+            VkPipelineStageFlags src_stages{0};
+            VkPipelineStageFlags dst_stages{0};
+            std::vector<VkImageMemoryBarrier> images;
+            std::vector<VkBufferMemoryBarrier> buffers;
+        };
+
+        void _AddAccess(uint32_t pass, Resource resource, const ResourceState &state, bool write);
+        std::vector<bool> _Cull() const;
+        void _Transition(_Resource &resource, const ResourceState &state, bool write);
+        void _FlushBarriers(VkCommandBuffer cmdbuf);
+
+        std::vector<_Pass> _passes;
+        std::vector<_Resource> _resources;
+
+        _BarrierBatch _batch;
+
+        Stats _stats;
+    };
+}
@@ -9,6 +9,7 @@
 
 #include "utils/log.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <sstream>
 #include <unordered_set>
@@ -17,14 +18,18 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL __DebugCallback(VkDebugUtilsMessageSeverit
     const VkDebugUtilsMessengerCallbackDataEXT *data, void *user);
 
 namespace mcvk::Renderer {
-    InstanceManager::InstanceManager(const mcvk::Renderer::Window &window) {
-        _CreateInstance();
+    InstanceManager::InstanceManager(const mcvk::Renderer::Window *window) {
+        _CreateInstance(window);
         _CreateDebugMessenger();
-        _CreateSurface(window);
+        if (window) {
+            _CreateSurface(*window);
+        }
     }
 
     InstanceManager::~InstanceManager() {
-        vkDestroySurfaceKHR(_instance, _surface, nullptr);
+        if (_surface != VK_NULL_HANDLE) {
+            vkDestroySurfaceKHR(_instance, _surface, nullptr);
+        }
 
 #       ifdef DEBUG
             vkDestroyDebugUtilsMessengerEXT(_instance, _debug_messenger, nullptr);
@@ -33,7 +38,7 @@ namespace mcvk::Renderer {
         vkDestroyInstance(_instance, nullptr);
     }
 
-    void InstanceManager::_CreateInstance() {
+    void InstanceManager::_CreateInstance(bool windowed) {
         if (volkInitialize()) {
             Utils::Fatal("Failed to initialise Vulkan loader");
             return;
@@ -58,7 +63,16 @@ namespace mcvk::Renderer {
         instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
         instance_info.pApplicationInfo = &app_info;
 
-        std::vector<const char *> extensions = _GetRequiredExtensions();
+        std::vector<const char *> extensions = _GetRequiredExtensions(windowed);
+
+        // optional - only used to query extended device properties such as memory budgets
+        _properties2 = std::find_if(extensions.begin(), extensions.end(),
+            [](const char *e) { return !std::strcmp(e, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME); }) != extensions.end();
+        if (!_properties2 && _IsExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            _properties2 = true;
+        }
+
         if (!_CheckExtensionsSupport(extensions)) {
             Utils::Fatal("Missing required instance extension(s)");
             return;
@@ -109,8 +123,11 @@ namespace mcvk::Renderer {
         _surface = window.CreateSurface(_instance);
     }
 
-    std::vector<const char *> InstanceManager::_GetRequiredExtensions() {
-        std::vector<const char *> extensions = Window::GetGLFWRequiredExtensions();
+    std::vector<const char *> InstanceManager::_GetRequiredExtensions(bool windowed) {
+        std::vector<const char *> extensions;
+        if (windowed) {
+            extensions = Window::GetGLFWRequiredExtensions();
+        }
 
 #       ifdef DEBUG
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -153,6 +170,20 @@ namespace mcvk::Renderer {
         return true;
     }
 
+    bool InstanceManager::_IsExtensionAvailable(const char *name) {
+        uint32_t extension_count = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
+        std::vector<VkExtensionProperties> extensions(extension_count);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extensions.data());
+
+        for (const auto &ext : extensions) {
+            if (!std::strcmp(ext.extensionName, name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     bool InstanceManager::_CheckValidationLayerSupport() {
 #       ifdef DEBUG
             uint32_t layer_count;
@@ -16,7 +16,8 @@
 namespace mcvk::Renderer {
     class InstanceManager {
     public:
-        InstanceManager(const Window &window);
+        // without a window (i.e. when rendering offscreen), no surface is created and GLFW's extensions aren't required
+        InstanceManager(const Window *window);
         ~InstanceManager();
 
         InstanceManager(const InstanceManager &) = delete;
@@ -24,19 +25,24 @@ namespace mcvk::Renderer {
 
         const VkInstance &GetInstance() const { return _instance; }
         const VkSurfaceKHR &GetSurface() const { return _surface; }
+        // true if VK_KHR_get_physical_device_properties2 is enabled, which device extensions like VK_EXT_memory_budget need
+        bool HasPhysicalDeviceProperties2() const { return _properties2; }
 
     private:
-        void _CreateInstance();
+        void _CreateInstance(bool windowed);
         void _CreateDebugMessenger();
         void _CreateSurface(const Window &window);
 
-        std::vector<const char *> _GetRequiredExtensions();
+        std::vector<const char *> _GetRequiredExtensions(bool windowed);
         bool _CheckExtensionsSupport(const std::vector<const char *> &required);
+        bool _IsExtensionAvailable(const char *name);
         bool _CheckValidationLayerSupport();
         void _PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &create_info);
 
         VkInstance _instance;
-        VkSurfaceKHR _surface;
+        VkSurfaceKHR _surface{VK_NULL_HANDLE};
+
+        bool _properties2{false};
 
 #       ifdef DEBUG
             VkDebugUtilsMessengerEXT _debug_messenger;
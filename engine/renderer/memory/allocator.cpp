@@ -0,0 +1,514 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "allocator.hpp"
+
+#include "renderer/device.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace mcvk::Renderer {
+    MemoryAllocator::MemoryAllocator(const Device &device)
+        : _device{device} {
+        _memory_properties = _device.GetMemoryProperties();
+
+        const VkPhysicalDeviceLimits &limits = _device.GetProperties().limits;
+        _non_coherent_atom_size = limits.nonCoherentAtomSize;
+        _separate_linear = limits.bufferImageGranularity > 1;
+
+        _pools.resize(_memory_properties.memoryTypeCount * 2);
+        _dedicated.resize(_memory_properties.memoryTypeCount);
+
+        // empty blocks kept for reuse are the cheapest thing to give up when a heap goes over budget
+        _eviction_callback = _device.GetMemoryBudget().AddEvictionCallback([this](uint32_t heap, VkDeviceSize bytes) {
+            return _TrimEmptyBlocks(heap, bytes);
+        });
+    }
+
+    MemoryAllocator::~MemoryAllocator() {
+        _device.GetMemoryBudget().RemoveEvictionCallback(_eviction_callback);
+
+        uint32_t leaked = 0;
+        for (uint32_t i = 0; i < _pools.size(); i++) {
+            for (auto &block : _pools[i].blocks) {
+                leaked += block->metadata.GetAllocationCount();
+                _FreeDeviceMemory(block->memory, block->mapped);
+            }
+        }
+        for (const auto &ded : _dedicated) {
+            leaked += ded.count;
+        }
+
+        if (leaked > 0) {
+            Utils::Warn("Memory allocator destroyed with " + std::to_string(leaked) + " allocation(s) still live");
+        }
+    }
+
+    MemoryAllocation MemoryAllocator::Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear,
+        MemoryCategory category) {
+        MemoryBudget &budget = _device.GetMemoryBudget();
+        MemoryAllocation allocation{};
+
+        bool allocated;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            allocated = _Allocate(requirements, properties, linear, true, allocation);
+        }
+
+        if (!allocated) {
+            // over budget: ask for resources to be released (without the lock, as that will free memory) and then go over the
+            // budget for now, since evicted memory is generally only returned once the frames using it have completed
+            for (uint32_t type = 0; type < _memory_properties.memoryTypeCount; type++) {
+                if ((requirements.memoryTypeBits & (1u << type)) &&
+                    (_memory_properties.memoryTypes[type].propertyFlags & properties) == properties) {
+                    budget.Evict(_memory_properties.memoryTypes[type].heapIndex, requirements.size);
+                    break;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock{_mutex};
+            allocated = _Allocate(requirements, properties, linear, false, allocation);
+        }
+
+        if (!allocated) {
+            Utils::Fatal("Failed to allocate " + std::to_string(requirements.size) + " bytes of device memory");
+        }
+
+        allocation.category = category;
+        budget.TrackAllocation(category, allocation.size);
+        return allocation;
+    }
+
+    MemoryAllocation MemoryAllocator::AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, MemoryCategory category) {
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(_device.GetDevice(), buffer, &requirements);
+
+        MemoryAllocation allocation = Allocate(requirements, properties, true, category);
+
+        if (vkBindBufferMemory(_device.GetDevice(), buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            Utils::Fatal("Failed to bind buffer to device memory");
+        }
+        return allocation;
+    }
+
+    MemoryAllocation MemoryAllocator::AllocateForImage(VkImage image, VkMemoryPropertyFlags properties, MemoryCategory category) {
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(_device.GetDevice(), image, &requirements);
+
+        // lazily-allocated memory (for transient attachments) is a preference; most desktop devices don't have any
+        if ((properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) && !_HasMemoryType(requirements.memoryTypeBits, properties)) {
+            properties &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        }
+
+        MemoryAllocation allocation = Allocate(requirements, properties, false, category);
+
+        if (vkBindImageMemory(_device.GetDevice(), image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            Utils::Fatal("Failed to bind image to device memory");
+        }
+        return allocation;
+    }
+
+    bool MemoryAllocator::TryAllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, float max_heap_usage,
+        MemoryAllocation &allocation, MemoryCategory category) {
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(_device.GetDevice(), buffer, &requirements);
+
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+
+            bool found = false;
+            for (uint32_t type = 0; type < _memory_properties.memoryTypeCount && !found; type++) {
+                if (!(requirements.memoryTypeBits & (1u << type))) {
+                    continue;
+                }
+                if ((_memory_properties.memoryTypes[type].propertyFlags & properties) != properties) {
+                    continue;
+                }
+
+                uint32_t heap = _memory_properties.memoryTypes[type].heapIndex;
+                VkDeviceSize limit = static_cast<VkDeviceSize>(
+                    static_cast<double>(_memory_properties.memoryHeaps[heap].size) * max_heap_usage);
+                if (_GetHeapReservedBytes(heap) + requirements.size > limit) {
+                    continue;
+                }
+
+                if (!_TryAllocateFromType(type, requirements, true, true, allocation)) {
+                    continue;
+                }
+
+                // creating a new block may still have pushed the heap over the limit, in which case the block is released again
+                // rather than left taking up the heap
+                if (_GetHeapReservedBytes(heap) > limit) {
+                    _Free(allocation, false);
+                    continue;
+                }
+                found = true;
+            }
+
+            if (!found) {
+                return false;
+            }
+        }
+
+        allocation.category = category;
+        _device.GetMemoryBudget().TrackAllocation(category, allocation.size);
+
+        if (vkBindBufferMemory(_device.GetDevice(), buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            Utils::Fatal("Failed to bind buffer to device memory");
+        }
+        return true;
+    }
+
+    void MemoryAllocator::Free(MemoryAllocation &allocation) {
+        if (allocation.memory == VK_NULL_HANDLE) {
+            return;
+        }
+
+        _device.GetMemoryBudget().TrackFree(allocation.category, allocation.size);
+
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _Free(allocation);
+    }
+
+    void MemoryAllocator::_Free(MemoryAllocation &allocation, bool keep_empty_block) {
+        if (!allocation.block) {
+            _FreeDeviceMemory(allocation.memory, allocation.mapped);
+
+            _dedicated[allocation.memory_type].count--;
+            _dedicated[allocation.memory_type].bytes -= allocation.size;
+
+            allocation = {};
+            return;
+        }
+
+        MemoryBlock *block = allocation.block;
+        block->metadata.Free(allocation.handle);
+        allocation = {};
+
+        if (!block->metadata.IsEmpty()) {
+            return;
+        }
+
+        // keep a single empty block around per pool so that alloc/free churn at a block boundary doesn't hit the driver each time
+        for (bool linear : { true, false }) {
+            Pool &pool = _GetPool(block->memory_type, linear);
+
+            auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [&](const auto &b) { return b.get() == block; });
+            if (it == pool.blocks.end()) {
+                continue;
+            }
+
+            uint32_t empty = static_cast<uint32_t>(std::count_if(pool.blocks.begin(), pool.blocks.end(),
+                [](const auto &b) { return b->metadata.IsEmpty(); }));
+            if (empty > 1 || !keep_empty_block) {
+                _FreeDeviceMemory(block->memory, block->mapped);
+                pool.blocks.erase(it);
+            }
+            break;
+        }
+    }
+
+    void MemoryAllocator::Flush(const MemoryAllocation &allocation, VkDeviceSize size, VkDeviceSize offset) const {
+        if (_memory_properties.memoryTypes[allocation.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+            return;
+        }
+
+        VkMappedMemoryRange range = _GetMappedRange(allocation, size, offset);
+        if (vkFlushMappedMemoryRanges(_device.GetDevice(), 1, &range) != VK_SUCCESS) {
+            Utils::Fatal("Failed to flush host mapped device memory");
+        }
+    }
+
+    void MemoryAllocator::Invalidate(const MemoryAllocation &allocation, VkDeviceSize size, VkDeviceSize offset) const {
+        if (_memory_properties.memoryTypes[allocation.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+            return;
+        }
+
+        VkMappedMemoryRange range = _GetMappedRange(allocation, size, offset);
+        if (vkInvalidateMappedMemoryRanges(_device.GetDevice(), 1, &range) != VK_SUCCESS) {
+            Utils::Fatal("Failed to invalidate host mapped device memory");
+        }
+    }
+
+    std::vector<MemoryAllocator::HeapStats> MemoryAllocator::GetHeapStats() const {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        std::vector<HeapStats> stats(_memory_properties.memoryHeapCount);
+        for (uint32_t h = 0; h < stats.size(); h++) {
+            stats[h] = {};
+            stats[h].heap_size = _memory_properties.memoryHeaps[h].size;
+        }
+
+        std::vector<VkDeviceSize> free_bytes(stats.size(), 0);
+
+        for (uint32_t type = 0; type < _memory_properties.memoryTypeCount; type++) {
+            HeapStats &heap = stats[_memory_properties.memoryTypes[type].heapIndex];
+
+            for (uint32_t p = type * 2; p < type * 2 + 2; p++) {
+                for (const auto &block : _pools[p].blocks) {
+                    const TLSFMetadata &meta = block->metadata;
+
+                    heap.reserved_bytes += meta.GetSize();
+                    heap.used_bytes += meta.GetUsedSize();
+                    heap.block_count++;
+                    heap.allocation_count += meta.GetAllocationCount();
+                    heap.free_region_count += meta.GetFreeRegionCount();
+                    heap.largest_free_region = std::max(heap.largest_free_region, meta.GetLargestFreeRegion());
+
+                    free_bytes[_memory_properties.memoryTypes[type].heapIndex] += meta.GetSize() - meta.GetUsedSize();
+                }
+            }
+
+            heap.reserved_bytes += _dedicated[type].bytes;
+            heap.used_bytes += _dedicated[type].bytes;
+            heap.dedicated_count += _dedicated[type].count;
+            heap.allocation_count += _dedicated[type].count;
+        }
+
+        for (uint32_t h = 0; h < stats.size(); h++) {
+            stats[h].fragmentation = (free_bytes[h] > 0)
+                ? 1.0f - static_cast<float>(stats[h].largest_free_region) / static_cast<float>(free_bytes[h])
+                : 0.0f;
+        }
+
+        return stats;
+    }
+
+    void MemoryAllocator::LogStats() const {
+        std::vector<HeapStats> stats = GetHeapStats();
+
+        std::stringstream stream{};
+        stream << "Device memory allocator statistics (" << _device_allocation_count << " of "
+            << _device.GetProperties().limits.maxMemoryAllocationCount << " driver allocations in use):";
+
+        for (uint32_t h = 0; h < stats.size(); h++) {
+            const HeapStats &s = stats[h];
+            if (s.reserved_bytes == 0) {
+                continue;
+            }
+
+            stream << std::endl << "\tHeap " << h << ": "
+                << (s.used_bytes / 1024) << " KiB used / " << (s.reserved_bytes / 1024) << " KiB reserved / "
+                << (s.heap_size / (1024 * 1024)) << " MiB heap, "
+                << s.allocation_count << " allocation(s) in " << s.block_count << " block(s) + " << s.dedicated_count << " dedicated, "
+                << s.free_region_count << " free region(s), fragmentation " << static_cast<int>(s.fragmentation * 100.0f) << "%";
+        }
+
+        Utils::Info(stream.str());
+    }
+
+    bool MemoryAllocator::_HasMemoryType(uint32_t type_bits, VkMemoryPropertyFlags properties) const {
+        for (uint32_t type = 0; type < _memory_properties.memoryTypeCount; type++) {
+            if ((type_bits & (1u << type)) && (_memory_properties.memoryTypes[type].propertyFlags & properties) == properties) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool MemoryAllocator::_Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear,
+        bool within_budget, MemoryAllocation &allocation) {
+        // try each compatible memory type in order, falling through to the next if one is exhausted
+        for (uint32_t type = 0; type < _memory_properties.memoryTypeCount; type++) {
+            if (!(requirements.memoryTypeBits & (1u << type))) {
+                continue;
+            }
+            if ((_memory_properties.memoryTypes[type].propertyFlags & properties) != properties) {
+                continue;
+            }
+
+            if (_TryAllocateFromType(type, requirements, linear, within_budget, allocation)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool MemoryAllocator::_TryAllocateFromType(uint32_t type, const VkMemoryRequirements &requirements, bool linear,
+        bool within_budget, MemoryAllocation &allocation) {
+        VkDeviceSize block_size = _GetBlockSize(type);
+
+        // large resources get their own device memory rather than monopolising most of a block
+        if (requirements.size > block_size / 2) {
+            VkDeviceMemory memory;
+            void *mapped;
+            if (!_AllocateDeviceMemory(type, requirements.size, within_budget, &memory, &mapped)) {
+                return false;
+            }
+
+            _dedicated[type].count++;
+            _dedicated[type].bytes += requirements.size;
+
+            allocation.memory = memory;
+            allocation.offset = 0;
+            allocation.size = requirements.size;
+            allocation.memory_type = type;
+            allocation.mapped = mapped;
+            allocation.block = nullptr;
+            allocation.handle = TLSFMetadata::NULL_HANDLE;
+            return true;
+        }
+
+        Pool &pool = _GetPool(type, linear);
+
+        auto suballocate = [&](MemoryBlock &block) {
+            uint64_t offset;
+            uint32_t handle = block.metadata.Allocate(requirements.size, requirements.alignment, &offset);
+            if (handle == TLSFMetadata::NULL_HANDLE) {
+                return false;
+            }
+
+            allocation.memory = block.memory;
+            allocation.offset = offset;
+            allocation.size = requirements.size;
+            allocation.memory_type = type;
+            allocation.mapped = (block.mapped) ? static_cast<char *>(block.mapped) + offset : nullptr;
+            allocation.block = &block;
+            allocation.handle = handle;
+            return true;
+        };
+
+        for (auto &block : pool.blocks) {
+            if (suballocate(*block)) {
+                return true;
+            }
+        }
+
+        // no existing block has room, so create another - if the driver refuses, retry with progressively smaller blocks
+        for (VkDeviceSize size = block_size; size >= requirements.size; size /= 2) {
+            VkDeviceMemory memory;
+            void *mapped;
+            if (!_AllocateDeviceMemory(type, size, within_budget, &memory, &mapped)) {
+                continue;
+            }
+
+            pool.blocks.push_back(std::make_unique<MemoryBlock>(MemoryBlock{ memory, type, mapped, TLSFMetadata{size} }));
+            return suballocate(*pool.blocks.back());
+        }
+
+        return false;
+    }
+
+    bool MemoryAllocator::_AllocateDeviceMemory(uint32_t type, VkDeviceSize size, bool within_budget, VkDeviceMemory *memory, void **mapped) {
+        uint32_t heap = _memory_properties.memoryTypes[type].heapIndex;
+        if (within_budget && !_device.GetMemoryBudget().Fits(heap, size, _GetHeapReservedBytes(heap))) {
+            return false;
+        }
+
+        VkMemoryAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = size;
+        alloc_info.memoryTypeIndex = type;
+        if (vkAllocateMemory(_device.GetDevice(), &alloc_info, nullptr, memory) != VK_SUCCESS) {
+            return false;
+        }
+
+        // host-visible memory is mapped once for its whole lifetime, since each VkDeviceMemory can only be mapped once at a time
+        *mapped = nullptr;
+        if (_memory_properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            if (vkMapMemory(_device.GetDevice(), *memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+                Utils::Fatal("Failed to map host-visible device memory block");
+            }
+        }
+
+        _device_allocation_count++;
+
+        Utils::Log("Allocated " + std::to_string(size / 1024) + " KiB of device memory from type " + std::to_string(type));
+        return true;
+    }
+
+    VkDeviceSize MemoryAllocator::_TrimEmptyBlocks(uint32_t heap, VkDeviceSize bytes) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        // empty blocks hold no resources, so their memory is returned straight away rather than through the deletion queue
+        VkDeviceSize released = 0;
+        for (uint32_t type = 0; type < _memory_properties.memoryTypeCount && released < bytes; type++) {
+            if (_memory_properties.memoryTypes[type].heapIndex != heap) {
+                continue;
+            }
+            for (bool linear : { true, false }) {
+                Pool &pool = _GetPool(type, linear);
+                std::erase_if(pool.blocks, [&](const auto &b) {
+                    if (released >= bytes || !b->metadata.IsEmpty()) {
+                        return false;
+                    }
+                    released += b->metadata.GetSize();
+                    _FreeDeviceMemory(b->memory, b->mapped);
+                    return true;
+                });
+            }
+        }
+
+        if (released > 0) {
+            Utils::Log("Released " + std::to_string(released / 1024) + " KiB of empty memory blocks from heap " + std::to_string(heap));
+        }
+        return released;
+    }
+
+    void MemoryAllocator::_FreeDeviceMemory(VkDeviceMemory memory, void *mapped) {
+        if (mapped) {
+            vkUnmapMemory(_device.GetDevice(), memory);
+        }
+        vkFreeMemory(_device.GetDevice(), memory, nullptr);
+
+        _device_allocation_count--;
+    }
+
+    MemoryAllocator::Pool &MemoryAllocator::_GetPool(uint32_t type, bool linear) {
+        return _pools[type * 2 + ((_separate_linear && linear) ? 1 : 0)];
+    }
+
+    VkDeviceSize MemoryAllocator::_GetBlockSize(uint32_t type) const {
+        VkDeviceSize heap_size = _memory_properties.memoryHeaps[_memory_properties.memoryTypes[type].heapIndex].size;
+
+        // small heaps (e.g. 256 MiB BAR windows) get proportionally smaller blocks so one block can't take a large share of them
+        if (heap_size <= 1024ull * 1024 * 1024) {
+            return std::min(_DEFAULT_BLOCK_SIZE, heap_size / 8);
+        }
+        return _DEFAULT_BLOCK_SIZE;
+    }
+
+    VkDeviceSize MemoryAllocator::_GetHeapReservedBytes(uint32_t heap) const {
+        VkDeviceSize reserved = 0;
+        for (uint32_t type = 0; type < _memory_properties.memoryTypeCount; type++) {
+            if (_memory_properties.memoryTypes[type].heapIndex != heap) {
+                continue;
+            }
+
+            for (uint32_t p = type * 2; p < type * 2 + 2; p++) {
+                for (const auto &block : _pools[p].blocks) {
+                    reserved += block->metadata.GetSize();
+                }
+            }
+            reserved += _dedicated[type].bytes;
+        }
+        return reserved;
+    }
+
+    VkMappedMemoryRange MemoryAllocator::_GetMappedRange(const MemoryAllocation &allocation, VkDeviceSize size,
+        VkDeviceSize offset) const {
+        VkDeviceSize memory_size = (allocation.block) ? allocation.block->metadata.GetSize() : allocation.size;
+
+        VkDeviceSize begin = allocation.offset + offset;
+        VkDeviceSize end = (size == VK_WHOLE_SIZE) ? allocation.offset + allocation.size : begin + size;
+
+        // ranges must be aligned to nonCoherentAtomSize (or reach the end of the memory object)
+        VkDeviceSize atom = std::max<VkDeviceSize>(_non_coherent_atom_size, 1);
+        begin = begin / atom * atom;
+        end = (end + atom - 1) / atom * atom;
+
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = allocation.memory;
+        range.offset = begin;
+        range.size = (end >= memory_size) ? VK_WHOLE_SIZE : end - begin;
+        return range;
+    }
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include "renderer/memory/budget.hpp"
+#include "renderer/memory/tlsf.hpp"
+
+#include <volk/volk.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mcvk::Renderer {
+    class Device;
+
+    struct MemoryBlock {
+        VkDeviceMemory memory;
+        uint32_t memory_type;
+        void *mapped;
+
+        TLSFMetadata metadata;
+    };
+
+    struct MemoryAllocation {
+        VkDeviceMemory memory{VK_NULL_HANDLE};
+        VkDeviceSize offset{0};
+        VkDeviceSize size{0};
+        uint32_t memory_type{UINT32_MAX};
+
+        // host pointer to the start of the allocation if its memory type is host-visible (blocks are persistently mapped)
+        void *mapped{nullptr};
+
+        // the block this was sub-allocated from; null for dedicated allocations, which own their VkDeviceMemory outright
+        MemoryBlock *block{nullptr};
+        uint32_t handle{TLSFMetadata::NULL_HANDLE};
+
+        MemoryCategory category{MemoryCategory::Other};
+    };
+
+    class MemoryAllocator {
+    public:
+        struct HeapStats {
+            VkDeviceSize heap_size;
+            VkDeviceSize reserved_bytes; // device memory owned by the allocator (blocks + dedicated)
+            VkDeviceSize used_bytes;     // memory handed out to resources
+            uint32_t block_count;
+            uint32_t dedicated_count;
+            uint32_t allocation_count;
+            uint32_t free_region_count;
+            VkDeviceSize largest_free_region;
+
+            // 0 when all free space in the heap's blocks is one contiguous region, approaching 1 as it gets scattered
+            float fragmentation;
+        };
+
+        MemoryAllocator(const Device &device);
+        ~MemoryAllocator();
+
+        MemoryAllocator(const MemoryAllocator &) = delete;
+        MemoryAllocator &operator=(const MemoryAllocator &) = delete;
+
+        // new device memory is only allocated within the heap's budget at first; if that fails, eviction callbacks are run and the
+        // budget is then exceeded if the driver allows it
+        MemoryAllocation Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear,
+            MemoryCategory category = MemoryCategory::Other);
+        MemoryAllocation AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, MemoryCategory category = MemoryCategory::Other);
+        MemoryAllocation AllocateForImage(VkImage image, VkMemoryPropertyFlags properties, MemoryCategory category = MemoryCategory::Other);
+        // like AllocateForBuffer(), but returns false rather than failing if no memory type has the properties, or if the
+        // allocation would take the reserved size of the chosen heap above max_heap_usage (a fraction of the heap size) or over
+        // its budget
+        bool TryAllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, float max_heap_usage, MemoryAllocation &allocation,
+            MemoryCategory category = MemoryCategory::Other);
+        void Free(MemoryAllocation &allocation);
+
+        void Flush(const MemoryAllocation &allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) const;
+        void Invalidate(const MemoryAllocation &allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) const;
+
+        std::vector<HeapStats> GetHeapStats() const;
+        void LogStats() const;
+
+    private:
+        static constexpr VkDeviceSize _DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+        struct Pool {
+            std::vector<std::unique_ptr<MemoryBlock>> blocks;
+        };
+
+        struct DedicatedStats {
+            uint32_t count{0};
+            VkDeviceSize bytes{0};
+        };
+
+        // keep_empty_block false releases the allocation's block if it is left empty, rather than keeping one around per pool
+        void _Free(MemoryAllocation &allocation, bool keep_empty_block = true);
+
+        bool _HasMemoryType(uint32_t type_bits, VkMemoryPropertyFlags properties) const;
+        bool _Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear, bool within_budget,
+            MemoryAllocation &allocation);
+        bool _TryAllocateFromType(uint32_t type, const VkMemoryRequirements &requirements, bool linear, bool within_budget,
+            MemoryAllocation &allocation);
+        bool _AllocateDeviceMemory(uint32_t type, VkDeviceSize size, bool within_budget, VkDeviceMemory *memory, void **mapped);
+        void _FreeDeviceMemory(VkDeviceMemory memory, void *mapped);
+        // eviction callback; frees empty blocks from the heap until about the given number of bytes are released
+        VkDeviceSize _TrimEmptyBlocks(uint32_t heap, VkDeviceSize bytes);
+
+        Pool &_GetPool(uint32_t type, bool linear);
+        VkDeviceSize _GetBlockSize(uint32_t type) const;
+        VkDeviceSize _GetHeapReservedBytes(uint32_t heap) const;
+        VkMappedMemoryRange _GetMappedRange(const MemoryAllocation &allocation, VkDeviceSize size, VkDeviceSize offset) const;
+
+        const Device &_device;
+
+        VkPhysicalDeviceMemoryProperties _memory_properties;
+        VkDeviceSize _non_coherent_atom_size;
+
+        // linear (buffer) and optimal-tiling (image) resources are kept in separate blocks when bufferImageGranularity would
+        // otherwise force padding between neighbours
+        bool _separate_linear;
+
+        std::vector<Pool> _pools;
+        std::vector<DedicatedStats> _dedicated;
+        uint32_t _device_allocation_count{0};
+
+        MemoryBudget::CallbackId _eviction_callback;
+
+        mutable std::mutex _mutex;
+    };
+}
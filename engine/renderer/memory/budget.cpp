@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "budget.hpp"
+
+#include "renderer/device.hpp"
+#include "utils/log.hpp"
+
+#include <sstream>
+
+namespace mcvk::Renderer {
+    const char *MemoryCategoryToString(MemoryCategory c) {
+        switch (c) {
+            case MemoryCategory::Mesh:
+                return "meshes";
+            case MemoryCategory::Texture:
+                return "textures";
+            case MemoryCategory::Staging:
+                return "staging";
+            case MemoryCategory::Uniform:
+                return "uniforms";
+            case MemoryCategory::Attachment:
+                return "attachments";
+            default:
+                return "other";
+        }
+    }
+
+    MemoryBudget::MemoryBudget(const Device &device, bool ext_memory_budget)
+        : _device{device}, _ext_memory_budget{ext_memory_budget} {
+    }
+
+    std::vector<MemoryBudget::HeapBudget> MemoryBudget::QueryHeaps() const {
+        const VkPhysicalDeviceMemoryProperties &props = _device.GetMemoryProperties();
+
+        std::vector<HeapBudget> heaps(props.memoryHeapCount);
+
+        if (_ext_memory_budget) {
+            VkDeviceSize budgets[VK_MAX_MEMORY_HEAPS];
+            VkDeviceSize usages[VK_MAX_MEMORY_HEAPS];
+            _QueryDriverBudget(budgets, usages);
+
+            for (uint32_t h = 0; h < heaps.size(); h++) {
+                heaps[h] = { props.memoryHeaps[h].size, budgets[h], usages[h] };
+            }
+            return heaps;
+        }
+
+        std::vector<MemoryAllocator::HeapStats> stats = _device.GetAllocator().GetHeapStats();
+        for (uint32_t h = 0; h < heaps.size(); h++) {
+            heaps[h] = {
+                props.memoryHeaps[h].size,
+                static_cast<VkDeviceSize>(static_cast<double>(props.memoryHeaps[h].size) * _FALLBACK_BUDGET),
+                stats[h].reserved_bytes };
+        }
+        return heaps;
+    }
+
+    bool MemoryBudget::Fits(uint32_t heap, VkDeviceSize size, VkDeviceSize reserved) const {
+        if (_ext_memory_budget) {
+            // the driver's figures already include this process' allocations
+            VkDeviceSize budgets[VK_MAX_MEMORY_HEAPS];
+            VkDeviceSize usages[VK_MAX_MEMORY_HEAPS];
+            _QueryDriverBudget(budgets, usages);
+
+            return usages[heap] + size <= budgets[heap];
+        }
+
+        VkDeviceSize heap_size = _device.GetMemoryProperties().memoryHeaps[heap].size;
+        return reserved + size <= static_cast<VkDeviceSize>(static_cast<double>(heap_size) * _FALLBACK_BUDGET);
+    }
+
+    MemoryBudget::CallbackId MemoryBudget::AddEvictionCallback(EvictionCallback &&callback) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        CallbackId id = _next_callback_id++;
+        _callbacks.push_back({ id, std::move(callback) });
+        return id;
+    }
+
+    void MemoryBudget::RemoveEvictionCallback(CallbackId id) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        std::erase_if(_callbacks, [id](const auto &cb) { return cb.first == id; });
+    }
+
+    VkDeviceSize MemoryBudget::Evict(uint32_t heap, VkDeviceSize bytes) {
+        // callbacks are run without the lock held, as they will generally free memory (and may register or remove callbacks)
+        std::vector<std::pair<CallbackId, EvictionCallback>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            callbacks = _callbacks;
+        }
+
+        VkDeviceSize released = 0;
+        for (auto &[id, cb] : callbacks) {
+            if (released >= bytes) {
+                break;
+            }
+            released += cb(heap, bytes - released);
+        }
+
+        // going over budget is only worth a warning if something could have been evicted but not enough was
+        if (!callbacks.empty() && released < bytes) {
+            Utils::Warn("Device memory heap " + std::to_string(heap) + " is over budget; eviction released " +
+                std::to_string(released / 1024) + " of " + std::to_string(bytes / 1024) + " KiB requested");
+        }
+        return released;
+    }
+
+    void MemoryBudget::TrackAllocation(MemoryCategory category, VkDeviceSize size) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _category_usage[static_cast<uint32_t>(category)] += size;
+    }
+
+    void MemoryBudget::TrackFree(MemoryCategory category, VkDeviceSize size) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _category_usage[static_cast<uint32_t>(category)] -= size;
+    }
+
+    VkDeviceSize MemoryBudget::GetCategoryUsage(MemoryCategory category) const {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        return _category_usage[static_cast<uint32_t>(category)];
+    }
+
+    void MemoryBudget::LogStats() const {
+        std::vector<HeapBudget> heaps = QueryHeaps();
+
+        std::stringstream stream{};
+        stream << "Device memory budget (" << (_ext_memory_budget ? "reported by driver" : "estimated from heap sizes") << "):";
+
+        for (uint32_t h = 0; h < heaps.size(); h++) {
+            stream << std::endl << "\tHeap " << h << ": " << (heaps[h].usage / (1024 * 1024)) << " MiB used of "
+                << (heaps[h].budget / (1024 * 1024)) << " MiB budget (" << (heaps[h].size / (1024 * 1024)) << " MiB heap)";
+        }
+
+        stream << std::endl << "\tBy category:";
+        for (uint32_t c = 0; c < MEMORY_CATEGORY_COUNT; c++) {
+            MemoryCategory category = static_cast<MemoryCategory>(c);
+            stream << " " << MemoryCategoryToString(category) << " " << (GetCategoryUsage(category) / 1024) << " KiB"
+                << ((c + 1 < MEMORY_CATEGORY_COUNT) ? "," : "");
+        }
+
+        Utils::Info(stream.str());
+    }
+
+    void MemoryBudget::_QueryDriverBudget(VkDeviceSize *budgets, VkDeviceSize *usages) const {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_props{};
+        budget_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 props{};
+        props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        props.pNext = &budget_props;
+
+        vkGetPhysicalDeviceMemoryProperties2KHR(_device.GetPhysicalDevice(), &props);
+
+        for (uint32_t h = 0; h < props.memoryProperties.memoryHeapCount; h++) {
+            budgets[h] = budget_props.heapBudget[h];
+            usages[h] = budget_props.heapUsage[h];
+        }
+    }
+}
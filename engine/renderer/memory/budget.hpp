@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <volk/volk.h>
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace mcvk::Renderer {
+    class Device;
+
+    // what an allocation is used for, for tracking where device memory goes
+    enum class MemoryCategory {
+        Other,
+        Mesh,
+        Texture,
+        Staging,
+        Uniform,
+        Attachment
+    };
+    static constexpr uint32_t MEMORY_CATEGORY_COUNT = 6;
+    const char *MemoryCategoryToString(MemoryCategory c);
+
+    // Tracks device memory usage against a per-heap budget. The budget comes from VK_EXT_memory_budget when the device supports
+    // it (and so accounts for other processes), otherwise it is a fixed share of each heap's size. When an allocation would go
+    // over budget, the allocator asks registered eviction callbacks to release resources before going ahead anyway.
+    class MemoryBudget {
+    public:
+        struct HeapBudget {
+            VkDeviceSize size;
+            VkDeviceSize budget;
+            VkDeviceSize usage;
+        };
+
+        // asked to release roughly the given number of bytes from the heap; returns the number of bytes it expects to release.
+        // Memory is usually returned through the deletion queue, so it may only become available some frames later. Callbacks
+        // run on whichever thread is allocating, so they must not call into the upload scheduler (including by destroying buffers
+        // or images directly, which cancels their pending acquires); queueing resources on the deletion queue is safe.
+        using EvictionCallback = std::function<VkDeviceSize(uint32_t heap, VkDeviceSize bytes)>;
+        using CallbackId = uint32_t;
+
+        MemoryBudget(const Device &device, bool ext_memory_budget);
+
+        MemoryBudget(const MemoryBudget &) = delete;
+        MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+        std::vector<HeapBudget> QueryHeaps() const;
+        // true if size more bytes can be allocated from the heap without going over budget; reserved is the memory the engine
+        // already holds in the heap, used when the driver can't report usage itself
+        bool Fits(uint32_t heap, VkDeviceSize size, VkDeviceSize reserved) const;
+
+        CallbackId AddEvictionCallback(EvictionCallback &&callback);
+        void RemoveEvictionCallback(CallbackId id);
+        // run eviction callbacks until they have promised to release the given number of bytes, returning the total promised
+        VkDeviceSize Evict(uint32_t heap, VkDeviceSize bytes);
+
+        void TrackAllocation(MemoryCategory category, VkDeviceSize size);
+        void TrackFree(MemoryCategory category, VkDeviceSize size);
+        VkDeviceSize GetCategoryUsage(MemoryCategory category) const;
+
+        inline bool HasMemoryBudgetExtension() const { return _ext_memory_budget; }
+
+        void LogStats() const;
+
+    private:
+        // share of a heap used as its budget when VK_EXT_memory_budget is unavailable
+        static constexpr float _FALLBACK_BUDGET = 0.8f;
+
+        void _QueryDriverBudget(VkDeviceSize *budgets, VkDeviceSize *usages) const;
+
+        const Device &_device;
+        bool _ext_memory_budget;
+
+        std::array<VkDeviceSize, MEMORY_CATEGORY_COUNT> _category_usage{};
+
+        std::vector<std::pair<CallbackId, EvictionCallback>> _callbacks;
+        CallbackId _next_callback_id{1};
+
+        mutable std::mutex _mutex;
+    };
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "deletion_queue.hpp"
+
+#include "renderer/device.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace mcvk::Renderer {
+    DeletionQueue::DeletionQueue(const Device &device)
+        : _device{device} {
+    }
+
+    DeletionQueue::~DeletionQueue() {
+        RetireAll();
+    }
+
+    void DeletionQueue::Destroy(VkBuffer buffer, const MemoryAllocation &allocation, UploadScheduler::Ticket ticket) {
+        const Device &device = _device;
+        Destroy([&device, buffer, alloc = allocation]() mutable {
+            vkDestroyBuffer(device.GetDevice(), buffer, nullptr);
+            device.GetAllocator().Free(alloc);
+        }, allocation.size, ticket);
+    }
+
+    void DeletionQueue::Destroy(VkImage image, const MemoryAllocation &allocation, UploadScheduler::Ticket ticket) {
+        const Device &device = _device;
+        Destroy([&device, image, alloc = allocation]() mutable {
+            vkDestroyImage(device.GetDevice(), image, nullptr);
+            device.GetAllocator().Free(alloc);
+        }, allocation.size, ticket);
+    }
+
+    void DeletionQueue::Destroy(VkImageView view) {
+        const Device &device = _device;
+        Destroy([&device, view]() {
+            vkDestroyImageView(device.GetDevice(), view, nullptr);
+        });
+    }
+
+    void DeletionQueue::Destroy(VkSampler sampler) {
+        const Device &device = _device;
+        Destroy([&device, sampler]() {
+            vkDestroySampler(device.GetDevice(), sampler, nullptr);
+        });
+    }
+
+    void DeletionQueue::Destroy(std::function<void()> &&fn, VkDeviceSize bytes, UploadScheduler::Ticket ticket) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        // the frame being recorded may reference the object, as may any submitted frame up to it
+        _entries.push_back({ _recording_serial, ticket, bytes, std::move(fn) });
+
+        _stats.objects_pending++;
+        _stats.bytes_pending += bytes;
+        _stats.peak_objects_pending = std::max(_stats.peak_objects_pending, _stats.objects_pending);
+        _stats.peak_bytes_pending = std::max(_stats.peak_bytes_pending, _stats.bytes_pending);
+    }
+
+    void DeletionQueue::Advance(uint64_t recording_serial, uint64_t completed_serial) {
+        std::deque<Entry> retired;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+
+            _recording_serial = recording_serial;
+            _completed_serial = std::max(_completed_serial, completed_serial);
+
+            // entries are queued in serial order, but one may be held back by its upload; later entries can still go
+            UploadScheduler &uploads = _device.GetUploadScheduler();
+            for (auto it = _entries.begin(); it != _entries.end() && it->serial <= _completed_serial;) {
+                if (uploads.IsComplete(it->ticket)) {
+                    retired.push_back(std::move(*it));
+                    it = _entries.erase(it);
+                } else {
+                    it++;
+                }
+            }
+        }
+
+        // destroy outside the lock, as freeing memory takes the allocator's lock
+        for (Entry &e : retired) {
+            _Retire(e);
+        }
+    }
+
+    void DeletionQueue::RetireAll() {
+        std::deque<Entry> retired;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            retired.swap(_entries);
+        }
+
+        // an upload may not even have been submitted yet if the object was written and released in the same frame
+        UploadScheduler &uploads = _device.GetUploadScheduler();
+        for (Entry &e : retired) {
+            uploads.Wait(e.ticket);
+            _Retire(e);
+        }
+    }
+
+    DeletionQueue::Stats DeletionQueue::GetStats() const {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        return _stats;
+    }
+
+    void DeletionQueue::LogStats() const {
+        Stats stats = GetStats();
+
+        std::stringstream stream{};
+        stream << "Deletion queue statistics:" << std::endl
+            << "\t" << stats.objects_released << " object(s) released (" << (stats.bytes_released / 1024) << " KiB)" << std::endl
+            << "\t" << stats.objects_pending << " object(s) awaiting release (" << (stats.bytes_pending / 1024) << " KiB), peak "
+            << stats.peak_objects_pending << " (" << (stats.peak_bytes_pending / 1024) << " KiB)";
+
+        Utils::Info(stream.str());
+    }
+
+    void DeletionQueue::_Retire(Entry &entry) {
+        entry.destroy();
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        _stats.objects_pending--;
+        _stats.bytes_pending -= entry.bytes;
+        _stats.objects_released++;
+        _stats.bytes_released += entry.bytes;
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include "renderer/memory/allocator.hpp"
+#include "renderer/resource/upload_scheduler.hpp"
+
+#include <volk/volk.h>
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace mcvk::Renderer {
+    class Device;
+
+    // Defers destruction of GPU objects until the frame that may last have used them has completed, so resources can be
+    // released mid-frame without idling the device. Frames are identified by a serial (the renderer's frame number); each object
+    // is tagged with the serial being recorded when it was queued, plus the upload ticket of its last staged write, and is
+    // destroyed once both have completed.
+    class DeletionQueue {
+    public:
+        struct Stats {
+            uint32_t objects_pending{0};
+            VkDeviceSize bytes_pending{0};
+            uint32_t peak_objects_pending{0};
+            VkDeviceSize peak_bytes_pending{0};
+            uint64_t objects_released{0};
+            VkDeviceSize bytes_released{0};
+        };
+
+        DeletionQueue(const Device &device);
+        ~DeletionQueue();
+
+        DeletionQueue(const DeletionQueue &) = delete;
+        DeletionQueue &operator=(const DeletionQueue &) = delete;
+
+        void Destroy(VkBuffer buffer, const MemoryAllocation &allocation, UploadScheduler::Ticket ticket = 0);
+        void Destroy(VkImage image, const MemoryAllocation &allocation, UploadScheduler::Ticket ticket = 0);
+        void Destroy(VkImageView view);
+        void Destroy(VkSampler sampler);
+        // queue arbitrary cleanup; bytes is only used for statistics
+        void Destroy(std::function<void()> &&fn, VkDeviceSize bytes = 0, UploadScheduler::Ticket ticket = 0);
+
+        // called by the renderer at the start of each frame: recording_serial is the frame now being recorded, and every frame
+        // up to and including completed_serial is known to have finished on the GPU
+        void Advance(uint64_t recording_serial, uint64_t completed_serial);
+        // destroy everything queued; the device must be idle
+        void RetireAll();
+
+        Stats GetStats() const;
+        void LogStats() const;
+
+    private:
+        struct Entry {
+            uint64_t serial;
+            UploadScheduler::Ticket ticket;
+            VkDeviceSize bytes;
+            std::function<void()> destroy;
+        };
+
+        void _Retire(Entry &entry);
+
+        const Device &_device;
+
+        std::deque<Entry> _entries;
+
+        uint64_t _recording_serial{0};
+        uint64_t _completed_serial{0};
+
+        Stats _stats{};
+
+        mutable std::mutex _mutex;
+    };
+}
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "tlsf.hpp"
+
+#include <bit>
+
+namespace mcvk::Renderer {
+    TLSFMetadata::TLSFMetadata(uint64_t size)
+        : _size{size} {
+        for (auto &fl : _heads) {
+            for (auto &head : fl) {
+                head = NULL_HANDLE;
+            }
+        }
+
+        // the whole range starts out as one free region
+        uint32_t node = _NewNode();
+        _nodes[node] = { 0, size, NULL_HANDLE, NULL_HANDLE, NULL_HANDLE, NULL_HANDLE, true };
+        _InsertFree(node);
+    }
+
+    uint32_t TLSFMetadata::Allocate(uint64_t size, uint64_t alignment, uint64_t *offset) {
+        if (size == 0) {
+            size = 1;
+        }
+        if (alignment == 0) {
+            alignment = 1;
+        }
+
+        // the head of the first list that can hold the size will usually also satisfy the alignment; if it doesn't, search again
+        // with enough slack to guarantee an aligned fit
+        uint32_t node = _FindFree(size);
+        if (node == NULL_HANDLE || !_Fits(node, size, alignment)) {
+            node = (alignment > 1) ? _FindFree(size + alignment - 1) : NULL_HANDLE;
+            if (node == NULL_HANDLE) {
+                return NULL_HANDLE;
+            }
+        }
+
+        _RemoveFree(node);
+
+        uint64_t aligned = (_nodes[node].offset + alignment - 1) / alignment * alignment;
+
+        // give the alignment padding at the front back to the free lists
+        uint64_t padding = aligned - _nodes[node].offset;
+        if (padding > 0) {
+            uint32_t pad = _NewNode();
+            _nodes[pad] = { _nodes[node].offset, padding, _nodes[node].prev_phys, node, NULL_HANDLE, NULL_HANDLE, true };
+            if (_nodes[node].prev_phys != NULL_HANDLE) {
+                _nodes[_nodes[node].prev_phys].next_phys = pad;
+            }
+            _nodes[node].prev_phys = pad;
+            _nodes[node].offset = aligned;
+            _nodes[node].size -= padding;
+            _InsertFree(pad);
+        }
+
+        // ...and likewise with the remainder at the back
+        uint64_t remainder = _nodes[node].size - size;
+        if (remainder > 0) {
+            uint32_t tail = _NewNode();
+            _nodes[tail] = { aligned + size, remainder, node, _nodes[node].next_phys, NULL_HANDLE, NULL_HANDLE, true };
+            if (_nodes[node].next_phys != NULL_HANDLE) {
+                _nodes[_nodes[node].next_phys].prev_phys = tail;
+            }
+            _nodes[node].next_phys = tail;
+            _nodes[node].size = size;
+            _InsertFree(tail);
+        }
+
+        _nodes[node].free = false;
+        _used += size;
+        _allocation_count++;
+
+        *offset = aligned;
+        return node;
+    }
+
+    void TLSFMetadata::Free(uint32_t handle) {
+        uint32_t node = handle;
+
+        _nodes[node].free = true;
+        _used -= _nodes[node].size;
+        _allocation_count--;
+
+        // coalesce with the previous physical region
+        uint32_t prev = _nodes[node].prev_phys;
+        if (prev != NULL_HANDLE && _nodes[prev].free) {
+            _RemoveFree(prev);
+
+            _nodes[prev].size += _nodes[node].size;
+            _nodes[prev].next_phys = _nodes[node].next_phys;
+            if (_nodes[node].next_phys != NULL_HANDLE) {
+                _nodes[_nodes[node].next_phys].prev_phys = prev;
+            }
+            _ReleaseNode(node);
+            node = prev;
+        }
+
+        // coalesce with the next physical region
+        uint32_t next = _nodes[node].next_phys;
+        if (next != NULL_HANDLE && _nodes[next].free) {
+            _RemoveFree(next);
+
+            _nodes[node].size += _nodes[next].size;
+            _nodes[node].next_phys = _nodes[next].next_phys;
+            if (_nodes[next].next_phys != NULL_HANDLE) {
+                _nodes[_nodes[next].next_phys].prev_phys = node;
+            }
+            _ReleaseNode(next);
+        }
+
+        _InsertFree(node);
+    }
+
+    uint64_t TLSFMetadata::GetLargestFreeRegion() const {
+        if (_fl_bitmap == 0) {
+            return 0;
+        }
+
+        // the largest region is in the highest non-empty list, but the list itself is unordered
+        uint32_t fl = 63 - std::countl_zero(_fl_bitmap);
+        uint32_t sl = 31 - std::countl_zero(_sl_bitmaps[fl]);
+
+        uint64_t largest = 0;
+        for (uint32_t n = _heads[fl][sl]; n != NULL_HANDLE; n = _nodes[n].next_free) {
+            if (_nodes[n].size > largest) {
+                largest = _nodes[n].size;
+            }
+        }
+        return largest;
+    }
+
+    void TLSFMetadata::_Mapping(uint64_t size, uint32_t &fl, uint32_t &sl) {
+        if (size < _SL_COUNT) {
+            // small sizes map linearly into the first list
+            fl = 0;
+            sl = static_cast<uint32_t>(size);
+        } else {
+            uint32_t log2 = 63 - std::countl_zero(size);
+            sl = static_cast<uint32_t>(size >> (log2 - _SL_LOG2)) & (_SL_COUNT - 1);
+            fl = log2 - _SL_LOG2 + 1;
+        }
+    }
+
+    uint32_t TLSFMetadata::_FindFree(uint64_t size) const {
+        // round the size up to the next list boundary so that every region in the chosen list is large enough
+        if (size >= _SL_COUNT) {
+            uint32_t log2 = 63 - std::countl_zero(size);
+            size += (1ull << (log2 - _SL_LOG2)) - 1;
+        }
+
+        uint32_t fl, sl;
+        _Mapping(size, fl, sl);
+        if (fl >= _FL_COUNT) {
+            return NULL_HANDLE;
+        }
+
+        uint32_t sl_map = _sl_bitmaps[fl] & (~0u << sl);
+        if (sl_map == 0) {
+            // nothing in this first-level range - move to the next non-empty one
+            uint64_t fl_map = (fl + 1 < 64) ? (_fl_bitmap & (~0ull << (fl + 1))) : 0;
+            if (fl_map == 0) {
+                return NULL_HANDLE;
+            }
+            fl = std::countr_zero(fl_map);
+            sl_map = _sl_bitmaps[fl];
+        }
+        sl = std::countr_zero(sl_map);
+
+        return _heads[fl][sl];
+    }
+
+    bool TLSFMetadata::_Fits(uint32_t node, uint64_t size, uint64_t alignment) const {
+        uint64_t aligned = (_nodes[node].offset + alignment - 1) / alignment * alignment;
+        return aligned + size <= _nodes[node].offset + _nodes[node].size;
+    }
+
+    uint32_t TLSFMetadata::_NewNode() {
+        if (!_unused_nodes.empty()) {
+            uint32_t node = _unused_nodes.back();
+            _unused_nodes.pop_back();
+            return node;
+        }
+        _nodes.emplace_back();
+        return static_cast<uint32_t>(_nodes.size() - 1);
+    }
+
+    void TLSFMetadata::_ReleaseNode(uint32_t node) {
+        _unused_nodes.push_back(node);
+    }
+
+    void TLSFMetadata::_InsertFree(uint32_t node) {
+        uint32_t fl, sl;
+        _Mapping(_nodes[node].size, fl, sl);
+
+        uint32_t head = _heads[fl][sl];
+        _nodes[node].prev_free = NULL_HANDLE;
+        _nodes[node].next_free = head;
+        if (head != NULL_HANDLE) {
+            _nodes[head].prev_free = node;
+        }
+        _heads[fl][sl] = node;
+
+        _fl_bitmap |= 1ull << fl;
+        _sl_bitmaps[fl] |= 1u << sl;
+
+        _free_count++;
+    }
+
+    void TLSFMetadata::_RemoveFree(uint32_t node) {
+        uint32_t fl, sl;
+        _Mapping(_nodes[node].size, fl, sl);
+
+        uint32_t prev = _nodes[node].prev_free;
+        uint32_t next = _nodes[node].next_free;
+        if (prev != NULL_HANDLE) {
+            _nodes[prev].next_free = next;
+        }
+        if (next != NULL_HANDLE) {
+            _nodes[next].prev_free = prev;
+        }
+
+        if (_heads[fl][sl] == node) {
+            _heads[fl][sl] = next;
+
+            if (next == NULL_HANDLE) {
+                _sl_bitmaps[fl] &= ~(1u << sl);
+                if (_sl_bitmaps[fl] == 0) {
+                    _fl_bitmap &= ~(1ull << fl);
+                }
+            }
+        }
+
+        _free_count--;
+    }
+}
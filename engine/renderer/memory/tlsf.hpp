@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace mcvk::Renderer {
+    // Bookkeeping for sub-allocating a single contiguous range (e.g. one VkDeviceMemory block) using a two-level segregated fit
+    // (TLSF) free list, giving constant-time allocation and free with immediate coalescing of neighbouring free regions.
+    // This class never touches Vulkan, so it can be driven entirely on the CPU.
+    class TLSFMetadata {
+    public:
+        static constexpr uint32_t NULL_HANDLE = UINT32_MAX;
+
+        TLSFMetadata(uint64_t size);
+
+        // returns a handle to pass to Free(), or NULL_HANDLE if no suitably sized and aligned region is available
+        uint32_t Allocate(uint64_t size, uint64_t alignment, uint64_t *offset);
+        void Free(uint32_t handle);
+
+        uint64_t GetLargestFreeRegion() const;
+
+        inline uint64_t GetSize() const { return _size; }
+        inline uint64_t GetUsedSize() const { return _used; }
+        inline uint32_t GetAllocationCount() const { return _allocation_count; }
+        inline uint32_t GetFreeRegionCount() const { return _free_count; }
+        inline bool IsEmpty() const { return _allocation_count == 0; }
+
+    private:
+        // second-level lists split each power-of-two range into 2^_SL_LOG2 linear subdivisions
+        static constexpr uint32_t _SL_LOG2 = 4;
+        static constexpr uint32_t _SL_COUNT = 1 << _SL_LOG2;
+        static constexpr uint32_t _FL_COUNT = 64 - _SL_LOG2 + 1;
+
+        struct Node {
+            uint64_t offset;
+            uint64_t size;
+
+            // physical neighbours (by offset)
+            uint32_t prev_phys;
+            uint32_t next_phys;
+            // neighbours in the segregated free list this node belongs to (if free)
+            uint32_t prev_free;
+            uint32_t next_free;
+
+            bool free;
+        };
+
+        static void _Mapping(uint64_t size, uint32_t &fl, uint32_t &sl);
+
+        uint32_t _FindFree(uint64_t size) const;
+        bool _Fits(uint32_t node, uint64_t size, uint64_t alignment) const;
+
+        uint32_t _NewNode();
+        void _ReleaseNode(uint32_t node);
+        void _InsertFree(uint32_t node);
+        void _RemoveFree(uint32_t node);
+
+        uint64_t _size;
+        uint64_t _used{0};
+        uint32_t _allocation_count{0};
+        uint32_t _free_count{0};
+
+        std::vector<Node> _nodes;
+        std::vector<uint32_t> _unused_nodes;
+
+        uint64_t _fl_bitmap{0};
+        uint32_t _sl_bitmaps[_FL_COUNT]{};
+        uint32_t _heads[_FL_COUNT][_SL_COUNT];
+    };
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "offscreen_target.hpp"
+
+#include "utils/log.hpp"
+
+#include <volk/volk.h>
+
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace mcvk::Renderer {
+    OffscreenTarget::OffscreenTarget(const Device &device, VkExtent2D extent, uint32_t frames_in_flight)
+        : RenderTarget{device, extent, frames_in_flight} {
+        // both are required to be supported as colour attachments
+        _colour_format = _device.FindSupportedFormat(
+            { VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_B8G8R8A8_SRGB },
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+        _upscale_supported = _device.SupportsLinearBlit(_colour_format);
+
+        _CreateColourImages();
+        _CreateDepthImage();
+        // frames are left in the layout they are read back from
+        _CreateRenderPass(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        _CreateFramebuffers();
+        _CreateFrameFences();
+
+        Utils::Info("Rendering offscreen to " + std::to_string(_colour_images.size()) + " image(s) with dims " +
+            std::to_string(_extent.width) + "x" + std::to_string(_extent.height));
+    }
+
+    OffscreenTarget::~OffscreenTarget() {
+    }
+
+    VkResult OffscreenTarget::AcquireNextImage(uint32_t *const image_index) {
+        vkWaitForFences(_device.GetDevice(), 1, &_frame_fences[_current_frame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+        // each frame slot has an image of its own, so the image is free as soon as the slot is
+        *image_index = _current_frame;
+        return VK_SUCCESS;
+    }
+
+    VkResult OffscreenTarget::SubmitCommandBuffers(const std::vector<VkCommandBuffer> &cmdbufs, const std::vector<VkSemaphore> &upload_sems,
+        uint32_t *const image_index) {
+        VkFence frame_fence = _frame_fences[_current_frame];
+        vkResetFences(_device.GetDevice(), 1, &frame_fence);
+
+        // there is no image to wait for, only any pending uploads
+        std::vector<VkPipelineStageFlags> wait_stages(upload_sems.size(), UploadScheduler::WAIT_STAGES);
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+        submit_info.waitSemaphoreCount = static_cast<uint32_t>(upload_sems.size());
+        submit_info.pWaitSemaphores = upload_sems.data();
+        submit_info.pWaitDstStageMask = wait_stages.data();
+
+        submit_info.commandBufferCount = static_cast<uint32_t>(cmdbufs.size());
+        submit_info.pCommandBuffers = cmdbufs.data();
+
+        {
+            auto queue_lock = _device.LockQueue(_device.GetGraphicsQueue());
+            if (vkQueueSubmit(_device.GetGraphicsQueue(), 1, &submit_info, frame_fence) != VK_SUCCESS) {
+                Utils::Fatal("Failed to submit draw command buffer operations to graphics queue");
+            }
+        }
+
+        _last_image = *image_index;
+        _current_frame = (_current_frame + 1) % _frames_in_flight;
+
+        return VK_SUCCESS;
+    }
+
+    bool OffscreenTarget::ReadLastFrame(std::vector<uint8_t> &rgba) const {
+        if (_last_image == UINT32_MAX) {
+            return false;
+        }
+
+        VkDeviceSize size = static_cast<VkDeviceSize>(_extent.width) * _extent.height * 4;
+
+        VkBufferCreateInfo create_info{};
+        create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        create_info.size = size;
+        create_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkBuffer buffer;
+        if (vkCreateBuffer(_device.GetDevice(), &create_info, nullptr, &buffer) != VK_SUCCESS) {
+            Utils::Error("Failed to create frame readback buffer");
+            return false;
+        }
+        MemoryAllocation allocation = _device.GetAllocator().AllocateForBuffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            MemoryCategory::Staging);
+        if (!allocation.mapped) {
+            Utils::Error("Failed to map frame readback buffer to host memory");
+            vkDestroyBuffer(_device.GetDevice(), buffer, nullptr);
+            _device.GetAllocator().Free(allocation);
+            return false;
+        }
+
+        // copied on the graphics queue, so the copy is ordered after the frame's submission and only needs a barrier against it
+        TransientCommandPool &pool = _device.GetGraphicsTransientPool();
+        VkCommandBuffer cmdbuf = pool.Begin();
+
+        VkImageMemoryBarrier image_barrier{};
+        image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        // written by either the render pass or, if drawn below full scale, the upscale blit
+        image_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.image = _colour_images[_last_image]->GetImage();
+        image_barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageExtent = { _extent.width, _extent.height, 1 };
+        vkCmdCopyImageToBuffer(cmdbuf, _colour_images[_last_image]->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+        VkBufferMemoryBarrier buffer_barrier{};
+        buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        buffer_barrier.buffer = buffer;
+        buffer_barrier.offset = 0;
+        buffer_barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+            0, nullptr, 1, &buffer_barrier, 0, nullptr);
+
+        pool.Wait(pool.Submit(cmdbuf));
+
+        _device.GetAllocator().Invalidate(allocation);
+        rgba.resize(static_cast<size_t>(size));
+        std::memcpy(rgba.data(), allocation.mapped, rgba.size());
+
+        if (_colour_format == VK_FORMAT_B8G8R8A8_SRGB) {
+            for (size_t i = 0; i < rgba.size(); i += 4) {
+                std::swap(rgba[i], rgba[i + 2]);
+            }
+        }
+
+        vkDestroyBuffer(_device.GetDevice(), buffer, nullptr);
+        _device.GetAllocator().Free(allocation);
+
+        return true;
+    }
+
+    void OffscreenTarget::_CreateColourImages() {
+        auto config = Image::Config::Defaults(_extent, _colour_format);
+        config.image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        config.mem_props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        config.category = MemoryCategory::Attachment;
+
+        _colour_images.resize(_frames_in_flight);
+        for (auto &image : _colour_images) {
+            image = std::make_unique<Image>(_device, config);
+        }
+    }
+}
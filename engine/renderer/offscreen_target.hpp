@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include "renderer/render_target.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace mcvk::Renderer {
+    // Renders into a ring of offscreen colour images - one per frame in flight - instead of presenting them, so that no window or
+    // surface is needed. Finished frames are left ready to be copied back to the host.
+    class OffscreenTarget : public RenderTarget {
+    public:
+        OffscreenTarget(const Device &device, VkExtent2D extent, uint32_t frames_in_flight);
+        ~OffscreenTarget();
+
+        VkResult AcquireNextImage(uint32_t *const image_index) override;
+        VkResult SubmitCommandBuffers(const std::vector<VkCommandBuffer> &cmdbufs, const std::vector<VkSemaphore> &upload_sems,
+            uint32_t *const image_index) override;
+
+        // copy the most recently submitted frame into tightly packed 8-bit RGBA rows, blocking until it has been rendered; returns
+        // false if no frame has been submitted yet
+        bool ReadLastFrame(std::vector<uint8_t> &rgba) const;
+
+    private:
+        void _CreateColourImages();
+
+        uint32_t _last_image{UINT32_MAX};
+    };
+}
@@ -11,6 +11,9 @@
 
 #include "utils/log.hpp"
 
+#include <algorithm>
+#include <map>
+
 namespace mcvk::Renderer {
     GraphicsPipeline::Config GraphicsPipeline::Config::Defaults() {
         Config config{};
@@ -86,8 +89,9 @@ namespace mcvk::Renderer {
         config.dynamic_state_info.dynamicStateCount = static_cast<uint32_t>(config.dynamic_states.size());
         config.dynamic_state_info.flags = 0;
 
-        config.set_layouts = {};
-        config.push_constant_ranges = {};
+        config.binding_overrides = {};
+
+        config.specialization = {};
 
         return config;
     }
@@ -98,9 +102,7 @@ namespace mcvk::Renderer {
         _BuildCreateInfo();
     }
 
-    void GraphicsPipeline::BuildGraphicsPipelines(const Device &device, const std::vector<GraphicsPipeline *> &pipelines) {
-        Utils::Info("Building " + std::to_string(pipelines.size()) + " graphics pipelines");
-
+    void GraphicsPipeline::BuildGraphicsPipelines(const Device &device, const PipelineCache &cache, const std::vector<GraphicsPipeline *> &pipelines) {
         std::vector<VkGraphicsPipelineCreateInfo> pipeline_infos(pipelines.size());
         for (size_t i = 0; i < pipeline_infos.size(); i++) {
             pipeline_infos[i] = pipelines[i]->_info;
@@ -108,7 +110,7 @@ namespace mcvk::Renderer {
 
         std::vector<VkPipeline> vk_pipelines(pipelines.size());
 
-        if (vkCreateGraphicsPipelines(device.GetDevice(), VK_NULL_HANDLE, static_cast<uint32_t>(pipeline_infos.size()),
+        if (vkCreateGraphicsPipelines(device.GetDevice(), cache.GetCache(), static_cast<uint32_t>(pipeline_infos.size()),
             pipeline_infos.data(), nullptr, vk_pipelines.data()) != VK_SUCCESS) {
             Utils::Fatal("Failed to create graphics pipeline");
         }
@@ -119,24 +121,128 @@ namespace mcvk::Renderer {
         }
     }
 
+    VkDescriptorSetLayout GraphicsPipeline::GetSetLayout(uint32_t set) const {
+        return set < _set_layouts.size() ? _set_layouts[set] : VK_NULL_HANDLE;
+    }
+
     void GraphicsPipeline::_BuildLayout() {
-        VkPipelineLayoutCreateInfo info{};
-        info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        info.setLayoutCount = static_cast<uint32_t>(_config.set_layouts.size());
-        info.pSetLayouts = _config.set_layouts.data();
-        info.pushConstantRangeCount = static_cast<uint32_t>(_config.push_constant_ranges.size());
-        info.pPushConstantRanges = _config.push_constant_ranges.data();
-
-        if (vkCreatePipelineLayout(_device.GetDevice(), &info, nullptr, &_layout) != VK_SUCCESS) {
-            Utils::Fatal("Failed to create graphics pipeline layout");
+        // merge every stage's bindings, keyed by set then binding, so that a binding used by several stages is visible to all of them
+        std::map<uint32_t, std::map<uint32_t, LayoutCache::SetBinding>> sets;
+        VkShaderStageFlags push_constant_stages = 0;
+        uint32_t push_constant_size = 0;
+
+        for (const ShaderReflection *reflection : _shader_set.GetReflections()) {
+            for (const ReflectedBinding &b : reflection->bindings) {
+                auto [it, inserted] = sets[b.set].try_emplace(b.binding, LayoutCache::SetBinding{ b.binding, b.type, b.count, 0 });
+                LayoutCache::SetBinding &merged = it->second;
+                if (!inserted && (merged.type != b.type || merged.count != b.count)) {
+                    Utils::Error("Shader stages disagree on the descriptor at set " + std::to_string(b.set) + ", binding " +
+                        std::to_string(b.binding));
+                }
+                merged.stages |= reflection->stage;
+            }
+
+            if (reflection->push_constant_size > 0) {
+                push_constant_stages |= reflection->stage;
+                push_constant_size = std::max(push_constant_size, reflection->push_constant_size);
+            }
+        }
+
+        for (const DescriptorBindingOverride &o : _config.binding_overrides) {
+            auto set = sets.find(o.set);
+            if (set == sets.end() || !set->second.contains(o.binding)) {
+                // shared overrides are given for every pipeline, and not every pipeline uses every binding
+                continue;
+            }
+
+            LayoutCache::SetBinding &b = set->second.at(o.binding);
+            if (o.dynamic) {
+                if (b.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+                    b.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+                } else if (b.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
+                    b.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+                } else {
+                    Utils::Warn("Ignoring dynamic override for non-buffer descriptor at set " + std::to_string(o.set) + ", binding " +
+                        std::to_string(o.binding));
+                }
+            }
+            if (o.immutable_sampler) {
+                if (b.type == VK_DESCRIPTOR_TYPE_SAMPLER || b.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+                    b.immutable_sampler = o.immutable_sampler;
+                } else {
+                    Utils::Warn("Ignoring immutable sampler override for non-sampler descriptor at set " + std::to_string(o.set) +
+                        ", binding " + std::to_string(o.binding));
+                }
+            }
         }
+
+        // sets are numbered from 0, so any gaps are filled with empty layouts
+        _set_layouts.clear();
+        uint32_t set_count = sets.empty() ? 0 : sets.rbegin()->first + 1;
+        for (uint32_t set = 0; set < set_count; set++) {
+            std::vector<LayoutCache::SetBinding> bindings;
+            if (auto it = sets.find(set); it != sets.end()) {
+                for (auto &[_, b] : it->second) {
+                    bindings.push_back(b);
+                }
+            }
+            _set_layouts.push_back(_device.GetLayoutCache().GetSetLayout(bindings));
+        }
+
+        // one range covering every stage that declares a block keeps push constant ranges compatible between pipelines
+        std::vector<VkPushConstantRange> push_constant_ranges;
+        if (push_constant_size > 0) {
+            push_constant_ranges.push_back({ push_constant_stages, 0, push_constant_size });
+        }
+
+        _layout = _device.GetLayoutCache().GetPipelineLayout(_set_layouts, push_constant_ranges);
     }
 
     void GraphicsPipeline::_BuildCreateInfo() {
-        _shader_stages = _shader_set.BuildShaderStageInfos();
+        // the config was copied in, so its internal pointers still refer to wherever it was copied from
+        _config.color_blend_info.pAttachments = &_config.color_blend_attachment;
+        _config.dynamic_state_info.pDynamicStates = _config.dynamic_states.data();
+        _config.dynamic_state_info.dynamicStateCount = static_cast<uint32_t>(_config.dynamic_states.size());
+
+        // each constant gets its own 32-bit slot in the data block
+        _specialization_entries.clear();
+        _specialization_data.clear();
+        for (const auto &[id, value] : _config.specialization) {
+            VkSpecializationMapEntry entry{};
+            entry.constantID = id;
+            entry.offset = static_cast<uint32_t>(_specialization_data.size() * sizeof(uint32_t));
+            entry.size = sizeof(uint32_t);
+            _specialization_entries.push_back(entry);
+            _specialization_data.push_back(value);
+        }
+        _specialization_info.mapEntryCount = static_cast<uint32_t>(_specialization_entries.size());
+        _specialization_info.pMapEntries = _specialization_entries.data();
+        _specialization_info.dataSize = _specialization_data.size() * sizeof(uint32_t);
+        _specialization_info.pData = _specialization_data.data();
+
+        _shader_stages = _shader_set.BuildShaderStageInfos(_specialization_entries.empty() ? nullptr : &_specialization_info);
 
         _vertex_bindings = Model::Vertex::GetBindingDescriptions();
-        _vertex_attribs = Model::Vertex::GetAttributeDescriptions();
+        _vertex_attribs.clear();
+
+        // only attributes the vertex shader actually reads are passed on
+        std::vector<VkVertexInputAttributeDescription> model_attribs = Model::Vertex::GetAttributeDescriptions();
+        for (const ShaderReflection *reflection : _shader_set.GetReflections()) {
+            if (reflection->stage != VK_SHADER_STAGE_VERTEX_BIT) {
+                continue;
+            }
+            for (const ReflectedInput &input : reflection->inputs) {
+                auto it = std::find_if(model_attribs.begin(), model_attribs.end(), [&](const VkVertexInputAttributeDescription &a) {
+                    return a.location == input.location;
+                });
+                if (it == model_attribs.end()) {
+                    Utils::Warn("Vertex shader reads input at location " + std::to_string(input.location) +
+                        ", which the vertex format doesn't provide");
+                    continue;
+                }
+                _vertex_attribs.push_back(*it);
+            }
+        }
         _vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
         _vertex_input_info.pNext = nullptr;
         _vertex_input_info.flags = 0;
@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include "renderer/pipeline/layout_cache.hpp"
 #include "renderer/pipeline/pipeline.hpp"
+#include "renderer/pipeline/pipeline_cache.hpp"
 
 #include "renderer/device.hpp"
 #include "renderer/shader_set.hpp"
@@ -33,15 +35,21 @@ namespace mcvk::Renderer {
             VkRenderPass render_pass = nullptr;
             uint32_t subpass = 0;
 
-            std::vector<VkDescriptorSetLayout> set_layouts;
-            std::vector<VkPushConstantRange> push_constant_ranges;
+            // descriptor set and push constant layouts are reflected from the shaders; these fill in what reflection can't know
+            std::vector<DescriptorBindingOverride> binding_overrides;
+
+            SpecializationConstants specialization;
 
             static Config Defaults();
         };
 
         GraphicsPipeline(const Device &device, const std::vector<ShaderInfo> &shaders, const Config &config);
 
-        static void BuildGraphicsPipelines(const Device &device, const std::vector<GraphicsPipeline *> &pipelines);
+        // the pipeline cache is internally synchronised, so builds may run on several threads at once
+        static void BuildGraphicsPipelines(const Device &device, const PipelineCache &cache, const std::vector<GraphicsPipeline *> &pipelines);
+
+        // the (shared) layout of the given set, or VK_NULL_HANDLE if the shaders declare no such set
+        VkDescriptorSetLayout GetSetLayout(uint32_t set) const;
 
     private:
         void _BuildLayout() override;
@@ -49,8 +57,14 @@ namespace mcvk::Renderer {
 
         Config _config;
 
+        std::vector<VkDescriptorSetLayout> _set_layouts;
+
         std::vector<VkPipelineShaderStageCreateInfo> _shader_stages;
 
+        std::vector<VkSpecializationMapEntry> _specialization_entries;
+        std::vector<uint32_t> _specialization_data;
+        VkSpecializationInfo _specialization_info{};
+
         std::vector<VkVertexInputBindingDescription> _vertex_bindings;
         std::vector<VkVertexInputAttributeDescription> _vertex_attribs;
         VkPipelineVertexInputStateCreateInfo _vertex_input_info{};
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "layout_cache.hpp"
+
+#include "renderer/device.hpp"
+#include "utils/hash.hpp"
+#include "utils/log.hpp"
+
+namespace mcvk::Renderer {
+    size_t LayoutCache::_SetKeyHash::operator()(const std::vector<SetBinding> &bindings) const {
+        size_t seed = bindings.size();
+        for (const SetBinding &b : bindings) {
+            Utils::HashCombine(seed, b.binding, b.type, b.count, b.stages, b.immutable_sampler);
+        }
+        return seed;
+    }
+
+    bool LayoutCache::_PipelineKey::operator==(const _PipelineKey &other) const {
+        if (set_layouts != other.set_layouts || push_constant_ranges.size() != other.push_constant_ranges.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < push_constant_ranges.size(); i++) {
+            const VkPushConstantRange &a = push_constant_ranges[i];
+            const VkPushConstantRange &b = other.push_constant_ranges[i];
+            if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t LayoutCache::_PipelineKeyHash::operator()(const _PipelineKey &key) const {
+        size_t seed = key.set_layouts.size();
+        for (VkDescriptorSetLayout layout : key.set_layouts) {
+            Utils::HashCombine(seed, layout);
+        }
+        for (const VkPushConstantRange &range : key.push_constant_ranges) {
+            Utils::HashCombine(seed, range.stageFlags, range.offset, range.size);
+        }
+        return seed;
+    }
+
+    LayoutCache::LayoutCache(const Device &device)
+        : _device{device} {
+    }
+
+    LayoutCache::~LayoutCache() {
+        for (auto &[key, layout] : _pipeline_layouts) {
+            vkDestroyPipelineLayout(_device.GetDevice(), layout, nullptr);
+        }
+        for (auto &[key, layout] : _set_layouts) {
+            vkDestroyDescriptorSetLayout(_device.GetDevice(), layout, nullptr);
+        }
+        for (VkSampler sampler : _retained_samplers) {
+            _device.GetSamplerCache().Release(sampler);
+        }
+    }
+
+    VkDescriptorSetLayout LayoutCache::GetSetLayout(const std::vector<SetBinding> &bindings) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _requests++;
+
+        auto it = _set_layouts.find(bindings);
+        if (it != _set_layouts.end()) {
+            _hits++;
+            return it->second;
+        }
+
+        // immutable samplers are given per descriptor, so each binding's sampler is repeated across its count
+        std::vector<std::vector<VkSampler>> samplers(bindings.size());
+        std::vector<VkDescriptorSetLayoutBinding> vk_bindings(bindings.size());
+        for (size_t i = 0; i < bindings.size(); i++) {
+            vk_bindings[i].binding = bindings[i].binding;
+            vk_bindings[i].descriptorType = bindings[i].type;
+            vk_bindings[i].descriptorCount = bindings[i].count;
+            vk_bindings[i].stageFlags = bindings[i].stages;
+            if (bindings[i].immutable_sampler) {
+                samplers[i].assign(bindings[i].count, bindings[i].immutable_sampler);
+                vk_bindings[i].pImmutableSamplers = samplers[i].data();
+            }
+        }
+
+        VkDescriptorSetLayoutCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        info.bindingCount = static_cast<uint32_t>(vk_bindings.size());
+        info.pBindings = vk_bindings.data();
+
+        VkDescriptorSetLayout layout;
+        if (vkCreateDescriptorSetLayout(_device.GetDevice(), &info, nullptr, &layout) != VK_SUCCESS) {
+            Utils::Fatal("Failed to create descriptor set layout");
+        }
+
+        for (const SetBinding &b : bindings) {
+            if (b.immutable_sampler && _device.GetSamplerCache().Retain(b.immutable_sampler)) {
+                _retained_samplers.push_back(b.immutable_sampler);
+            }
+        }
+
+        _set_layouts.emplace(bindings, layout);
+        return layout;
+    }
+
+    VkPipelineLayout LayoutCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout> &set_layouts,
+        const std::vector<VkPushConstantRange> &push_constant_ranges) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _requests++;
+
+        _PipelineKey key{ set_layouts, push_constant_ranges };
+
+        auto it = _pipeline_layouts.find(key);
+        if (it != _pipeline_layouts.end()) {
+            _hits++;
+            return it->second;
+        }
+
+        VkPipelineLayoutCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        info.setLayoutCount = static_cast<uint32_t>(set_layouts.size());
+        info.pSetLayouts = set_layouts.data();
+        info.pushConstantRangeCount = static_cast<uint32_t>(push_constant_ranges.size());
+        info.pPushConstantRanges = push_constant_ranges.data();
+
+        VkPipelineLayout layout;
+        if (vkCreatePipelineLayout(_device.GetDevice(), &info, nullptr, &layout) != VK_SUCCESS) {
+            Utils::Fatal("Failed to create pipeline layout");
+        }
+
+        _pipeline_layouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    void LayoutCache::LogStats() const {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        Utils::Info("Layout cache: " + std::to_string(_set_layouts.size()) + " set layouts and " +
+            std::to_string(_pipeline_layouts.size()) + " pipeline layouts live, " + std::to_string(_hits) + " of " +
+            std::to_string(_requests) + " requests shared an existing layout");
+    }
+}
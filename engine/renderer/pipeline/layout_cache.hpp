@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <volk/volk.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace mcvk::Renderer {
+    class Device;
+
+    // what reflection can't tell from SPIR-V: whether a uniform or storage buffer is bound with a dynamic offset, and whether a
+    // sampler (from the sampler cache) should be baked into the layout
+    struct DescriptorBindingOverride {
+        uint32_t set;
+        uint32_t binding;
+        bool dynamic{false};
+        VkSampler immutable_sampler{VK_NULL_HANDLE};
+    };
+
+    // Hands out descriptor set layouts and pipeline layouts shared between every pipeline asking for identical ones, so that
+    // pipelines with matching interfaces are layout-compatible and sets bound for one stay bound for the next. Layouts are cheap and
+    // few, so they are kept until the device is destroyed rather than reference counted.
+    class LayoutCache {
+    public:
+        struct SetBinding {
+            uint32_t binding;
+            VkDescriptorType type;
+            uint32_t count;
+            VkShaderStageFlags stages;
+            // used for every descriptor in the binding; must come from the sampler cache, and is kept alive by the layout
+            VkSampler immutable_sampler{VK_NULL_HANDLE};
+
+            bool operator==(const SetBinding &other) const = default;
+        };
+
+        LayoutCache(const Device &device);
+        ~LayoutCache();
+
+        LayoutCache(const LayoutCache &) = delete;
+        LayoutCache &operator=(const LayoutCache &) = delete;
+
+        // bindings must be sorted by binding number
+        VkDescriptorSetLayout GetSetLayout(const std::vector<SetBinding> &bindings);
+        VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout> &set_layouts,
+            const std::vector<VkPushConstantRange> &push_constant_ranges);
+
+        void LogStats() const;
+
+    private:
+        struct _SetKeyHash {
+            size_t operator()(const std::vector<SetBinding> &bindings) const;
+        };
+
+        struct _PipelineKey {
+            std::vector<VkDescriptorSetLayout> set_layouts;
+            std::vector<VkPushConstantRange> push_constant_ranges;
+
+            bool operator==(const _PipelineKey &other) const;
+        };
+        struct _PipelineKeyHash {
+            size_t operator()(const _PipelineKey &key) const;
+        };
+
+        const Device &_device;
+
+        std::unordered_map<std::vector<SetBinding>, VkDescriptorSetLayout, _SetKeyHash> _set_layouts;
+        std::unordered_map<_PipelineKey, VkPipelineLayout, _PipelineKeyHash> _pipeline_layouts;
+        // references taken on immutable samplers, so that they (and their handles, which are part of the set layout keys) live as
+        // long as the layouts using them
+        std::vector<VkSampler> _retained_samplers;
+
+        uint64_t _requests{0};
+        uint64_t _hits{0};
+
+        mutable std::mutex _mutex;
+    };
+}
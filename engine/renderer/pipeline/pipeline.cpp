@@ -10,12 +10,11 @@
 namespace mcvk::Renderer {
     template<typename CreateInfoT>
     Pipeline<CreateInfoT>::Pipeline(const Device &device, const std::vector<ShaderInfo> &shaders)
-        : _device{device}, _shader_set{device.GetDevice(), shaders} {
+        : _device{device}, _shader_set{device, shaders} {
     }
 
     template<typename CreateInfoT>
     Pipeline<CreateInfoT>::~Pipeline() {
-        vkDestroyPipelineLayout(_device.GetDevice(), _layout, nullptr);
         vkDestroyPipeline(_device.GetDevice(), _pipeline, nullptr);
     }
 
@@ -34,6 +34,7 @@ namespace mcvk::Renderer {
 
         ShaderSet _shader_set;
 
+        // owned by the device's layout cache
         VkPipelineLayout _layout;
         VkPipeline _pipeline;
 
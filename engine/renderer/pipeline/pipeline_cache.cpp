@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "pipeline_cache.hpp"
+
+#include "renderer/device.hpp"
+
+#include "utils/hash.hpp"
+#include "utils/log.hpp"
+
+#include <cstring>
+#include <fstream>
+
+namespace mcvk::Renderer {
+    static constexpr char __MAGIC[8] = { 'M', 'C', 'V', 'K', 'P', 'S', 'O', '\0' };
+    static constexpr uint32_t __VERSION = 1;
+
+    // wraps the driver's data, which drivers don't all check thoroughly before trusting
+    struct __FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t data_size;
+        uint64_t checksum;
+    };
+
+    // the header every driver's cache data begins with (VkPipelineCacheHeaderVersionOne)
+    struct __CacheDataHeader {
+        uint32_t header_size;
+        uint32_t header_version;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint8_t uuid[VK_UUID_SIZE];
+    };
+
+    PipelineCache::PipelineCache(const Device &device, const std::filesystem::path &path)
+        : _device{device}, _path{path} {
+        std::vector<uint8_t> data;
+        _warm = _Load(data);
+
+        VkPipelineCacheCreateInfo create_info{};
+        create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        create_info.initialDataSize = _warm ? data.size() : 0;
+        create_info.pInitialData = _warm ? data.data() : nullptr;
+
+        if (vkCreatePipelineCache(_device.GetDevice(), &create_info, nullptr, &_cache) != VK_SUCCESS) {
+            // not fatal; pipelines are just built without a cache
+            Utils::Warn("Failed to create pipeline cache");
+            _cache = VK_NULL_HANDLE;
+            _warm = false;
+            return;
+        }
+
+        if (_warm) {
+            Utils::Info("Loaded " + std::to_string(data.size()) + " bytes of pipeline cache from \"" + _path.string() + "\"");
+        }
+    }
+
+    PipelineCache::~PipelineCache() {
+        Save();
+        vkDestroyPipelineCache(_device.GetDevice(), _cache, nullptr);
+    }
+
+    bool PipelineCache::Save() const {
+        if (!_cache) {
+            return false;
+        }
+
+        size_t size = 0;
+        if (vkGetPipelineCacheData(_device.GetDevice(), _cache, &size, nullptr) != VK_SUCCESS) {
+            Utils::Warn("Failed to get pipeline cache data size");
+            return false;
+        }
+        std::vector<uint8_t> data(size);
+        if (vkGetPipelineCacheData(_device.GetDevice(), _cache, &size, data.data()) != VK_SUCCESS) {
+            Utils::Warn("Failed to get pipeline cache data");
+            return false;
+        }
+        data.resize(size);
+
+        std::error_code err;
+        std::filesystem::create_directories(_path.parent_path(), err);
+
+        // written to the side and moved into place, so an interrupted write never leaves a truncated cache file behind
+        std::filesystem::path temp = _path;
+        temp += ".tmp";
+
+        {
+            std::ofstream file{temp, std::ios::binary | std::ios::trunc};
+            if (!file) {
+                Utils::Warn("Failed to open pipeline cache file \"" + temp.string() + "\" for writing");
+                return false;
+            }
+
+            __FileHeader header{};
+            std::memcpy(header.magic, __MAGIC, sizeof(__MAGIC));
+            header.version = __VERSION;
+            header.data_size = data.size();
+            header.checksum = Utils::HashBytes(data.data(), data.size());
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+            file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+            if (!file) {
+                Utils::Warn("Failed to write pipeline cache file \"" + temp.string() + "\"");
+                return false;
+            }
+        }
+
+        std::filesystem::rename(temp, _path, err);
+        if (err) {
+            Utils::Warn("Failed to move pipeline cache file into place at \"" + _path.string() + "\": " + err.message());
+            return false;
+        }
+
+        Utils::Info("Saved " + std::to_string(data.size()) + " bytes of pipeline cache to \"" + _path.string() + "\"");
+        return true;
+    }
+
+    bool PipelineCache::_Load(std::vector<uint8_t> &data) const {
+        std::ifstream file{_path, std::ios::binary};
+        if (!file) {
+            // first run
+            return false;
+        }
+
+        __FileHeader header{};
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!file || std::memcmp(header.magic, __MAGIC, sizeof(__MAGIC)) != 0 || header.version != __VERSION) {
+            Utils::Warn("Ignoring pipeline cache file \"" + _path.string() + "\" with unrecognised format");
+            return false;
+        }
+
+        data.resize(static_cast<size_t>(header.data_size));
+        file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(header.data_size));
+        if (!file || Utils::HashBytes(data.data(), data.size()) != header.checksum) {
+            Utils::Warn("Ignoring corrupt pipeline cache file \"" + _path.string() + "\"");
+            return false;
+        }
+
+        __CacheDataHeader cache_header{};
+        if (data.size() < sizeof(cache_header)) {
+            Utils::Warn("Ignoring corrupt pipeline cache file \"" + _path.string() + "\"");
+            return false;
+        }
+        std::memcpy(&cache_header, data.data(), sizeof(cache_header));
+
+        // a cache from another device or driver version would at best be ignored by the driver, so it is dropped here
+        const VkPhysicalDeviceProperties &props = _device.GetProperties();
+        if (cache_header.header_version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || cache_header.header_size < sizeof(cache_header) ||
+            cache_header.vendor_id != props.vendorID || cache_header.device_id != props.deviceID ||
+            std::memcmp(cache_header.uuid, props.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            Utils::Info("Pipeline cache file \"" + _path.string() + "\" was written by a different device or driver; starting cold");
+            return false;
+        }
+
+        return true;
+    }
+}
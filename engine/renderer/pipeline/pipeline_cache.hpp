@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <volk/volk.h>
+
+#include <filesystem>
+#include <vector>
+
+namespace mcvk::Renderer {
+    class Device;
+
+    // A VkPipelineCache persisted to disk between runs, so that pipelines compiled once are loaded rather than recompiled on
+    // later launches. The file is only used if it was written by the same driver for the same device (matching vendor and device
+    // IDs and pipeline cache UUID) and is intact; otherwise the cache starts empty. The cache is written back when destroyed.
+    class PipelineCache {
+    public:
+        PipelineCache(const Device &device, const std::filesystem::path &path);
+        ~PipelineCache();
+
+        PipelineCache(const PipelineCache &) = delete;
+        PipelineCache &operator=(const PipelineCache &) = delete;
+
+        inline const VkPipelineCache &GetCache() const { return _cache; }
+        // true if the cache was seeded from a file written by an earlier run
+        inline bool IsWarm() const { return _warm; }
+
+        // write the cache's current contents to disk, replacing the file atomically
+        bool Save() const;
+
+    private:
+        bool _Load(std::vector<uint8_t> &data) const;
+
+        const Device &_device;
+        std::filesystem::path _path;
+
+        VkPipelineCache _cache{VK_NULL_HANDLE};
+        bool _warm{false};
+    };
+}
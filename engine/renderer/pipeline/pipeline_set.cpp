@@ -10,52 +10,182 @@
 #include "utils/log.hpp"
 
 namespace mcvk::Renderer {
-    PipelineSet::PipelineSet(const Device &device, const std::unique_ptr<Swapchain> &swapchain, const ResourceMgr::ResourceManager &resmgr)
-        : _device{device}, _swapchain{swapchain}, _resmgr{resmgr} {
+    // every combination of the constants' values, the first being made of each constant's first value
+    static std::vector<SpecializationConstants> __ExpandVariants(const std::map<uint32_t, std::vector<uint32_t>> &specialization) {
+        std::vector<SpecializationConstants> variants{ {} };
+        for (const auto &[id, values] : specialization) {
+            std::vector<SpecializationConstants> expanded;
+            expanded.reserve(variants.size() * values.size());
+            for (const SpecializationConstants &variant : variants) {
+                for (uint32_t value : values) {
+                    expanded.push_back(variant);
+                    expanded.back()[id] = value;
+                }
+            }
+            variants = std::move(expanded);
+        }
+        return variants;
     }
 
-    void PipelineSet::_Initialise(const std::vector<VkDescriptorSetLayout> &set_layouts) {
-        _CreateGraphicsPipelines(set_layouts);
+    PipelineSet::PipelineSet(const Device &device, const PipelineCache &cache, const std::unique_ptr<RenderTarget> &target,
+        const ResourceMgr::ResourceManager &resmgr)
+        : _device{device}, _cache{cache}, _target{target}, _resmgr{resmgr} {
     }
 
-    void PipelineSet::_CreateGraphicsPipelines(const std::vector<VkDescriptorSetLayout> &set_layouts) {
-        // find and parse pipeline config resources
-        std::vector<ResourceMgr::PipelineResource> pipeline_resources;
-        uint32_t i = 0;
-        for (const auto &confname : ResourceMgr::ResourceManager::GetAllFilenamesInDir(_resmgr.GetPipelineResourcesDir())) {
-            ResourceMgr::PipelineResource res{};
-            if (!_resmgr.Load(confname, res)) {
-                Utils::Warn("Found pipeline config with filename " + confname + " but failed to parse it. Skipping...");
-                continue;
-            }
-            pipeline_resources.push_back(res);
+    std::string PipelineSet::VariantName(const std::string &name, const SpecializationConstants &constants) {
+        if (constants.empty()) {
+            return name;
         }
 
-        auto graphics_config = GraphicsPipeline::Config::Defaults();
-        graphics_config.render_pass = _swapchain->GetRenderPass();
-        graphics_config.set_layouts = set_layouts;
+        std::string variant = name + "{";
+        for (const auto &[id, value] : constants) {
+            variant += std::to_string(id) + "=" + std::to_string(value) + ",";
+        }
+        variant.back() = '}';
+        return variant;
+    }
+
+    const GraphicsPipeline &PipelineSet::GraphicsByName(const std::string &name) const {
+        const _GraphicsEntry *entry = _FindGraphics(name);
+        if (!entry) {
+            Utils::Fatal("No graphics pipeline named " + name);
+        }
+
+        // rethrows if the build failed
+        entry->ready.get();
+        return *entry->pipeline;
+    }
+
+    bool PipelineSet::IsGraphicsReady(const std::string &name) const {
+        const _GraphicsEntry *entry = _FindGraphics(name);
+        return entry && entry->ready.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+    }
+
+    const PipelineSet::_GraphicsEntry *PipelineSet::_FindGraphics(const std::string &name) const {
+        auto def = _graphics_defaults.find(name);
+        auto it = _graphics_pipelines.find(def != _graphics_defaults.end() ? def->second : name);
+        return it != _graphics_pipelines.end() ? &it->second : nullptr;
+    }
+
+    void PipelineSet::_Initialise(const std::vector<DescriptorBindingOverride> &binding_overrides) {
+        _CreateGraphicsPipelines(binding_overrides);
+    }
+
+    void PipelineSet::_WaitForBackgroundBuilds() {
+        _workers.Wait();
+    }
+
+    void PipelineSet::_CreateGraphicsPipelines(const std::vector<DescriptorBindingOverride> &binding_overrides) {
+        _build_start = std::chrono::steady_clock::now();
 
-        for (const auto &res : pipeline_resources) {
+        // find and parse pipeline configs, and the shader configs they use, in parallel
+        struct LoadedConfig {
+            ResourceMgr::PipelineResource res;
             ResourceMgr::ShaderResource shader;
-            if (!_resmgr.Load(res.shader_name, shader)) {
-                Utils::Warn("Failed to load shader " + res.shader_name + " for pipeline " + res.name + ". Skipping...");
-                continue;
-            }
+            bool valid{false};
+        };
+
+        std::vector<std::string> confnames = ResourceMgr::ResourceManager::GetAllFilenamesInDir(_resmgr.GetPipelineResourcesDir());
+        std::vector<LoadedConfig> configs(confnames.size());
+        for (size_t i = 0; i < confnames.size(); i++) {
+            _workers.Submit([this, &confname = confnames[i], &conf = configs[i]]() {
+                if (!_resmgr.Load(confname, conf.res)) {
+                    Utils::Warn("Found pipeline config with filename " + confname + " but failed to parse it. Skipping...");
+                    return;
+                }
+                if (!_resmgr.Load(conf.res.shader_name, conf.shader)) {
+                    Utils::Warn("Failed to load shader " + conf.res.shader_name + " for pipeline " + conf.res.name + ". Skipping...");
+                    return;
+                }
+                conf.valid = true;
+            });
+        }
+        _workers.Wait();
+
+        auto graphics_config = GraphicsPipeline::Config::Defaults();
+        graphics_config.render_pass = _target->GetRenderPass();
+        graphics_config.binding_overrides = binding_overrides;
+
+        struct BuildJob {
+            _GraphicsEntry *entry;
+            const std::vector<ShaderInfo> *shaders;
+            GraphicsPipeline::Config config;
+            std::shared_ptr<std::promise<void>> promise;
+            bool background;
+        };
+
+        // startup pipelines are queued first, so that workers only move on to background ones once they have all been picked up
+        std::vector<BuildJob> jobs;
+        for (auto priority : { ResourceMgr::PipelineResource::Priority::Startup, ResourceMgr::PipelineResource::Priority::Background }) {
+            for (const LoadedConfig &conf : configs) {
+                if (!conf.valid || conf.res.type != ResourceMgr::PipelineResource::Type::Graphics || conf.res.priority != priority) {
+                    continue;
+                }
+                if (_graphics_pipelines.contains(conf.res.name) || _graphics_defaults.contains(conf.res.name)) {
+                    Utils::Warn("Found more than one pipeline named " + conf.res.name + ". Skipping...");
+                    continue;
+                }
+
+                // one pipeline per combination of specialization constants, each compiled without the branches the others take
+                std::vector<SpecializationConstants> variants = __ExpandVariants(conf.res.specialization);
+                if (!variants.front().empty()) {
+                    _graphics_defaults[conf.res.name] = VariantName(conf.res.name, variants.front());
+                }
 
-            if (res.type == ResourceMgr::PipelineResource::Type::Graphics) {
-                graphics_config.rasterization_info.polygonMode = res.polygon_mode;
-                graphics_config.rasterization_info.cullMode = res.cull_mode;
+                for (SpecializationConstants &variant : variants) {
+                    BuildJob job{};
+                    job.entry = &_graphics_pipelines[VariantName(conf.res.name, variant)];
+                    job.shaders = &conf.shader.shaders;
+                    job.config = graphics_config;
+                    job.config.rasterization_info.polygonMode = conf.res.polygon_mode;
+                    job.config.rasterization_info.cullMode = conf.res.cull_mode;
+                    job.config.specialization = std::move(variant);
+                    job.promise = std::make_shared<std::promise<void>>();
+                    job.background = priority == ResourceMgr::PipelineResource::Priority::Background;
 
-                _graphics_pipelines.emplace(res.name, std::make_unique<GraphicsPipeline>(_device, shader.shaders, graphics_config));
+                    job.entry->ready = job.promise->get_future().share();
+                    jobs.push_back(std::move(job));
+                }
             }
         }
 
-        // construct vector of 'unsafe' pipeline pointers (i know this is stupid but if I change any of the types I just get errors so oh well!!!)
-        std::vector<GraphicsPipeline *> graphics_pipeline_ptrs(_graphics_pipelines.size());
-        i = 0;
-        for (const auto &p : _graphics_pipelines) {
-            graphics_pipeline_ptrs[i++] = &*(p.second);
-        };
-        GraphicsPipeline::BuildGraphicsPipelines(_device, graphics_pipeline_ptrs);
+        // counted up front so that the count can't reach zero while background builds are still being queued
+        std::vector<std::shared_future<void>> startup;
+        for (const BuildJob &job : jobs) {
+            if (job.background) {
+                _background_remaining++;
+            } else {
+                startup.push_back(job.entry->ready);
+            }
+        }
+
+        for (BuildJob &job : jobs) {
+            // configs are gone by the time background builds run, so shaders are copied into the task
+            _workers.Submit([this, entry = job.entry, shaders = *job.shaders, config = std::move(job.config), promise = job.promise,
+                background = job.background]() {
+                try {
+                    entry->pipeline = std::make_unique<GraphicsPipeline>(_device, shaders, config);
+                    GraphicsPipeline::BuildGraphicsPipelines(_device, _cache, { entry->pipeline.get() });
+                    promise->set_value();
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+
+                if (background && --_background_remaining == 0) {
+                    std::chrono::duration<double, std::milli> build_time = std::chrono::steady_clock::now() - _build_start;
+                    Utils::Info("Finished compiling background graphics pipelines after " + std::to_string(build_time.count()) + " ms");
+                }
+            });
+        }
+
+        // failures to build pipelines needed for the first frame are fatal, as before
+        for (const std::shared_future<void> &ready : startup) {
+            ready.get();
+        }
+
+        std::chrono::duration<double, std::milli> build_time = std::chrono::steady_clock::now() - _build_start;
+        Utils::Info("Built " + std::to_string(startup.size()) + " graphics pipelines in " + std::to_string(build_time.count()) + " ms (" +
+            (_cache.IsWarm() ? "warm" : "cold") + " pipeline cache, " + std::to_string(_workers.GetThreadCount()) + " workers); " +
+            std::to_string(jobs.size() - startup.size()) + " more compiling in the background");
     }
 }
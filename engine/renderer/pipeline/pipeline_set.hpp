@@ -8,32 +8,74 @@
 #pragma once
 
 #include "renderer/pipeline/graphics_pipeline.hpp"
+#include "renderer/pipeline/pipeline_cache.hpp"
 #include "renderer/device.hpp"
-#include "renderer/swapchain.hpp"
+#include "renderer/render_target.hpp"
 
 #include "resource_mgr/resource_mgr.hpp"
+#include "utils/thread_pool.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <memory>
 #include <unordered_map>
 
 namespace mcvk::Renderer {
+    // Every pipeline described by the pipeline resources. Configs are parsed, and shader modules and pipelines created, on a pool
+    // of workers; pipelines with startup priority are ready once the set is initialised, while background ones keep compiling
+    // after it returns.
     struct PipelineSet {
     public:
-        PipelineSet(const Device &device, const std::unique_ptr<Swapchain> &swapchain, const ResourceMgr::ResourceManager &resmgr);
+        PipelineSet(const Device &device, const PipelineCache &cache, const std::unique_ptr<RenderTarget> &target,
+            const ResourceMgr::ResourceManager &resmgr);
 
-        inline const GraphicsPipeline &GraphicsByName(const std::string &name) const { return *(_graphics_pipelines.at(name)); }
+        // name of the variant of a pipeline built with the given specialization constants; a pipeline's own name refers to its
+        // default variant, i.e. the one built with the first value listed for each constant
+        static std::string VariantName(const std::string &name, const SpecializationConstants &constants);
+
+        // blocks until the pipeline is built if it is still compiling in the background
+        const GraphicsPipeline &GraphicsByName(const std::string &name) const;
+        // every constant the pipeline is specialized with must be given
+        inline const GraphicsPipeline &GraphicsByName(const std::string &name, const SpecializationConstants &constants) const {
+            return GraphicsByName(VariantName(name, constants));
+        }
+        // false while the pipeline is still compiling
+        bool IsGraphicsReady(const std::string &name) const;
 
     private:
         friend class Renderer;
 
-        void _Initialise(const std::vector<VkDescriptorSetLayout> &set_layouts);
-        void _CreateGraphicsPipelines(const std::vector<VkDescriptorSetLayout> &set_layouts);
+        struct _GraphicsEntry {
+            std::unique_ptr<GraphicsPipeline> pipeline;
+            // holds the exception if the pipeline failed to build
+            std::shared_future<void> ready;
+        };
+
+        // null if there is no such pipeline
+        const _GraphicsEntry *_FindGraphics(const std::string &name) const;
+
+        void _Initialise(const std::vector<DescriptorBindingOverride> &binding_overrides);
+        void _CreateGraphicsPipelines(const std::vector<DescriptorBindingOverride> &binding_overrides);
+        // background builds are compiled against the render target's render pass, so this must be called before the target is
+        // destroyed or replaced
+        void _WaitForBackgroundBuilds();
 
         const Device &_device;
-        const std::unique_ptr<Swapchain> &_swapchain;
+        const PipelineCache &_cache;
+        const std::unique_ptr<RenderTarget> &_target;
         const ResourceMgr::ResourceManager &_resmgr;
 
-        typedef std::unique_ptr<GraphicsPipeline> GraphicsPipelinePtr;
-        std::unordered_map<std::string, GraphicsPipelinePtr> _graphics_pipelines;
+        // entries are all added before any build starts, so workers can fill them in without locking
+        std::unordered_map<std::string, _GraphicsEntry> _graphics_pipelines;
+        // names of specialized pipelines to their default variants
+        std::unordered_map<std::string, std::string> _graphics_defaults;
+
+        std::chrono::steady_clock::time_point _build_start;
+        std::atomic<uint32_t> _background_remaining{0};
+
+        // declared last so that it finishes any background builds before the pipelines are destroyed; separate from the resource
+        // manager's pool so that waiting on that never waits on compiles
+        Utils::ThreadPool _workers;
     };
 }
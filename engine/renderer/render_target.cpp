@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "render_target.hpp"
+
+#include "renderer/frame_graph.hpp"
+
+#include "utils/log.hpp"
+
+#include <volk/volk.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace mcvk::Renderer {
+    RenderTarget::RenderTarget(const Device &device, VkExtent2D extent, uint32_t frames_in_flight)
+        : _device{device}, _extent{extent}, _frames_in_flight{frames_in_flight} {
+    }
+
+    RenderTarget::~RenderTarget() {
+        for (VkFence f : _frame_fences) {
+            vkDestroyFence(_device.GetDevice(), f, nullptr);
+        }
+
+        for (auto framebuffer : _framebuffers) {
+            vkDestroyFramebuffer(_device.GetDevice(), framebuffer, nullptr);
+        }
+        vkDestroyFramebuffer(_device.GetDevice(), _scene_framebuffer, nullptr);
+
+        vkDestroyRenderPass(_device.GetDevice(), _render_pass, nullptr);
+        vkDestroyRenderPass(_device.GetDevice(), _scene_render_pass, nullptr);
+    }
+
+    void RenderTarget::SetRenderScale(float scale) {
+        scale = _upscale_supported ? std::clamp(scale, MIN_RENDER_SCALE, 1.0f) : 1.0f;
+        if (scale < 1.0f && !_scene_image) {
+            _CreateSceneImage();
+        }
+        _render_scale = scale;
+    }
+
+    VkExtent2D RenderTarget::GetRenderExtent() const {
+        if (_render_scale >= 1.0f) {
+            return _extent;
+        }
+        return {
+            std::max(1u, static_cast<uint32_t>(std::lround(_extent.width * _render_scale))),
+            std::max(1u, static_cast<uint32_t>(std::lround(_extent.height * _render_scale))) };
+    }
+
+    const VkRenderPass &RenderTarget::GetFrameRenderPass() const {
+        return _render_scale < 1.0f ? _scene_render_pass : _render_pass;
+    }
+
+    const VkFramebuffer &RenderTarget::GetFramebuffer(uint32_t index) const {
+        return _render_scale < 1.0f ? _scene_framebuffer : _framebuffers[index];
+    }
+
+    void RenderTarget::RecordUpscale(VkCommandBuffer cmdbuf, uint32_t index) const {
+        if (_render_scale >= 1.0f) {
+            return;
+        }
+
+        VkImage src = _scene_image->GetImage();
+        VkImage dst = _colour_images[index]->GetImage();
+        VkExtent2D src_extent = GetRenderExtent();
+
+        VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+        // the scene render pass leaves the scene image ready to be read. The target image's old contents are discarded, and
+        // waiting on colour output also chains onto the wait for the swapchain image
+        FrameGraph graph;
+        FrameGraph::Resource scene = graph.ImportImage(src, range,
+            { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL });
+        FrameGraph::Resource target = graph.ImportImage(dst, range,
+            { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED });
+        // leave the image as the render pass would have (presentation and readback are synchronised by semaphore and barrier)
+        graph.MarkOutput(target, { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, _final_layout });
+
+        graph.AddPass("upscale", [&](VkCommandBuffer cmdbuf) {
+                VkImageBlit blit{};
+                blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+                blit.srcOffsets[1] = { static_cast<int32_t>(src_extent.width), static_cast<int32_t>(src_extent.height), 1 };
+                blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+                blit.dstOffsets[1] = { static_cast<int32_t>(_extent.width), static_cast<int32_t>(_extent.height), 1 };
+                vkCmdBlitImage(cmdbuf, src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                    VK_FILTER_LINEAR);
+            })
+            .Read(scene, { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL })
+            .Write(target, { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL });
+
+        graph.Execute(cmdbuf);
+    }
+
+    void RenderTarget::_CreateDepthImage() {
+        _depth_format = _device.FindSupportedFormat(
+            { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+        // contents are only ever cleared and discarded within the render pass, so tile-based devices need never back the image
+        // with real memory
+        auto config = Image::Config::Defaults(_extent, _depth_format);
+        config.image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        config.view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        config.mem_props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        config.category = MemoryCategory::Attachment;
+
+        _depth_image = std::make_unique<Image>(_device, config);
+    }
+
+    void RenderTarget::_CreateRenderPass(VkImageLayout colour_final_layout) {
+        _final_layout = colour_final_layout;
+        _render_pass = _BuildRenderPass(colour_final_layout);
+
+        // identical apart from the final layout, so it is compatible with pipelines built against _render_pass
+        if (_upscale_supported) {
+            _scene_render_pass = _BuildRenderPass(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        }
+    }
+
+    void RenderTarget::_CreateFramebuffers() {
+        _framebuffers.resize(_colour_images.size());
+
+        for (size_t i = 0; i < _framebuffers.size(); i++) {
+            std::array<VkImageView, 2> attachments = {
+                _colour_images[i]->GetImageView(),
+                _depth_image->GetImageView() };
+
+            VkFramebufferCreateInfo info{};
+            info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            info.renderPass = _render_pass;
+            info.attachmentCount = static_cast<uint32_t>(attachments.size());
+            info.pAttachments = attachments.data();
+            info.width = _extent.width;
+            info.height = _extent.height;
+            info.layers = 1;
+
+            if (vkCreateFramebuffer(_device.GetDevice(), &info, nullptr, &_framebuffers[i]) != VK_SUCCESS) {
+                Utils::Fatal("Failed to create framebuffer for image attachment index " + std::to_string(i));
+            }
+        }
+    }
+
+    VkRenderPass RenderTarget::_BuildRenderPass(VkImageLayout colour_final_layout) const {
+        VkAttachmentDescription colour_attachment{};
+        colour_attachment.format = _colour_format;
+        colour_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colour_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colour_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colour_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colour_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colour_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colour_attachment.finalLayout = colour_final_layout;
+        VkAttachmentReference colour_attachment_ref{};
+        colour_attachment_ref.attachment = 0;
+        colour_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentDescription depth_attachment{};
+        depth_attachment.format = _depth_format;
+        depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        VkAttachmentReference depth_attachment_ref{};
+        depth_attachment_ref.attachment = 1;
+        depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colour_attachment_ref;
+        subpass.pDepthStencilAttachment = &depth_attachment_ref;
+
+        // the depth image is shared between frames in flight, so one frame's depth clear must wait for the previous frame's
+        // depth tests to finish writing to it; likewise the scene image, whose clear must wait for the last upscale to read it
+        VkSubpassDependency dependency{};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependency.dstSubpass = 0;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.dstStageMask =
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+        std::array<VkAttachmentDescription, 2> attachments = { colour_attachment, depth_attachment };
+
+        VkRenderPassCreateInfo render_pass_info{};
+        render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+        render_pass_info.pAttachments = attachments.data();
+        render_pass_info.subpassCount = 1;
+        render_pass_info.pSubpasses = &subpass;
+        render_pass_info.dependencyCount = 1;
+        render_pass_info.pDependencies = &dependency;
+
+        VkRenderPass render_pass;
+        if (vkCreateRenderPass(_device.GetDevice(), &render_pass_info, nullptr, &render_pass) != VK_SUCCESS) {
+            Utils::Fatal("Failed to create render pass");
+        }
+        return render_pass;
+    }
+
+    void RenderTarget::_CreateSceneImage() {
+        // sized for full scale, so the scale can change without recreating it
+        auto config = Image::Config::Defaults(_extent, _colour_format);
+        config.image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        config.mem_props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        config.category = MemoryCategory::Attachment;
+
+        _scene_image = std::make_unique<Image>(_device, config);
+
+        std::array<VkImageView, 2> attachments = {
+            _scene_image->GetImageView(),
+            _depth_image->GetImageView() };
+
+        VkFramebufferCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        info.renderPass = _scene_render_pass;
+        info.attachmentCount = static_cast<uint32_t>(attachments.size());
+        info.pAttachments = attachments.data();
+        info.width = _extent.width;
+        info.height = _extent.height;
+        info.layers = 1;
+
+        if (vkCreateFramebuffer(_device.GetDevice(), &info, nullptr, &_scene_framebuffer) != VK_SUCCESS) {
+            Utils::Fatal("Failed to create framebuffer for scaled scene image");
+        }
+    }
+
+    void RenderTarget::_CreateFrameFences() {
+        _frame_fences.resize(_frames_in_flight);
+
+        // created signalled, as no frame slot has been used yet
+        VkFenceCreateInfo fence_info{};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        for (VkFence &f : _frame_fences) {
+            if (vkCreateFence(_device.GetDevice(), &fence_info, nullptr, &f) != VK_SUCCESS) {
+                Utils::Fatal("Failed to create synchronisation primitives");
+            }
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include "renderer/resource/image.hpp"
+#include "renderer/device.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace mcvk::Renderer {
+    // Something frames are drawn into: a set of colour images sharing one depth attachment and render pass, cycled through by up
+    // to GetFramesInFlight() frames at once. The swapchain presents its images to a window; an offscreen target keeps them, so the
+    // renderer can run without a display.
+    class RenderTarget {
+    public:
+        static constexpr float MIN_RENDER_SCALE = 0.25f;
+
+        RenderTarget(const Device &device, VkExtent2D extent, uint32_t frames_in_flight);
+        virtual ~RenderTarget();
+
+        RenderTarget(const RenderTarget &) = delete;
+        RenderTarget &operator=(const RenderTarget &) = delete;
+
+        // pipelines are built against this; it is compatible with every render pass frames are drawn with
+        inline const VkRenderPass &GetRenderPass() const { return _render_pass; }
+        inline const VkExtent2D &GetExtent() const { return _extent; }
+        inline uint32_t GetCurrentFrame() const { return _current_frame; }
+        inline uint32_t GetFramesInFlight() const { return _frames_in_flight; }
+
+        inline const VkFormat GetColourImageFormat() const { return _colour_format; }
+        inline const VkFormat GetDepthImageFormat() const { return _depth_format; }
+
+        // Below 1, the scene is drawn into a corner of a full-size intermediate image and upscaled into the target image with a
+        // filtered blit, so the scale can change every frame without reallocating anything. At 1 the scene is drawn straight into
+        // the target image. Clamped to [MIN_RENDER_SCALE, 1], and always 1 if upscaling isn't supported; set between frames.
+        void SetRenderScale(float scale);
+        inline float GetRenderScale() const { return _render_scale; }
+        // true if the target's images can be blitted to with linear filtering
+        inline bool SupportsUpscale() const { return _upscale_supported; }
+        // the extent the scene is drawn at, i.e. the render area and viewport
+        VkExtent2D GetRenderExtent() const;
+
+        // render pass and framebuffer to draw the frame for the given image with, at the current render scale
+        const VkRenderPass &GetFrameRenderPass() const;
+        const VkFramebuffer &GetFramebuffer(uint32_t index) const;
+        // if the frame was drawn below full scale, record the upscale into the given image (after the render pass has ended)
+        void RecordUpscale(VkCommandBuffer cmdbuf, uint32_t index) const;
+
+        // waits for the current frame slot to be free, then selects the image to draw into
+        virtual VkResult AcquireNextImage(uint32_t *const image_index) = 0;
+        // submits the frame's command buffers (waiting on any upload semaphores) and moves on to the next frame slot
+        virtual VkResult SubmitCommandBuffers(const std::vector<VkCommandBuffer> &cmdbufs, const std::vector<VkSemaphore> &upload_sems,
+            uint32_t *const image_index) = 0;
+
+    protected:
+        // called by derived targets once _colour_format, _colour_images, and _upscale_supported are set
+        void _CreateDepthImage();
+        void _CreateRenderPass(VkImageLayout colour_final_layout);
+        void _CreateFramebuffers();
+        void _CreateFrameFences();
+
+        const Device &_device;
+
+        VkExtent2D _extent;
+        VkFormat _colour_format;
+        VkFormat _depth_format;
+
+        VkRenderPass _render_pass{VK_NULL_HANDLE};
+        std::vector<VkFramebuffer> _framebuffers;
+        // the layout target images are left in at the end of each frame
+        VkImageLayout _final_layout;
+
+        std::vector<std::unique_ptr<Image>> _colour_images;
+        // depth is never read after the render pass, so a single transient image is shared by every framebuffer
+        std::unique_ptr<Image> _depth_image;
+
+        // the CPU may record up to _frames_in_flight frames ahead of the GPU, each with its own fence
+        uint32_t _frames_in_flight;
+        uint32_t _current_frame{0};
+        std::vector<VkFence> _frame_fences;
+
+        bool _upscale_supported{false};
+
+    private:
+        VkRenderPass _BuildRenderPass(VkImageLayout colour_final_layout) const;
+        void _CreateSceneImage();
+
+        float _render_scale{1.0f};
+
+        // drawn into when below full scale; created the first time the scale is reduced. Like depth, it is shared by every frame
+        VkRenderPass _scene_render_pass{VK_NULL_HANDLE};
+        std::unique_ptr<Image> _scene_image;
+        VkFramebuffer _scene_framebuffer{VK_NULL_HANDLE};
+    };
+}
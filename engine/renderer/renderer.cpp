@@ -7,67 +7,200 @@
 
 #include "renderer.hpp"
 
+#include "renderer/offscreen_target.hpp"
+#include "renderer/swapchain.hpp"
 #include "renderer/window.hpp"
+#include "resource_mgr/image_load.hpp"
 #include "utils/log.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
 namespace mcvk::Renderer {
-    Renderer::Renderer(Window &window, const ResourceMgr::ResourceManager &resmgr)
+    Renderer::Config Renderer::Config::Defaults() {
+        Config config{};
+
+        config.frames_in_flight = 2;
+        config.render_scale = 1.0f;
+        config.frame_time_budget = 0.0f;
+
+        return config;
+    }
+
+    Renderer::Renderer(Window &window, const ResourceMgr::ResourceManager &resmgr, const Config &config)
+        : Renderer{&window, window.GetExtent(), resmgr, config} {
+    }
+
+    Renderer::Renderer(Window *window, VkExtent2D extent, const ResourceMgr::ResourceManager &resmgr, const Config &config)
         : _window{window},
         _instance_mgr{window},
         _surface{_instance_mgr.GetSurface()},
-        _device{window, _instance_mgr.GetInstance(), _surface},
-        _pipeline_set{_device, _swapchain, resmgr},
-        _draw_command_buffer{_device, _swapchain} {
-        _RecreateSwapchain();
+        _device{_instance_mgr.GetInstance(), _surface, _instance_mgr.HasPhysicalDeviceProperties2()},
+        _pipeline_cache{_device, resmgr.GetCacheDir() + "pipelines.bin"},
+        _pipeline_set{_device, _pipeline_cache, _target, resmgr},
+        _frames_in_flight{std::clamp(config.frames_in_flight, 1u, MAX_FRAMES_IN_FLIGHT)},
+        _max_render_scale{std::clamp(config.render_scale, RenderTarget::MIN_RENDER_SCALE, 1.0f)},
+        _frame_time_budget{config.frame_time_budget} {
+        if (_window) {
+            _RecreateSwapchain();
+        } else {
+            _target = std::make_unique<OffscreenTarget>(_device, extent, _frames_in_flight);
+        }
         _CreateCommandBuffers();
+
+        _dynamic_render_scale = _max_render_scale;
+        if ((_max_render_scale < 1.0f || _frame_time_budget > 0.0f) && !_target->SupportsUpscale()) {
+            Utils::Warn("Render target images can't be blitted to with linear filtering; rendering at full resolution");
+        }
     }
 
     Renderer::~Renderer() {
+        // the render target goes before the pipeline set, and pipelines still compiling use its render pass
+        _pipeline_set._WaitForBackgroundBuilds();
     }
 
-    void Renderer::BuildPipelines(const std::vector<VkDescriptorSetLayout> &set_layouts) {
-        _pipeline_set._Initialise(set_layouts);
+    void Renderer::BuildPipelines(const std::vector<DescriptorBindingOverride> &binding_overrides) {
+        _pipeline_set._Initialise(binding_overrides);
+    }
+
+    void Renderer::SetRenderScale(float scale) {
+        _max_render_scale = std::clamp(scale, RenderTarget::MIN_RENDER_SCALE, 1.0f);
+        _dynamic_render_scale = std::min(_dynamic_render_scale, _max_render_scale);
     }
 
     void Renderer::WaitDeviceIdle() {
-        vkDeviceWaitIdle(_device.GetDevice());
+        _device.WaitIdle();
+        _device.GetDeletionQueue().Advance(_frame_count, _frame_count);
     }
 
     CommandBuffer *Renderer::BeginDrawCommandBuffer() {
-        if (_draw_command_buffer._Begin()) {
-            return &_draw_command_buffer;
+        auto start = std::chrono::steady_clock::now();
+        if (_frame_count > 0) {
+            _frame_time_total += start - _last_frame_start;
+            _UpdateRenderScale(start - _last_frame_start);
+        }
+        _last_frame_start = start;
+
+        // each frame slot records into its own command buffer, which is free to reuse once the slot's fence has been waited on
+        CommandBuffer &cb = *_draw_command_buffers[_target->GetCurrentFrame()];
+        bool began = cb._Begin();
+
+        _begin_wait_total += std::chrono::steady_clock::now() - start;
+
+        if (began) {
+            _frame_count++;
+
+            // fixed for the whole frame, as both the render area and the upscale depend on it
+            _target->SetRenderScale(_frame_time_budget > 0.0f ? _dynamic_render_scale : _max_render_scale);
+            _render_scale_total += _target->GetRenderScale();
+
+            // this slot's fence has been waited on, so the frame that last used it (and every frame before it) is complete
+            uint64_t completed = _frame_count > _frames_in_flight ? _frame_count - _frames_in_flight : 0;
+            _device.GetDeletionQueue().Advance(_frame_count, completed);
+
+            return &cb;
         }
         return nullptr;
     }
 
+    float Renderer::GetAspectRatio() const {
+        const VkExtent2D &extent = _target->GetExtent();
+        return static_cast<float>(extent.width) / static_cast<float>(extent.height);
+    }
+
+    void Renderer::LogFrameStats() const {
+        if (_frame_count < 2) {
+            return;
+        }
+
+        using ms = std::chrono::duration<double, std::milli>;
+        double avg_frame = ms{_frame_time_total}.count() / static_cast<double>(_frame_count - 1);
+        double avg_wait = ms{_begin_wait_total}.count() / static_cast<double>(_frame_count);
+
+        std::stringstream stream{};
+        stream << "Rendered " << _frame_count << " frame(s) with " << _frames_in_flight << " frame(s) in flight:" << std::endl
+            << "	Average frame time " << avg_frame << " ms (" << (1000.0 / avg_frame) << " fps)" << std::endl
+            << "	Average time blocked waiting for a frame slot/image " << avg_wait << " ms" << std::endl
+            << "	Average render scale " << (_render_scale_total / static_cast<double>(_frame_count));
+
+        Utils::Info(stream.str());
+    }
+
+    bool Renderer::CaptureLastFrame(const std::string &path) const {
+        if (!_window) {
+            std::vector<uint8_t> pixels;
+            if (static_cast<const OffscreenTarget &>(*_target).ReadLastFrame(pixels)) {
+                return ResourceMgr::SaveImagePPM(path, pixels.data(), GetExtent().width, GetExtent().height);
+            }
+            Utils::Error("Cannot capture a frame before one has been rendered");
+        } else {
+            Utils::Error("Frames can only be captured when rendering headless");
+        }
+        return false;
+    }
+
     void Renderer::_RecreateSwapchain() {
-        VkExtent2D extent = _window.GetExtent();
+        VkExtent2D extent = _window->GetExtent();
         // block while window is minimised
         while (extent.width == 0 || extent.height == 0) {
-            extent = _window.GetExtent();
+            extent = _window->GetExtent();
             glfwWaitEvents();
         }
 
-        vkDeviceWaitIdle(_device.GetDevice());
+        _device.WaitIdle();
+        _device.GetDeletionQueue().Advance(_frame_count, _frame_count);
 
-        if (!_swapchain) {
-            _swapchain = std::make_unique<Swapchain>(_device, _surface, extent);
+        if (!_target) {
+            _target = std::make_unique<Swapchain>(_device, _surface, extent, _frames_in_flight);
         } else {
             // used to compare
-            VkFormat old_fmt_col = _swapchain->GetColourImageFormat();
-            VkFormat old_fmt_depth = _swapchain->GetDepthImageFormat();
+            VkFormat old_fmt_col = _target->GetColourImageFormat();
+            VkFormat old_fmt_depth = _target->GetDepthImageFormat();
+
+            // background pipeline builds use the old swapchain's render pass
+            _pipeline_set._WaitForBackgroundBuilds();
 
             // recreate from existing swapchain when possible
-            _swapchain = std::make_unique<Swapchain>(_device, _surface, extent, _swapchain);
+            std::unique_ptr<Swapchain> old{static_cast<Swapchain *>(_target.release())};
+            _target = std::make_unique<Swapchain>(_device, _surface, extent, _frames_in_flight, old);
 
-            if (old_fmt_col != _swapchain->GetColourImageFormat()
-                || old_fmt_depth != _swapchain->GetDepthImageFormat()) {
+            if (old_fmt_col != _target->GetColourImageFormat()
+                || old_fmt_depth != _target->GetDepthImageFormat()) {
                 Utils::Fatal("When recreating swap chain: image or depth buffer format has changed");
             }
         }
+
+        _window->CompleteResize();
+    }
+
+    void Renderer::_UpdateRenderScale(std::chrono::steady_clock::duration frame_time) {
+        if (_frame_time_budget <= 0.0f) {
+            return;
+        }
+
+        // smoothed, so that a single slow frame doesn't cause the resolution to jump
+        double ms = std::chrono::duration<double, std::milli>{frame_time}.count();
+        _smoothed_frame_time = _smoothed_frame_time > 0.0 ? _smoothed_frame_time * 0.9 + ms * 0.1 : ms;
+
+        // small errors are left alone, so the scale doesn't oscillate around the budget
+        double error = _smoothed_frame_time / _frame_time_budget;
+        if (error > 0.95 && error < 1.05) {
+            return;
+        }
+
+        // the number of pixels drawn (and so, roughly, GPU time) goes with the square of the scale; step a little at a time
+        double target = _dynamic_render_scale / std::sqrt(error);
+        target = std::clamp(target, _dynamic_render_scale * 0.95, _dynamic_render_scale * 1.05);
+        _dynamic_render_scale = std::clamp(static_cast<float>(target), RenderTarget::MIN_RENDER_SCALE, _max_render_scale);
     }
 
     void Renderer::_CreateCommandBuffers() {
-        _draw_command_buffer._Initialise(this);
+        _draw_command_buffers.resize(_frames_in_flight);
+
+        for (auto &cb : _draw_command_buffers) {
+            cb = std::make_unique<CommandBuffer>(_device, _target);
+            cb->_Initialise(this);
+        }
     }
 }
@@ -7,53 +7,113 @@
 
 #pragma once
 
+#include "renderer/pipeline/pipeline_cache.hpp"
 #include "renderer/pipeline/pipeline_set.hpp"
 #include "renderer/command_buffer.hpp"
 #include "renderer/device.hpp"
 #include "renderer/instance_manager.hpp"
-#include "renderer/swapchain.hpp"
+#include "renderer/render_target.hpp"
 #include "renderer/window.hpp"
 
 #include "resource_mgr/resource_mgr.hpp"
 
 #include <volk/volk.h>
 
+#include <chrono>
+#include <string>
 #include <vector>
 #include <memory>
 
 namespace mcvk::Renderer {
     class Renderer {
     public:
-        Renderer(Window &window, const ResourceMgr::ResourceManager &resmgr);
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+
+        struct Config {
+            // number of frames the CPU may record ahead of the GPU; clamped to [1, MAX_FRAMES_IN_FLIGHT]
+            uint32_t frames_in_flight;
+
+            // fraction of the output resolution the scene is drawn at before being upscaled; 1 draws at full resolution
+            float render_scale;
+            // if non-zero, the render scale is adjusted every frame to keep the frame time near this many milliseconds, going no
+            // higher than render_scale
+            float frame_time_budget;
+
+            static Config Defaults();
+        };
+
+        // presents to the window's surface
+        Renderer(Window &window, const ResourceMgr::ResourceManager &resmgr, const Config &config = Config::Defaults());
+        // presents to the window if there is one, otherwise renders offscreen at the given extent without needing a display
+        Renderer(Window *window, VkExtent2D extent, const ResourceMgr::ResourceManager &resmgr, const Config &config = Config::Defaults());
         ~Renderer();
 
         Renderer(const Renderer &) = delete;
         Renderer &operator=(const Renderer &) = delete;
 
-        void BuildPipelines(const std::vector<VkDescriptorSetLayout> &set_layouts);
+        // layouts are reflected from each pipeline's shaders; overrides apply to every pipeline that declares the binding
+        void BuildPipelines(const std::vector<DescriptorBindingOverride> &binding_overrides);
 
         inline const Device &GetDevice() const { return _device; }
         inline const PipelineSet &Pipelines() const { return _pipeline_set; }
+        inline uint32_t GetFramesInFlight() const { return _frames_in_flight; }
+        // index of the frame slot currently being (or about to be) recorded, for selecting per-frame resources
+        inline uint32_t GetCurrentFrame() const { return _target->GetCurrentFrame(); }
+        // number of frames begun so far; changes exactly once per frame regardless of how many frames are in flight
+        inline uint64_t GetFrameNumber() const { return _frame_count; }
+        inline bool IsHeadless() const { return !_window; }
+        inline const VkExtent2D &GetExtent() const { return _target->GetExtent(); }
+        float GetAspectRatio() const;
+
+        // takes effect from the next frame; the upper limit of the scale when a frame time budget is set
+        void SetRenderScale(float scale);
+        inline float GetRenderScale() const { return _target->GetRenderScale(); }
 
         void WaitDeviceIdle();
 
         CommandBuffer *BeginDrawCommandBuffer();
 
+        void LogFrameStats() const;
+
+        // headless only: write the most recently submitted frame out as a PPM image, waiting for it to be rendered first
+        bool CaptureLastFrame(const std::string &path) const;
+
     private:
         friend class CommandBuffer;
 
+        inline bool _WasResized() const { return _window && _window->WasResized(); }
         void _RecreateSwapchain();
+        void _UpdateRenderScale(std::chrono::steady_clock::duration frame_time);
         void _CreateCommandBuffers();
 
         InstanceManager _instance_mgr;
 
-        Window &_window;
+        // null when headless
+        Window *_window;
         const VkSurfaceKHR &_surface;
 
         Device _device;
+        // saved back to the resource cache directory on shutdown
+        PipelineCache _pipeline_cache;
         PipelineSet _pipeline_set;
 
-        std::unique_ptr<Swapchain> _swapchain;
-        CommandBuffer _draw_command_buffer;
+        uint32_t _frames_in_flight;
+
+        float _max_render_scale;
+        float _frame_time_budget;
+        // the scale chosen to meet the frame time budget, and the smoothed frame time (ms) it is chosen from
+        float _dynamic_render_scale{1.0f};
+        double _smoothed_frame_time{0.0};
+
+        // the swapchain, or an offscreen target when headless
+        std::unique_ptr<RenderTarget> _target;
+        std::vector<std::unique_ptr<CommandBuffer>> _draw_command_buffers;
+
+        // frame timing, measured between successive calls to BeginDrawCommandBuffer()
+        uint64_t _frame_count{0};
+        std::chrono::steady_clock::time_point _last_frame_start{};
+        std::chrono::steady_clock::duration _frame_time_total{0};
+        std::chrono::steady_clock::duration _begin_wait_total{0};
+        double _render_scale_total{0.0};
     };
 }
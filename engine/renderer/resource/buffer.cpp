@@ -7,7 +7,6 @@
 
 #include "buffer.hpp"
 
-#include "renderer/command_buffer.hpp"
 #include "renderer/renderer.hpp"
 #include "utils/log.hpp"
 
@@ -20,39 +19,20 @@ namespace mcvk::Renderer {
         : _device{device}, _size{size} {
     }
 
-    Buffer::Buffer(const Device &device, VkDeviceSize size, VkBufferUsageFlags usage)
-        : _device{device}, _size{size} {
-        // if graphics and transfer queues are in different families, then concurrently share data between those families
-        QueueFamilyIndices families = _device.FindQueueFamilyIndices();
-        if (families.graphics != families.transfer) {
-            _sharing_mode = VK_SHARING_MODE_CONCURRENT;
-            _queue_families = {
-                families.graphics.value(),
-                families.transfer.value() };
-        }
-        _CreateBuffer(&_stage, &_stage_memory, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-
-        _CreateBuffer(&_buffer, &_memory, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    Buffer::Buffer(const Device &device, VkDeviceSize size, VkBufferUsageFlags usage, MemoryCategory category, bool allow_direct)
+        : _device{device}, _size{size}, _allow_direct{allow_direct} {
+        _CreateBuffer(&_buffer, &_allocation, _size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, 0, category);
     }
 
     Buffer::~Buffer() {
-        if (_stage != VK_NULL_HANDLE) {
-            vkDestroyBuffer(_device.GetDevice(), _stage, nullptr);
-            vkFreeMemory(_device.GetDevice(), _stage_memory, nullptr);
-        }
-
         if (_buffer != VK_NULL_HANDLE) {
-            vkDestroyBuffer(_device.GetDevice(), _buffer, nullptr);
-            vkFreeMemory(_device.GetDevice(), _memory, nullptr);
+            // frames in flight may still read the buffer, and a staged copy into it may still be pending
+            _device.GetUploadScheduler().CancelAcquire(_buffer);
+            _device.GetDeletionQueue().Destroy(_buffer, _allocation, _upload_ticket);
         }
     }
 
     void Buffer::Write(void *data, VkDeviceSize size, VkDeviceSize offset) {
-        if (!_mapped) {
-            Utils::Error("Attempted to write to buffer without mapping to host memory");
-            return;
-        }
-
         VkDeviceSize s;
         if (size == VK_WHOLE_SIZE) {
             s = _size;
@@ -60,104 +40,71 @@ namespace mcvk::Renderer {
             s = size;
         }
 
-        Invalidate(size, offset);
-        std::memcpy(_mapped, data, s);
-        Flush(size, offset);
-
-        _TransferStaged(s, offset);
-    }
-
-    void Buffer::Map(VkDeviceSize size, VkDeviceSize offset) {
-        if (vkMapMemory(_device.GetDevice(), _stage_memory, offset, size, 0, &_mapped) != VK_SUCCESS) {
-            Utils::Fatal("Failed to map host memory to device staging buffer");
+        // host writes are made visible to the device by the next queue submission, so no transfer or barrier is needed here. Only
+        // the first write can be made like this, as nothing can have read the buffer yet; the upload scheduler orders any later
+        // (staged) writes after the frames that may be reading it
+        if (_direct && !_written) {
+            std::memcpy(static_cast<char *>(_allocation.mapped) + offset, data, static_cast<size_t>(s));
+            Flush(s, offset);
+            _device.GetUploadScheduler().TrackGraphicsUse(_buffer);
+            _written = true;
+            return;
         }
-    }
+        _written = true;
 
-    void Buffer::Unmap() {
-        if (_mapped) {
-            vkUnmapMemory(_device.GetDevice(), _stage_memory);
-            _mapped = nullptr;
-        }
+        // data is copied into the shared staging ring straight away, so the caller's memory can be reused as soon as this returns
+        _upload_ticket = _device.GetUploadScheduler().UploadToBuffer(_buffer, offset, data, s);
     }
 
     void Buffer::Flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange range{};
-        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        range.memory = _stage_memory;
-        range.offset = offset;
-        range.size = size;
-        if (vkFlushMappedMemoryRanges(_device.GetDevice(), 1, &range) != VK_SUCCESS) {
-            Utils::Fatal("Failed to flush host mapped memory to device staging buffer");
-        }
+        _device.GetAllocator().Flush(_allocation, size, offset);
     }
 
     void Buffer::Invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange range{};
-        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        range.memory = _stage_memory;
-        range.offset = offset;
-        range.size = size;
-        if (vkInvalidateMappedMemoryRanges(_device.GetDevice(), 1, &range) != VK_SUCCESS) {
-            Utils::Fatal("Failed to invalidate host mapped memory for device staging buffer");
-        }
+        _device.GetAllocator().Invalidate(_allocation, size, offset);
     }
 
-    void Buffer::_CreateBuffer(VkBuffer *buf, VkDeviceMemory *mem, VkBufferUsageFlags usage, VkMemoryPropertyFlags memprops) {
+    void Buffer::_CreateBuffer(VkBuffer *buf, MemoryAllocation *alloc, VkDeviceSize size, VkBufferUsageFlags usage,
+        VkMemoryPropertyFlags memprops, MemoryCategory category) {
         VkBufferCreateInfo create_info{};
         create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        create_info.size = _size;
+        create_info.size = size;
         create_info.usage = usage;
-        create_info.sharingMode = _sharing_mode;
-        if (create_info.sharingMode == VK_SHARING_MODE_CONCURRENT) {
-            create_info.queueFamilyIndexCount = static_cast<uint32_t>(_queue_families.size());
-            create_info.pQueueFamilyIndices = _queue_families.data();
-        }
+        // exclusive even when the transfer queue is in another family; the upload scheduler transfers ownership after writing
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         if (vkCreateBuffer(_device.GetDevice(), &create_info, nullptr, buf) != VK_SUCCESS) {
             Utils::Fatal("Failed to create buffer object");
         }
 
-        VkMemoryRequirements requirements;
-        vkGetBufferMemoryRequirements(_device.GetDevice(), *buf, &requirements);
-
-        VkMemoryAllocateInfo alloc_info{};
-        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize = requirements.size;
-        alloc_info.memoryTypeIndex = _device.FindMemoryType(requirements.memoryTypeBits, memprops);
-        if (vkAllocateMemory(_device.GetDevice(), &alloc_info, nullptr, mem) != VK_SUCCESS) {
-            Utils::Fatal("Failed to allocate device memory for buffer");
-        }
-
-        if (vkBindBufferMemory(_device.GetDevice(), *buf, *mem, 0) != VK_SUCCESS) {
-            Utils::Fatal("Failed to bind buffer to device memory");
+        // memprops of 0 means device-local memory, written through staging unless it is also host-visible (as on integrated and
+        // software devices, or with resizable BAR) in which case it is written directly
+        if (memprops == 0) {
+            _direct = _allow_direct && _device.GetAllocator().TryAllocateForBuffer(*buf,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, _MAX_DIRECT_HEAP_USAGE, *alloc, category);
+            if (!_direct) {
+                *alloc = _device.GetAllocator().AllocateForBuffer(*buf, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, category);
+            }
+            return;
         }
-    }
-
-    void Buffer::_TransferStaged(VkDeviceSize size, VkDeviceSize offset) {
-        // one-time-submit command buffer for memory transfer operations
-        VkCommandBuffer cmdbuf = CommandBuffer::BeginOneTimeSubmit(_device, _device.GetTransferCommandPool());
-
-        VkBufferCopy copy_region{};
-        copy_region.size = size;
-        copy_region.srcOffset = offset;
-        copy_region.dstOffset = offset;
-
-        vkCmdCopyBuffer(cmdbuf, _stage, _buffer, 1, &copy_region);
 
-        CommandBuffer::EndOneTimeSubmit(_device, _device.GetTransferCommandPool(), _device.GetTransferQueue(), cmdbuf);
+        *alloc = _device.GetAllocator().AllocateForBuffer(*buf, memprops, category);
     }
 
-    VertexBuffer::VertexBuffer(const Device &device, VkDeviceSize size)
-        : Buffer{device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT} {
+    VertexBuffer::VertexBuffer(const Device &device, VkDeviceSize size, bool allow_direct)
+        : Buffer{device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, MemoryCategory::Mesh, allow_direct} {
     }
 
-    IndexBuffer::IndexBuffer(const Device &device, VkDeviceSize size, VkIndexType index_type)
-        : Buffer{device, size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT}, _index_type{index_type} {
+    IndexBuffer::IndexBuffer(const Device &device, VkDeviceSize size, VkIndexType index_type, bool allow_direct)
+        : Buffer{device, size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, MemoryCategory::Mesh, allow_direct}, _index_type{index_type} {
     }
 
     UniformBuffer::UniformBuffer(const Renderer &renderer, VkDeviceSize size)
         : Buffer{renderer.GetDevice(), size}, _renderer{renderer} {
-        _CreateBuffer(&_buffer, &_memory, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        // each frame's copy starts at an offset that is valid to bind as a dynamic offset
+        _frame_stride = AlignOffset(_device, _size);
+
+        _CreateBuffer(&_buffer, &_allocation, _frame_stride * _renderer.GetFramesInFlight(), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Uniform);
 
         // persistent mapping - map buffer immediately after creation
         _Map();
@@ -175,7 +122,7 @@ namespace mcvk::Renderer {
             o = offset;
         }
 
-        std::memcpy(mapped + o, data, s);
+        std::memcpy(mapped + GetFrameOffset() + o, data, s);
     }
 
     VkDeviceSize UniformBuffer::AlignOffset(const Device &device, VkDeviceSize size) {
@@ -189,9 +136,14 @@ namespace mcvk::Renderer {
         return aligned;
     }
 
+    uint32_t UniformBuffer::GetFrameOffset() const {
+        return static_cast<uint32_t>(_frame_stride * _renderer.GetCurrentFrame());
+    }
+
     void UniformBuffer::_Map(VkDeviceSize size, VkDeviceSize offset) {
-        if (vkMapMemory(_device.GetDevice(), _memory, offset, size, 0, &_mapped) != VK_SUCCESS) {
+        if (!_allocation.mapped) {
             Utils::Fatal("Failed to map host memory to device buffer (UBO)");
         }
+        _mapped = static_cast<char *>(_allocation.mapped) + offset;
     }
 }
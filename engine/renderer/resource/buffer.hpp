@@ -15,22 +15,25 @@ namespace mcvk::Renderer {
     class Buffer {
     public:
         Buffer(const Device &device, VkDeviceSize size);
-        Buffer(const Device &device, VkDeviceSize size, VkBufferUsageFlags usage);
+        // allow_direct false always writes through staging, even where host-visible device-local memory is available
+        Buffer(const Device &device, VkDeviceSize size, VkBufferUsageFlags usage, MemoryCategory category = MemoryCategory::Other,
+            bool allow_direct = true);
         virtual ~Buffer();
 
         inline const VkBuffer &GetBuffer() const { return _buffer; }
         inline const VkDeviceSize &GetSize() const { return _size; }
+        // true if the buffer lives in host-visible device-local memory, so that its first write skips staging (later ones may
+        // race frames still reading it, so go through staging like any other)
+        inline bool IsDirectWrite() const { return _direct; }
 
         virtual void Write(void *data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
-        virtual void Map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
-        virtual void Unmap();
-
         virtual void Flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
         virtual void Invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
     protected:
-        virtual void _CreateBuffer(VkBuffer *buf, VkDeviceMemory *mem, VkBufferUsageFlags usage, VkMemoryPropertyFlags memprops);
+        virtual void _CreateBuffer(VkBuffer *buf, MemoryAllocation *alloc, VkDeviceSize size, VkBufferUsageFlags usage,
+            VkMemoryPropertyFlags memprops, MemoryCategory category);
 
         const Device &_device;
 
@@ -38,25 +41,28 @@ namespace mcvk::Renderer {
 
         void *_mapped{nullptr};
         VkBuffer _buffer{VK_NULL_HANDLE};
-        VkDeviceMemory _memory{VK_NULL_HANDLE};
-        VkBuffer _stage{VK_NULL_HANDLE};
-        VkDeviceMemory _stage_memory{VK_NULL_HANDLE};
+        MemoryAllocation _allocation{};
 
-    private:
-        void _TransferStaged(VkDeviceSize size, VkDeviceSize offset);
+        // batch containing the most recent staged copy into this buffer
+        UploadScheduler::Ticket _upload_ticket{0};
+
+        bool _allow_direct{true};
+        bool _direct{false};
+        bool _written{false};
 
-        std::vector<uint32_t> _queue_families{};
-        VkSharingMode _sharing_mode{VK_SHARING_MODE_EXCLUSIVE};
+    private:
+        // share of a host-visible device-local heap that direct-write buffers may take up, leaving room on small BAR heaps
+        static constexpr float _MAX_DIRECT_HEAP_USAGE = 0.5f;
     };
 
     class VertexBuffer : public Buffer {
     public:
-        VertexBuffer(const Device &device, VkDeviceSize size);
+        VertexBuffer(const Device &device, VkDeviceSize size, bool allow_direct = true);
     };
 
     class IndexBuffer : public Buffer {
     public:
-        IndexBuffer(const Device &device, VkDeviceSize size, VkIndexType index_type);
+        IndexBuffer(const Device &device, VkDeviceSize size, VkIndexType index_type, bool allow_direct = true);
 
         inline const VkIndexType &GetIndexType() const { return _index_type; }
 
@@ -64,16 +70,24 @@ namespace mcvk::Renderer {
         VkIndexType _index_type;
     };
 
+    // Holds one copy of its contents per frame in flight so that the CPU can write the current frame's data while the GPU is
+    // still reading earlier frames'. The size is that of a single copy; bind with GetFrameOffset() as the dynamic offset.
     class UniformBuffer : public Buffer {
     public:
         UniformBuffer(const Renderer &renderer, VkDeviceSize size);
 
+        // writes to the current frame's copy
         void Write(void *data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) override;
         static VkDeviceSize AlignOffset(const Device &device, VkDeviceSize size);
 
-    private:
+        uint32_t GetFrameOffset() const;
+
+    protected:
         const Renderer &_renderer;
 
+        VkDeviceSize _frame_stride;
+
+    private:
         void _Map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
     };
 }
@@ -104,7 +104,7 @@ namespace mcvk::Renderer {
 
 
     DescriptorSetLayoutBuilder &DescriptorSetLayoutBuilder::AddBinding(int32_t binding, VkDescriptorType type, uint32_t descrcount,
-        VkShaderStageFlags stages, VkSampler *immutsamplers) {
+        VkShaderStageFlags stages, const VkSampler *immutsamplers) {
         VkDescriptorSetLayoutBinding info{};
         info.binding = binding;
         info.descriptorType = type;
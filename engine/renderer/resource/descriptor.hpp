@@ -50,7 +50,7 @@ namespace mcvk::Renderer {
         inline static DescriptorSetLayoutBuilder New() { return DescriptorSetLayoutBuilder{}; }
 
         DescriptorSetLayoutBuilder &AddBinding(int32_t binding, VkDescriptorType type, uint32_t descrcount, VkShaderStageFlags stages,
-            VkSampler *immutsamplers = nullptr);
+            const VkSampler *immutsamplers = nullptr);
 
         VkDescriptorSetLayout Build(const Device &device);
 
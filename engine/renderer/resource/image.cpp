@@ -7,11 +7,12 @@
 
 #include "image.hpp"
 
-#include "renderer/command_buffer.hpp"
+#include "resource_mgr/mipmap.hpp"
 #include "utils/log.hpp"
 
 #include <volk/volk.h>
 
+#include <algorithm>
 #include <cstring>
 
 namespace mcvk::Renderer {
@@ -41,6 +42,12 @@ namespace mcvk::Renderer {
         config.view_info.subresourceRange.baseArrayLayer = 0;
         config.view_info.subresourceRange.layerCount = 1;
 
+        config.category = MemoryCategory::Other;
+
+        config.generate_mipmaps = false;
+        config.max_anisotropy = 16.0f;
+        config.mip_lod_bias = 0.0f;
+
         return config;
     }
 
@@ -57,33 +64,69 @@ namespace mcvk::Renderer {
         _CreateImageView();
     }
 
-    Image::Image(const Device &device, const Config &config, const ResourceMgr::ImageLoadResult &data)
+    Image::Image(const Device &device, const Config &config, const ResourceMgr::ImageLoadResult &data, ImageUploadBatch *batch)
         : _device{device}, _config{config}, _format{config.image_info.format} {
-        QueueFamilyIndices families = _device.FindQueueFamilyIndices();
-        if (families.graphics != families.transfer) {
-            _sharing_mode = VK_SHARING_MODE_CONCURRENT;
-            _queue_families = {
-                families.graphics.value(),
-                families.transfer.value() };
-        }
+        _PrepareTexture(1);
 
         _AllocImage();
         _CreateImageView();
-        _Write(data);
+        _Write(data.bytes, static_cast<uint32_t>(data.width), static_cast<uint32_t>(data.height), 1, batch);
         _CreateSampler();
     }
 
-    Image::~Image() {
-        vkDestroySampler(_device.GetDevice(), _sampler, nullptr);
+    Image::Image(const Device &device, const Config &config, const ResourceMgr::TextureArrayData &data, ImageUploadBatch *batch)
+        : _device{device}, _config{config}, _format{config.image_info.format} {
+        _config.image_info.extent = { data.width, data.height, 1 };
+        _config.view_info.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        _PrepareTexture(data.layer_count);
 
-        vkDestroyImageView(_device.GetDevice(), _image_view, nullptr);
+        _AllocImage();
+        _CreateImageView();
+        _Write(data.bytes.data(), data.width, data.height, data.layer_count, batch);
+        _CreateSampler();
+    }
+
+    Image::Image(const Device &device, const Config &config, const ResourceMgr::CompressedTexture &data, ImageUploadBatch *batch)
+        : _device{device}, _config{config}, _format{GetBlockCompressedFormat(data.format, data.srgb)} {
+        _config.category = MemoryCategory::Texture;
+
+        _config.image_info.format = _format;
+        _config.view_info.format = _format;
+        _config.image_info.extent = { data.width, data.height, 1 };
+        if (data.array) {
+            _config.view_info.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        }
+        _config.image_info.arrayLayers = data.layer_count;
+        _config.view_info.subresourceRange.layerCount = data.layer_count;
+        _config.image_info.mipLevels = data.level_count;
+        _config.view_info.subresourceRange.levelCount = data.level_count;
+
+        _AllocImage();
+        _CreateImageView();
+        _WriteCompressed(data, batch);
+        _CreateSampler();
+    }
 
-        if (_memory != VK_NULL_HANDLE) {
-            // if memory is NULL, then we assume the image was passed directly to the ctor and is therefore handled elsewhere, e.g. by a swapchain
-            vkDestroyImage(_device.GetDevice(), _image, nullptr);
+    Image::~Image() {
+        if (_allocation.memory == VK_NULL_HANDLE) {
+            // if memory is NULL, then we assume the image was passed directly to the ctor and is therefore handled elsewhere, e.g. by a
+            // swapchain, which only tears its images down once the device is idle
+            if (_sampler != VK_NULL_HANDLE) {
+                _device.GetSamplerCache().Release(_sampler);
+            }
+            vkDestroyImageView(_device.GetDevice(), _image_view, nullptr);
+            return;
+        }
 
-            vkFreeMemory(_device.GetDevice(), _memory, nullptr);
+        // frames in flight may still sample the image, and a staged copy into it may still be pending
+        DeletionQueue &deletion = _device.GetDeletionQueue();
+        if (_sampler != VK_NULL_HANDLE) {
+            _device.GetSamplerCache().Release(_sampler);
         }
+        deletion.Destroy(_image_view);
+
+        _device.GetUploadScheduler().CancelAcquire(_image);
+        deletion.Destroy(_image, _allocation, _upload_ticket);
     }
 
     void Image::_AllocImage() {
@@ -92,20 +135,7 @@ namespace mcvk::Renderer {
         }
         _config.view_info.image = _image;
 
-        VkMemoryRequirements requirements;
-        vkGetImageMemoryRequirements(_device.GetDevice(), _image, &requirements);
-
-        VkMemoryAllocateInfo alloc_info{};
-        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize = requirements.size;
-        alloc_info.memoryTypeIndex = _device.FindMemoryType(requirements.memoryTypeBits, _config.mem_props);
-        if (vkAllocateMemory(_device.GetDevice(), &alloc_info, nullptr, &_memory) != VK_SUCCESS) {
-            Utils::Fatal("Failed to allocate device memory for image");
-        }
-
-        if (vkBindImageMemory(_device.GetDevice(), _image, _memory, 0) != VK_SUCCESS) {
-            Utils::Fatal("Failed to bind image to device memory");
-        }
+        _allocation = _device.GetAllocator().AllocateForImage(_image, _config.mem_props, _config.category);
     }
 
     void Image::_CreateImageView() {
@@ -114,37 +144,6 @@ namespace mcvk::Renderer {
         }
     }
 
-    void Image::_CreateStagingBuffer(VkBuffer &stage, VkDeviceMemory &stage_mem, VkDeviceSize size) {
-        VkBufferCreateInfo create_info{};
-        create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        create_info.size = size;
-        create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        create_info.sharingMode = _sharing_mode;
-        if (create_info.sharingMode == VK_SHARING_MODE_CONCURRENT) {
-            create_info.queueFamilyIndexCount = static_cast<uint32_t>(_queue_families.size());
-            create_info.pQueueFamilyIndices = _queue_families.data();
-        }
-        if (vkCreateBuffer(_device.GetDevice(), &create_info, nullptr, &stage) != VK_SUCCESS) {
-            Utils::Fatal("Failed to create image staging buffer object");
-        }
-
-        VkMemoryRequirements requirements;
-        vkGetBufferMemoryRequirements(_device.GetDevice(), stage, &requirements);
-
-        VkMemoryAllocateInfo alloc_info{};
-        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize = requirements.size;
-        alloc_info.memoryTypeIndex =
-            _device.FindMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        if (vkAllocateMemory(_device.GetDevice(), &alloc_info, nullptr, &stage_mem) != VK_SUCCESS) {
-            Utils::Fatal("Failed to allocate device memory for image staging buffer");
-        }
-
-        if (vkBindBufferMemory(_device.GetDevice(), stage, stage_mem, 0) != VK_SUCCESS) {
-            Utils::Fatal("Failed to bind image staging buffer to device memory");
-        }
-    }
-
     void Image::_CreateSampler() {
         VkSamplerCreateInfo info{};
         info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -154,96 +153,40 @@ namespace mcvk::Renderer {
         info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
         info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
         info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        info.anisotropyEnable = VK_TRUE;
-        info.maxAnisotropy = _device.GetProperties().limits.maxSamplerAnisotropy;
+        info.anisotropyEnable = (_config.max_anisotropy > 1.0f) ? VK_TRUE : VK_FALSE;
+        info.maxAnisotropy = std::min(_config.max_anisotropy, _device.GetProperties().limits.maxSamplerAnisotropy);
         info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
         info.unnormalizedCoordinates = VK_FALSE; // normalised is (0, 0) to (1, 1) - unnormalised is rubbish
         info.compareEnable = VK_FALSE;
         info.compareOp = VK_COMPARE_OP_ALWAYS;
         info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-        info.mipLodBias = 0.0f;
+        info.mipLodBias = _config.mip_lod_bias;
         info.minLod = 0.0f;
-        info.maxLod = 0.0f;
+        info.maxLod = static_cast<float>(_config.image_info.mipLevels);
 
-        if (vkCreateSampler(_device.GetDevice(), &info, nullptr, &_sampler) != VK_SUCCESS) {
-            Utils::Fatal("Failed to create sampler");
-        }
+        // textures with the same filtering share a sampler
+        _sampler = _device.GetSamplerCache().Acquire(info);
     }
 
-    void Image::_TransitionImageLayout(VkImageLayout old, VkImageLayout newl) {
-        VkCommandBuffer cmdbuf = CommandBuffer::BeginOneTimeSubmit(_device, _device.GetGraphicsCommandPool());
-
-        VkImageMemoryBarrier image_barrier{};
-        image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        image_barrier.oldLayout = old;
-        image_barrier.newLayout = newl;
-        image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        image_barrier.image = _image;
-        image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        image_barrier.subresourceRange.baseMipLevel = 0;
-        image_barrier.subresourceRange.levelCount = 1;
-        image_barrier.subresourceRange.baseArrayLayer = 0;
-        image_barrier.subresourceRange.layerCount = 1;
-
-        VkPipelineStageFlags src_stage, dst_stage;
-
-        // UNDEFINED -> TRANSFER-DST: transfer writes that don't need to wait on anything
-        if (old == VK_IMAGE_LAYOUT_UNDEFINED && newl == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-            image_barrier.srcAccessMask = 0;
-            image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            dst_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        }
-        // TRANSFER-DST -> SHADER-READ: shader reads which should wait on transfer writes
-        else if (old == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newl == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-            image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            // note that we're using the image in the fragment shader
-            dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        }
-        else {
-            Utils::Fatal("Encountered unsupported image layout transition");
-        }
-
-        vkCmdPipelineBarrier(
-            cmdbuf,
-            src_stage, dst_stage,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &image_barrier);
+    void Image::_PrepareTexture(uint32_t layers) {
+        _config.category = MemoryCategory::Texture;
 
-        CommandBuffer::EndOneTimeSubmit(_device, _device.GetGraphicsCommandPool(), _device.GetGraphicsQueue(), cmdbuf);
+        _config.image_info.arrayLayers = layers;
+        _config.view_info.subresourceRange.layerCount = layers;
 
-        _layout = newl;
-    }
-
-    void Image::_Write(const ResourceMgr::ImageLoadResult &data) {
-        VkDeviceSize image_size = data.width * data.height * 4;
-
-        VkBuffer stage;
-        VkDeviceMemory stage_mem;
-        _CreateStagingBuffer(stage, stage_mem, image_size);
-
-        void *mapped;
-        vkMapMemory(_device.GetDevice(), stage_mem, 0, VK_WHOLE_SIZE, 0, &mapped);
-        std::memcpy(mapped, data.bytes, static_cast<size_t>(image_size));
-        vkUnmapMemory(_device.GetDevice(), stage_mem);
-
-        _TransitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL); // transition to transfer-dst layout
-        _TransferStaged(stage, image_size,
-            { static_cast<uint32_t>(data.width), static_cast<uint32_t>(data.height), 1 });
-        _TransitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL); // transition to shader-read layout
-
-        vkDestroyBuffer(_device.GetDevice(), stage, nullptr);
-        vkFreeMemory(_device.GetDevice(), stage_mem, nullptr);
+        if (_config.generate_mipmaps) {
+            uint32_t levels = ResourceMgr::GetMipLevelCount(_config.image_info.extent.width, _config.image_info.extent.height);
+            _config.image_info.mipLevels = levels;
+            _config.view_info.subresourceRange.levelCount = levels;
+            // lower levels may be blitted from the base level
+            _config.image_info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        }
     }
 
-    void Image::_TransferStaged(VkBuffer stage, VkDeviceSize size, VkExtent3D extent) {
-        VkCommandBuffer cmdbuf = CommandBuffer::BeginOneTimeSubmit(_device, _device.GetTransferCommandPool());
+    void Image::_Write(const uint8_t *bytes, uint32_t width, uint32_t height, uint32_t layers, ImageUploadBatch *batch) {
+        VkDeviceSize layer_size = static_cast<VkDeviceSize>(width) * height * 4;
 
+        // layers are tightly packed, so a single region covers all of them
         VkBufferImageCopy copy_region{};
         copy_region.bufferOffset = 0;
         copy_region.bufferRowLength = 0;
@@ -251,12 +194,97 @@ namespace mcvk::Renderer {
         copy_region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         copy_region.imageSubresource.mipLevel = 0;
         copy_region.imageSubresource.baseArrayLayer = 0;
-        copy_region.imageSubresource.layerCount = 1;
+        copy_region.imageSubresource.layerCount = layers;
         copy_region.imageOffset = { 0, 0, 0 };
-        copy_region.imageExtent = extent;
+        copy_region.imageExtent = { width, height, 1 };
+
+        // transitions to transfer-dst and then shader-read layouts are recorded alongside the copy
+        if (_config.image_info.mipLevels <= 1) {
+            _Upload(bytes, layer_size * layers, { copy_region }, false, batch);
+        } else if (_device.GetUploadScheduler().CanBlit() && _device.SupportsLinearBlit(_format)) {
+            // only the base level is uploaded; the rest are blitted down from it on the GPU
+            _Upload(bytes, layer_size * layers, { copy_region }, true, batch);
+        } else {
+            // the upload queue can't blit (or the format can't be linearly filtered), so every level is filtered here instead
+            std::vector<uint8_t> chains;
+            std::vector<VkBufferImageCopy> regions;
+            for (uint32_t l = 0; l < layers; l++) {
+                ResourceMgr::MipChain chain = ResourceMgr::GenerateMipChain(bytes + layer_size * l, width, height, _IsSRGB());
+
+                for (uint32_t i = 0; i < chain.levels.size(); i++) {
+                    VkBufferImageCopy region = copy_region;
+                    region.bufferOffset = chains.size() + chain.levels[i].offset;
+                    region.imageSubresource.mipLevel = i;
+                    region.imageSubresource.baseArrayLayer = l;
+                    region.imageSubresource.layerCount = 1;
+                    region.imageExtent = { chain.levels[i].width, chain.levels[i].height, 1 };
+                    regions.push_back(region);
+                }
+                chains.insert(chains.end(), chain.bytes.begin(), chain.bytes.end());
+            }
+
+            _Upload(chains.data(), chains.size(), regions, false, batch);
+        }
+    }
+
+    void Image::_WriteCompressed(const ResourceMgr::CompressedTexture &data, ImageUploadBatch *batch) {
+        std::vector<VkBufferImageCopy> regions;
+        for (uint32_t l = 0; l < data.layer_count; l++) {
+            for (uint32_t i = 0; i < data.level_count; i++) {
+                const ResourceMgr::CompressedLevel &level = data.levels[l * data.level_count + i];
+
+                // blocks are tightly packed, and the extent may end part way through the edge blocks
+                VkBufferImageCopy region{};
+                region.bufferOffset = level.offset;
+                region.bufferRowLength = 0;
+                region.bufferImageHeight = 0;
+                region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.mipLevel = i;
+                region.imageSubresource.baseArrayLayer = l;
+                region.imageSubresource.layerCount = 1;
+                region.imageOffset = { 0, 0, 0 };
+                region.imageExtent = { level.width, level.height, 1 };
+                regions.push_back(region);
+            }
+        }
+
+        _Upload(data.bytes.data(), data.bytes.size(), regions, false, batch);
+    }
+
+    void Image::_Upload(const void *data, VkDeviceSize size, const std::vector<VkBufferImageCopy> &regions, bool generate_mips,
+        ImageUploadBatch *batch) {
+        const VkImageSubresourceRange &range = _config.view_info.subresourceRange;
 
-        vkCmdCopyBufferToImage(cmdbuf, stage, _image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy_region);
+        if (batch) {
+            batch->Add(_image, data, size, regions, range, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, generate_mips, &_upload_ticket);
+        } else {
+            _upload_ticket = _device.GetUploadScheduler().UploadToImage(_image, data, size, regions, range,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, generate_mips);
+        }
+
+        _layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
 
-        CommandBuffer::EndOneTimeSubmit(_device, _device.GetTransferCommandPool(), _device.GetTransferQueue(), cmdbuf);
+    VkFormat Image::GetBlockCompressedFormat(ResourceMgr::BlockFormat format, bool srgb) {
+        switch (format) {
+            case ResourceMgr::BlockFormat::BC1:
+                return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+            case ResourceMgr::BlockFormat::BC3:
+                return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+            case ResourceMgr::BlockFormat::BC7:
+                return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+            default:
+                return VK_FORMAT_UNDEFINED;
+        }
+    }
+
+    bool Image::_IsSRGB() const {
+        switch (_format) {
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+                return true;
+            default:
+                return false;
+        }
     }
 }
@@ -8,7 +8,10 @@
 #pragma once
 
 #include "renderer/device.hpp"
+#include "renderer/resource/image_upload_batch.hpp"
+#include "resource_mgr/compressed_texture.hpp"
 #include "resource_mgr/image_load.hpp"
+#include "resource_mgr/texture_array.hpp"
 
 namespace mcvk::Renderer {
     class Image {
@@ -18,33 +21,53 @@ namespace mcvk::Renderer {
             VkImageViewCreateInfo view_info;
 
             VkMemoryPropertyFlags mem_props;
+            // images created from loaded data are always counted as textures
+            MemoryCategory category;
+
+            // images created from loaded data get a full mip chain; image_info.mipLevels and the view's level count are set to
+            // match, so they don't need changing here
+            bool generate_mipmaps;
+            // clamped to the device limit; 1 disables anisotropic filtering
+            float max_anisotropy;
+            float mip_lod_bias;
 
             static Config Defaults(VkExtent2D extent, VkFormat format);
         };
 
         Image(const Device &device, const Config &config);
         Image(const Device &device, const Config &config, VkImage image);
-        Image(const Device &device, const Config &config, const ResourceMgr::ImageLoadResult &data);
+        // images created from data are uploaded straight away, unless a batch is given to collect the upload into
+        Image(const Device &device, const Config &config, const ResourceMgr::ImageLoadResult &data, ImageUploadBatch *batch = nullptr);
+        // creates a 2D array image (and view) with a layer for each packed texture; the extent is taken from the array
+        Image(const Device &device, const Config &config, const ResourceMgr::TextureArrayData &data, ImageUploadBatch *batch = nullptr);
+        // uploads pre-compressed blocks (and mips) directly; the format, extent, and level count are taken from the texture, and
+        // generate_mipmaps is ignored
+        Image(const Device &device, const Config &config, const ResourceMgr::CompressedTexture &data, ImageUploadBatch *batch = nullptr);
         ~Image();
 
         inline const VkImage &GetImage() const { return _image; }
         inline const VkImageView &GetImageView() const { return _image_view; }
         inline const VkImageLayout &GetImageLayout() const { return _layout; }
+        inline VkFormat GetFormat() const { return _format; }
         inline const VkSampler &GetSampler() const { return _sampler; }
 
+        static VkFormat GetBlockCompressedFormat(ResourceMgr::BlockFormat format, bool srgb);
+
     private:
         void _AllocImage();
         void _CreateImageView();
-        void _CreateStagingBuffer(VkBuffer &stage, VkDeviceMemory &stage_mem, VkDeviceSize size);
         void _CreateSampler();
 
-        void _TransitionImageLayout(VkImageLayout old, VkImageLayout newl);
-        void _Write(const ResourceMgr::ImageLoadResult &data);
-        void _TransferStaged(VkBuffer stage, VkDeviceSize size, VkExtent3D extent);
+        void _PrepareTexture(uint32_t layers);
+        void _Write(const uint8_t *bytes, uint32_t width, uint32_t height, uint32_t layers, ImageUploadBatch *batch);
+        void _WriteCompressed(const ResourceMgr::CompressedTexture &data, ImageUploadBatch *batch);
+        void _Upload(const void *data, VkDeviceSize size, const std::vector<VkBufferImageCopy> &regions, bool generate_mips,
+            ImageUploadBatch *batch);
+        bool _IsSRGB() const;
 
         const Device &_device;
 
-        VkDeviceMemory _memory{VK_NULL_HANDLE};
+        MemoryAllocation _allocation{};
 
         VkImage _image{VK_NULL_HANDLE};
         VkImageView _image_view{VK_NULL_HANDLE};
@@ -54,7 +77,6 @@ namespace mcvk::Renderer {
         VkFormat _format;
         VkImageLayout _layout{VK_IMAGE_LAYOUT_UNDEFINED};
 
-        std::vector<uint32_t> _queue_families{};
-        VkSharingMode _sharing_mode{VK_SHARING_MODE_EXCLUSIVE};
+        UploadScheduler::Ticket _upload_ticket{0};
     };
 }
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "image_upload_batch.hpp"
+
+#include "renderer/device.hpp"
+
+#include <cstring>
+
+namespace mcvk::Renderer {
+    ImageUploadBatch::ImageUploadBatch(const Device &device)
+        : _device{device} {
+    }
+
+    ImageUploadBatch::~ImageUploadBatch() {
+        Submit();
+    }
+
+    void ImageUploadBatch::Add(VkImage dst, const void *data, VkDeviceSize size, const std::vector<VkBufferImageCopy> &regions,
+        const VkImageSubresourceRange &range, VkImageLayout final_layout, bool generate_mips, UploadScheduler::Ticket *ticket) {
+        // compressed formats need region offsets aligned to their block size
+        size_t offset = (_data.size() + _ALIGNMENT - 1) / _ALIGNMENT * _ALIGNMENT;
+        _data.resize(offset + static_cast<size_t>(size));
+        std::memcpy(_data.data() + offset, data, static_cast<size_t>(size));
+
+        UploadScheduler::ImageCopy copy{ dst, regions, range, final_layout, generate_mips };
+        for (VkBufferImageCopy &r : copy.regions) {
+            r.bufferOffset += offset;
+        }
+        _copies.push_back(std::move(copy));
+        _tickets.push_back(ticket);
+    }
+
+    UploadScheduler::Ticket ImageUploadBatch::Submit() {
+        if (_copies.empty()) {
+            return 0;
+        }
+
+        UploadScheduler::Ticket ticket = _device.GetUploadScheduler().UploadToImages(_data.data(), _data.size(), _copies);
+        for (UploadScheduler::Ticket *t : _tickets) {
+            if (t) {
+                *t = ticket;
+            }
+        }
+
+        _data.clear();
+        _copies.clear();
+        _tickets.clear();
+        return ticket;
+    }
+}
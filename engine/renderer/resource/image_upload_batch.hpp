@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include "renderer/resource/upload_scheduler.hpp"
+
+#include <vector>
+
+namespace mcvk::Renderer {
+    class Device;
+
+    // Gathers the uploads of many images (e.g. every texture loaded at startup) so that they share one staging allocation and one
+    // pass of layout transitions when submitted. Data is copied in when added, so it needn't outlive the call. Images added to a
+    // batch must not be destroyed before it is submitted; anything left unsubmitted is submitted on destruction.
+    class ImageUploadBatch {
+    public:
+        ImageUploadBatch(const Device &device);
+        ~ImageUploadBatch();
+
+        ImageUploadBatch(const ImageUploadBatch &) = delete;
+        ImageUploadBatch &operator=(const ImageUploadBatch &) = delete;
+
+        // arguments are as for UploadScheduler::UploadToImage(); ticket is set to the upload's ticket on submission
+        void Add(VkImage dst, const void *data, VkDeviceSize size, const std::vector<VkBufferImageCopy> &regions,
+            const VkImageSubresourceRange &range, VkImageLayout final_layout, bool generate_mips, UploadScheduler::Ticket *ticket);
+
+        UploadScheduler::Ticket Submit();
+
+        inline size_t GetImageCount() const { return _copies.size(); }
+
+    private:
+        // per-image offsets into the shared staging data, matching the scheduler's staging alignment
+        static constexpr VkDeviceSize _ALIGNMENT = 16;
+
+        const Device &_device;
+
+        std::vector<uint8_t> _data;
+        std::vector<UploadScheduler::ImageCopy> _copies;
+        std::vector<UploadScheduler::Ticket *> _tickets;
+    };
+}
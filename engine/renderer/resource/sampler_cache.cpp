@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "sampler_cache.hpp"
+
+#include "renderer/device.hpp"
+#include "utils/hash.hpp"
+#include "utils/log.hpp"
+
+namespace mcvk::Renderer {
+    bool SamplerCache::_Key::operator==(const _Key &other) const {
+        const VkSamplerCreateInfo &a = info;
+        const VkSamplerCreateInfo &b = other.info;
+        return a.flags == b.flags && a.magFilter == b.magFilter && a.minFilter == b.minFilter && a.mipmapMode == b.mipmapMode &&
+               a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV && a.addressModeW == b.addressModeW &&
+               a.mipLodBias == b.mipLodBias && a.anisotropyEnable == b.anisotropyEnable && a.maxAnisotropy == b.maxAnisotropy &&
+               a.compareEnable == b.compareEnable && a.compareOp == b.compareOp && a.minLod == b.minLod && a.maxLod == b.maxLod &&
+               a.borderColor == b.borderColor && a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+    }
+
+    size_t SamplerCache::_KeyHash::operator()(const _Key &key) const {
+        const VkSamplerCreateInfo &i = key.info;
+
+        size_t seed = 0;
+        Utils::HashCombine(seed, i.flags, i.magFilter, i.minFilter, i.mipmapMode, i.addressModeU, i.addressModeV, i.addressModeW,
+            i.mipLodBias, i.anisotropyEnable, i.maxAnisotropy, i.compareEnable, i.compareOp, i.minLod, i.maxLod, i.borderColor,
+            i.unnormalizedCoordinates);
+        return seed;
+    }
+
+    SamplerCache::SamplerCache(const Device &device)
+        : _device{device} {
+    }
+
+    SamplerCache::~SamplerCache() {
+        if (!_samplers.empty()) {
+            Utils::Warn(std::to_string(_samplers.size()) + " cached samplers were still in use at device destruction");
+        }
+        for (auto &[key, entry] : _samplers) {
+            vkDestroySampler(_device.GetDevice(), entry.sampler, nullptr);
+        }
+    }
+
+    VkSampler SamplerCache::Acquire(const VkSamplerCreateInfo &info) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _requests++;
+
+        _Key key{ info };
+        key.info.pNext = nullptr;
+
+        auto it = _samplers.find(key);
+        if (it != _samplers.end()) {
+            _hits++;
+            it->second.refs++;
+            return it->second.sampler;
+        }
+
+        VkSampler sampler;
+        if (vkCreateSampler(_device.GetDevice(), &key.info, nullptr, &sampler) != VK_SUCCESS) {
+            Utils::Fatal("Failed to create sampler");
+        }
+
+        _samplers.emplace(key, _Entry{ sampler, 1 });
+        _keys.emplace(sampler, key);
+        return sampler;
+    }
+
+    void SamplerCache::Release(VkSampler sampler) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        auto key_it = _keys.find(sampler);
+        if (key_it == _keys.end()) {
+            Utils::Error("Attempted to release a sampler that isn't from the sampler cache");
+            return;
+        }
+
+        auto it = _samplers.find(key_it->second);
+        if (--it->second.refs > 0) {
+            return;
+        }
+
+        // frames in flight may still sample with it
+        _device.GetDeletionQueue().Destroy(sampler);
+        _samplers.erase(it);
+        _keys.erase(key_it);
+    }
+
+    bool SamplerCache::Retain(VkSampler sampler) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        auto key_it = _keys.find(sampler);
+        if (key_it == _keys.end()) {
+            Utils::Error("Attempted to retain a sampler that isn't from the sampler cache");
+            return false;
+        }
+
+        _samplers.at(key_it->second).refs++;
+        return true;
+    }
+
+    void SamplerCache::LogStats() const {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        Utils::Info("Sampler cache: " + std::to_string(_samplers.size()) + " samplers live, " + std::to_string(_hits) + " of " +
+            std::to_string(_requests) + " requests shared an existing sampler");
+    }
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <volk/volk.h>
+
+#include <mutex>
+#include <unordered_map>
+
+namespace mcvk::Renderer {
+    class Device;
+
+    // Hands out samplers shared between every user asking for identical create info, so that textures with the same filtering
+    // (i.e. nearly all of them) use one sampler object, which can also be baked into descriptor set layouts as an immutable
+    // sampler. Samplers are reference counted and destroyed through the deletion queue once their last user releases them.
+    class SamplerCache {
+    public:
+        SamplerCache(const Device &device);
+        ~SamplerCache();
+
+        SamplerCache(const SamplerCache &) = delete;
+        SamplerCache &operator=(const SamplerCache &) = delete;
+
+        // pNext chains aren't considered, and must be null
+        VkSampler Acquire(const VkSamplerCreateInfo &info);
+        void Release(VkSampler sampler);
+        // take another reference to a sampler from the cache, e.g. for a layout it is baked into; returns false (with an error
+        // reported) if the sampler isn't from the cache
+        bool Retain(VkSampler sampler);
+
+        void LogStats() const;
+
+    private:
+        struct _Key {
+            VkSamplerCreateInfo info;
+
+            bool operator==(const _Key &other) const;
+        };
+        struct _KeyHash {
+            size_t operator()(const _Key &key) const;
+        };
+
+        struct _Entry {
+            VkSampler sampler;
+            uint32_t refs;
+        };
+
+        const Device &_device;
+
+        std::unordered_map<_Key, _Entry, _KeyHash> _samplers;
+        std::unordered_map<VkSampler, _Key> _keys;
+
+        uint64_t _requests{0};
+        uint64_t _hits{0};
+
+        mutable std::mutex _mutex;
+    };
+}
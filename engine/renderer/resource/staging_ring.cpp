@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "staging_ring.hpp"
+
+#include "renderer/device.hpp"
+#include "utils/log.hpp"
+
+namespace mcvk::Renderer {
+    StagingRing::StagingRing(const Device &device, VkDeviceSize capacity)
+        : _device{device}, _capacity{capacity} {
+        // the ring is only ever read by the transfer queue, so it doesn't need to be shared with other families
+        VkBufferCreateInfo create_info{};
+        create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        create_info.size = _capacity;
+        create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateBuffer(_device.GetDevice(), &create_info, nullptr, &_buffer) != VK_SUCCESS) {
+            Utils::Fatal("Failed to create staging ring buffer object");
+        }
+
+        _allocation = _device.GetAllocator().AllocateForBuffer(_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, MemoryCategory::Staging);
+        if (!_allocation.mapped) {
+            Utils::Fatal("Failed to map staging ring buffer to host memory");
+        }
+    }
+
+    StagingRing::~StagingRing() {
+        vkDestroyBuffer(_device.GetDevice(), _buffer, nullptr);
+        _device.GetAllocator().Free(_allocation);
+    }
+
+    bool StagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment, Region &region) {
+        if (size > _capacity) {
+            return false;
+        }
+
+        // nothing is in use, so start again from the beginning of the buffer to get the largest possible contiguous range
+        if (_head == _tail) {
+            _head = (_head + _capacity - 1) / _capacity * _capacity;
+            _tail = _head;
+        }
+
+        uint64_t start = (_head + alignment - 1) / alignment * alignment;
+        VkDeviceSize pos = start % _capacity;
+
+        // not enough room before the end of the buffer - skip the remainder and wrap around to the start
+        if (pos + size > _capacity) {
+            start += _capacity - pos;
+            pos = 0;
+        }
+
+        if (start + size - _tail > _capacity) {
+            return false;
+        }
+
+        _head = start + size;
+
+        region.buffer = _buffer;
+        region.offset = pos;
+        region.mapped = static_cast<char *>(_allocation.mapped) + pos;
+        return true;
+    }
+
+    void StagingRing::Reclaim(uint64_t mark) {
+        if (mark > _tail) {
+            _tail = mark;
+        }
+    }
+
+    void StagingRing::Flush(VkDeviceSize offset, VkDeviceSize size) const {
+        _device.GetAllocator().Flush(_allocation, size, offset);
+    }
+}
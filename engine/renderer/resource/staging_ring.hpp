@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include "renderer/memory/allocator.hpp"
+
+#include <volk/volk.h>
+
+namespace mcvk::Renderer {
+    class Device;
+
+    // A single persistently mapped, host-visible buffer that staging data is streamed through. Space is handed out linearly and
+    // wraps around at the end; it is given back in the same order by Reclaim() once the GPU work reading it has completed.
+    class StagingRing {
+    public:
+        struct Region {
+            VkBuffer buffer;
+            VkDeviceSize offset;
+            void *mapped;
+        };
+
+        StagingRing(const Device &device, VkDeviceSize capacity);
+        ~StagingRing();
+
+        StagingRing(const StagingRing &) = delete;
+        StagingRing &operator=(const StagingRing &) = delete;
+
+        // returns false if there isn't currently enough contiguous free space (or the size exceeds the capacity outright)
+        bool Allocate(VkDeviceSize size, VkDeviceSize alignment, Region &region);
+        // release everything allocated before the given mark (a value previously returned by GetMark())
+        void Reclaim(uint64_t mark);
+
+        void Flush(VkDeviceSize offset, VkDeviceSize size) const;
+
+        // positions are absolute byte counts that only ever increase; the offset into the buffer is the position modulo capacity
+        inline uint64_t GetMark() const { return _head; }
+        inline VkDeviceSize GetCapacity() const { return _capacity; }
+        inline VkDeviceSize GetUsedSize() const { return _head - _tail; }
+
+    private:
+        const Device &_device;
+
+        VkDeviceSize _capacity;
+
+        VkBuffer _buffer{VK_NULL_HANDLE};
+        MemoryAllocation _allocation{};
+
+        uint64_t _head{0};
+        uint64_t _tail{0};
+    };
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "uniform_allocator.hpp"
+
+#include "renderer/renderer.hpp"
+#include "utils/log.hpp"
+
+#include <cstring>
+
+namespace mcvk::Renderer {
+    UniformAllocator::UniformAllocator(const Renderer &renderer, VkDeviceSize capacity)
+        : UniformBuffer{renderer, capacity} {
+    }
+
+    uint32_t UniformAllocator::Push(const void *data, VkDeviceSize size) {
+        // first push of a new frame - the frame slot has been waited on, so its region is free to overwrite from the start
+        if (_frame_number != _renderer.GetFrameNumber()) {
+            _frame_number = _renderer.GetFrameNumber();
+            _head = 0;
+        }
+
+        VkDeviceSize aligned = AlignOffset(_device, size);
+        if (_head + aligned > _frame_stride) {
+            Utils::Fatal("Uniform allocator exhausted (" + std::to_string(_frame_stride) + " bytes per frame)");
+        }
+
+        uint32_t offset = GetFrameOffset() + static_cast<uint32_t>(_head);
+        std::memcpy(static_cast<char *>(_mapped) + offset, data, static_cast<size_t>(size));
+
+        _head += aligned;
+        if (_head > _peak) {
+            _peak = _head;
+        }
+
+        return offset;
+    }
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include "renderer/resource/buffer.hpp"
+
+namespace mcvk::Renderer {
+    // A per-frame linear allocator for short-lived uniform data, e.g. per-object transforms. Each frame in flight owns one region
+    // of a single host-coherent buffer; Push() appends to the current frame's region and returns the dynamic offset to bind the
+    // data with. The region is recycled automatically the first time Push() is called in a new frame.
+    class UniformAllocator : public UniformBuffer {
+    public:
+        // capacity is the number of bytes available to each frame
+        UniformAllocator(const Renderer &renderer, VkDeviceSize capacity);
+
+        uint32_t Push(const void *data, VkDeviceSize size);
+        template <typename T>
+        inline uint32_t Push(const T &data) { return Push(&data, sizeof(T)); }
+
+        inline VkDeviceSize GetUsedSize() const { return _head; }
+        inline VkDeviceSize GetPeakUsedSize() const { return _peak; }
+
+    private:
+        VkDeviceSize _head{0};
+        VkDeviceSize _peak{0};
+        uint64_t _frame_number{0};
+    };
+}
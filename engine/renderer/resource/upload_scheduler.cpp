@@ -0,0 +1,701 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "upload_scheduler.hpp"
+
+#include "renderer/device.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+namespace mcvk::Renderer {
+    UploadScheduler::Config UploadScheduler::Config::Defaults() {
+        Config config{};
+
+        config.staging_budget = 32ull * 1024 * 1024;
+
+        return config;
+    }
+
+    UploadScheduler::UploadScheduler(const Device &device, const Config &config)
+        : _device{device},
+        _ring{device, (config.staging_budget + _STAGING_ALIGNMENT - 1) / _STAGING_ALIGNMENT * _STAGING_ALIGNMENT} {
+        QueueFamilyIndices families = _device.FindQueueFamilyIndices();
+        _graphics_family = families.graphics.value();
+        _transfer_family = families.transfer.value();
+
+        uint32_t family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(_device.GetPhysicalDevice(), &family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> family_props(family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(_device.GetPhysicalDevice(), &family_count, family_props.data());
+        _can_blit = family_props[_transfer_family].queueFlags & VK_QUEUE_GRAPHICS_BIT;
+    }
+
+    UploadScheduler::~UploadScheduler() {
+        WaitIdle();
+
+        // an unsubmitted batch only exists if recording was opened and never flushed, which WaitIdle() rules out
+        for (Batch &batch : _free_batches) {
+            vkDestroyFence(_device.GetDevice(), batch.fence, nullptr);
+            vkFreeCommandBuffers(_device.GetDevice(), _device.GetTransferCommandPool(), 1, &batch.cmdbuf);
+        }
+
+        for (const std::vector<VkSemaphore> &frame_sems : _awaiting_release_sems) {
+            _free_sems.insert(_free_sems.end(), frame_sems.begin(), frame_sems.end());
+        }
+        for (std::vector<VkSemaphore> *sems : { &_signalled_sems, &_free_sems }) {
+            for (VkSemaphore s : *sems) {
+                vkDestroySemaphore(_device.GetDevice(), s, nullptr);
+            }
+        }
+    }
+
+    UploadScheduler::Ticket UploadScheduler::UploadToBuffer(VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        // buffer copies can be split freely, so anything bigger than the ring is streamed through it in pieces
+        VkDeviceSize chunk_size = std::max<VkDeviceSize>(_ring.GetCapacity() / 2, _STAGING_ALIGNMENT);
+
+        _BeginBufferWrite(dst);
+
+        VkDeviceSize done = 0;
+        while (done < size) {
+            VkDeviceSize chunk = std::min(size - done, chunk_size);
+
+            StagingRing::Region stage;
+            _AllocateStaging(chunk, stage);
+            std::memcpy(stage.mapped, static_cast<const char *>(data) + done, static_cast<size_t>(chunk));
+            _ring.Flush(stage.offset, chunk);
+
+            VkBufferCopy copy_region{};
+            copy_region.size = chunk;
+            copy_region.srcOffset = stage.offset;
+            copy_region.dstOffset = dst_offset + done;
+            vkCmdCopyBuffer(_GetRecordingCommandBuffer(), stage.buffer, dst, 1, &copy_region);
+
+            done += chunk;
+        }
+        _TransferBuffer(dst);
+
+        _frame_stats.bytes_staged += size;
+        return _next_ticket;
+    }
+
+    UploadScheduler::Ticket UploadScheduler::UploadToImage(VkImage dst, const void *data, VkDeviceSize size,
+        const std::vector<VkBufferImageCopy> &regions, const VkImageSubresourceRange &range, VkImageLayout final_layout, bool generate_mips) {
+        return UploadToImages(data, size, { { dst, regions, range, final_layout, generate_mips } });
+    }
+
+    UploadScheduler::Ticket UploadScheduler::UploadToImages(const void *data, VkDeviceSize size, const std::vector<ImageCopy> &copies) {
+        StagingRing::Region stage;
+
+        // image copies aren't split into rows, so a one-off staging buffer is used when the ring is too small. It is allocated
+        // before taking the lock, as an over-budget allocation runs eviction callbacks, which may destroy resources and so call
+        // back into CancelAcquire()
+        VkBuffer temp = VK_NULL_HANDLE;
+        MemoryAllocation temp_alloc{};
+        if (size > _ring.GetCapacity()) {
+            _CreateTemporaryStage(size, &temp, &temp_alloc, stage);
+
+            std::memcpy(stage.mapped, data, static_cast<size_t>(size));
+            _device.GetAllocator().Flush(temp_alloc);
+        }
+
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        if (temp != VK_NULL_HANDLE) {
+            _GetRecordingCommandBuffer();
+            _recording.releases.push_back({ temp, temp_alloc });
+            _frame_stats.oversized_uploads++;
+        } else {
+            _AllocateStaging(size, stage);
+            std::memcpy(stage.mapped, data, static_cast<size_t>(size));
+            _ring.Flush(stage.offset, size);
+        }
+
+        _RecordImageCopies(_GetRecordingCommandBuffer(), stage.buffer, stage.offset, copies);
+
+        _frame_stats.bytes_staged += size;
+        return _next_ticket;
+    }
+
+    UploadScheduler::Ticket UploadScheduler::CopyBuffer(VkBuffer src, VkBuffer dst, const VkBufferCopy &region) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _BeginBufferWrite(dst);
+        vkCmdCopyBuffer(_GetRecordingCommandBuffer(), src, dst, 1, &region);
+        _TransferBuffer(dst);
+
+        return _next_ticket;
+    }
+
+    UploadScheduler::Ticket UploadScheduler::CopyBufferToImage(VkBuffer src, VkImage dst, const std::vector<VkBufferImageCopy> &regions,
+        const VkImageSubresourceRange &range, VkImageLayout final_layout) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _RecordImageCopies(_GetRecordingCommandBuffer(), src, 0, { { dst, regions, range, final_layout, false } });
+
+        return _next_ticket;
+    }
+
+    void UploadScheduler::ReleaseOnComplete(VkBuffer buffer, const MemoryAllocation &allocation) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _GetRecordingCommandBuffer();
+        _recording.releases.push_back({ buffer, allocation });
+    }
+
+    UploadScheduler::Ticket UploadScheduler::Flush() {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        return _Flush();
+    }
+
+    void UploadScheduler::EndFrame() {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _Flush();
+
+        _last_frame_stats = _frame_stats;
+        _total_stats.bytes_staged += _frame_stats.bytes_staged;
+        _total_stats.ring_stalls += _frame_stats.ring_stalls;
+        _total_stats.oversized_uploads += _frame_stats.oversized_uploads;
+        _peak_frame_bytes = std::max(_peak_frame_bytes, _frame_stats.bytes_staged);
+        _frame_stats = {};
+        _frame_count++;
+    }
+
+    bool UploadScheduler::IsComplete(Ticket ticket) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _RetireCompleted();
+        return ticket <= _completed_ticket;
+    }
+
+    void UploadScheduler::Wait(Ticket ticket) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        // waiting on the batch that is still being recorded means it has to be submitted first
+        if (ticket == _next_ticket) {
+            _Flush();
+        }
+
+        for (Batch &batch : _in_flight) {
+            if (batch.ticket > ticket) {
+                break;
+            }
+            vkWaitForFences(_device.GetDevice(), 1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        }
+
+        _RetireCompleted();
+    }
+
+    void UploadScheduler::WaitIdle() {
+        Wait(Flush());
+    }
+
+    std::vector<VkSemaphore> UploadScheduler::TakeWaitSemaphores(uint32_t frame, VkCommandBuffer acquire_cmdbuf) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        if (acquire_cmdbuf == VK_NULL_HANDLE && (!_pending_buffer_acquires.empty() || !_pending_image_acquires.empty())) {
+            Utils::Error("Uploaded resources were not acquired by the graphics queue (no acquire command buffer given)");
+        }
+        _RecordPendingAcquires(acquire_cmdbuf);
+
+        if (frame >= _awaiting_release_sems.size()) {
+            _awaiting_release_sems.resize(frame + 1);
+        }
+
+        std::vector<VkSemaphore> sems = _signalled_sems;
+        _awaiting_release_sems[frame].insert(_awaiting_release_sems[frame].end(), _signalled_sems.begin(), _signalled_sems.end());
+        _signalled_sems.clear();
+
+        return sems;
+    }
+
+    void UploadScheduler::ReleaseWaitSemaphores(uint32_t frame) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        if (frame >= _awaiting_release_sems.size()) {
+            return;
+        }
+
+        _free_sems.insert(_free_sems.end(), _awaiting_release_sems[frame].begin(), _awaiting_release_sems[frame].end());
+        _awaiting_release_sems[frame].clear();
+    }
+
+    void UploadScheduler::TrackGraphicsUse(VkBuffer buffer) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _buffer_owners[buffer] = _BufferOwner::Graphics;
+    }
+
+    void UploadScheduler::CancelAcquire(VkBuffer buffer) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        std::erase_if(_pending_buffer_acquires, [buffer](const VkBufferMemoryBarrier &b) { return b.buffer == buffer; });
+        std::erase(_recording.written_buffers, buffer);
+        _buffer_owners.erase(buffer);
+    }
+
+    void UploadScheduler::CancelAcquire(VkImage image) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        std::erase_if(_pending_image_acquires, [image](const VkImageMemoryBarrier &b) { return b.image == image; });
+    }
+
+    void UploadScheduler::LogStats() const {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        Stats totals = _total_stats;
+        totals.bytes_staged += _frame_stats.bytes_staged;
+        totals.ring_stalls += _frame_stats.ring_stalls;
+        totals.oversized_uploads += _frame_stats.oversized_uploads;
+
+        std::stringstream stream{};
+        stream << "Upload scheduler statistics (" << (_ring.GetCapacity() / 1024) << " KiB staging ring):" << std::endl
+            << "\t" << (totals.bytes_staged / 1024) << " KiB staged over " << _frame_count << " frame(s), peak "
+            << (_peak_frame_bytes / 1024) << " KiB in one frame" << std::endl
+            << "\t" << totals.ring_stalls << " stall(s) waiting on ring space, " << totals.oversized_uploads << " oversized upload(s)";
+
+        Utils::Info(stream.str());
+    }
+
+    UploadScheduler::Ticket UploadScheduler::_Flush() {
+        _RetireCompleted();
+
+        if (!_recording_open) {
+            return _next_ticket - 1;
+        }
+
+        _RecordReleases();
+
+        if (vkEndCommandBuffer(_recording.cmdbuf) != VK_SUCCESS) {
+            Utils::Fatal("Failed to record upload command buffer");
+        }
+
+        VkSemaphore signal = _GetSemaphore();
+
+        std::vector<VkPipelineStageFlags> wait_stages(_recording.wait_sems.size(), VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.waitSemaphoreCount = static_cast<uint32_t>(_recording.wait_sems.size());
+        submit_info.pWaitSemaphores = _recording.wait_sems.data();
+        submit_info.pWaitDstStageMask = wait_stages.data();
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &_recording.cmdbuf;
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &signal;
+
+        {
+            auto queue_lock = _device.LockQueue(_device.GetTransferQueue());
+            if (vkQueueSubmit(_device.GetTransferQueue(), 1, &submit_info, _recording.fence) != VK_SUCCESS) {
+                Utils::Fatal("Failed to submit upload command buffer to transfer queue");
+            }
+        }
+
+        _signalled_sems.push_back(signal);
+
+        // a resource written again before its last release was acquired only needs acquiring once
+        for (const VkBufferMemoryBarrier &b : _recording.buffer_transfers) {
+            std::erase_if(_pending_buffer_acquires, [&b](const VkBufferMemoryBarrier &p) { return p.buffer == b.buffer; });
+            _pending_buffer_acquires.push_back(b);
+        }
+        for (const VkImageMemoryBarrier &b : _recording.image_transfers) {
+            std::erase_if(_pending_image_acquires, [&b](const VkImageMemoryBarrier &p) {
+                return p.image == b.image && p.subresourceRange.baseMipLevel == b.subresourceRange.baseMipLevel &&
+                       p.subresourceRange.baseArrayLayer == b.subresourceRange.baseArrayLayer;
+            });
+            _pending_image_acquires.push_back(b);
+        }
+        _recording.buffer_transfers.clear();
+        _recording.image_transfers.clear();
+
+        // from here on the graphics queue may read what the batch wrote
+        for (VkBuffer buffer : _recording.written_buffers) {
+            _buffer_owners[buffer] = TransfersOwnership() ? _BufferOwner::ReleasedToGraphics : _BufferOwner::Graphics;
+        }
+        _recording.written_buffers.clear();
+        _recording.retire_sems.insert(_recording.retire_sems.end(), _recording.wait_sems.begin(), _recording.wait_sems.end());
+        _recording.wait_sems.clear();
+
+        _recording.ring_mark = _ring.GetMark();
+
+        Ticket ticket = _recording.ticket;
+        _in_flight.push_back(std::move(_recording));
+        _recording = {};
+        _recording_open = false;
+        _next_ticket++;
+
+        return ticket;
+    }
+
+    bool UploadScheduler::_AllocateStaging(VkDeviceSize size, StagingRing::Region &region) {
+        if (size > _ring.GetCapacity()) {
+            return false;
+        }
+
+        while (!_ring.Allocate(size, _STAGING_ALIGNMENT, region)) {
+            // the ring is exhausted: submit what has been recorded so far and block until the oldest batch gives its space back
+            _frame_stats.ring_stalls++;
+
+            if (_recording_open) {
+                _Flush();
+            }
+            if (_in_flight.empty()) {
+                Utils::Fatal("Staging ring exhausted with no uploads in flight");
+            }
+
+            vkWaitForFences(_device.GetDevice(), 1, &_in_flight.front().fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+            _RetireCompleted();
+        }
+        return true;
+    }
+
+    void UploadScheduler::_CreateTemporaryStage(VkDeviceSize size, VkBuffer *buffer, MemoryAllocation *allocation, StagingRing::Region &region) {
+        VkBufferCreateInfo create_info{};
+        create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        create_info.size = size;
+        create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateBuffer(_device.GetDevice(), &create_info, nullptr, buffer) != VK_SUCCESS) {
+            Utils::Fatal("Failed to create temporary staging buffer object");
+        }
+
+        *allocation = _device.GetAllocator().AllocateForBuffer(*buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, MemoryCategory::Staging);
+
+        region.buffer = *buffer;
+        region.offset = 0;
+        region.mapped = allocation->mapped;
+    }
+
+    VkCommandBuffer UploadScheduler::_GetRecordingCommandBuffer() {
+        if (_recording_open) {
+            return _recording.cmdbuf;
+        }
+
+        if (!_free_batches.empty()) {
+            _recording = std::move(_free_batches.back());
+            _free_batches.pop_back();
+        } else {
+            VkCommandBufferAllocateInfo alloc_info{};
+            alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            alloc_info.commandPool = _device.GetTransferCommandPool();
+            alloc_info.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(_device.GetDevice(), &alloc_info, &_recording.cmdbuf) != VK_SUCCESS) {
+                Utils::Fatal("Failed to allocate upload command buffer");
+            }
+
+            VkFenceCreateInfo fence_info{};
+            fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(_device.GetDevice(), &fence_info, nullptr, &_recording.fence) != VK_SUCCESS) {
+                Utils::Fatal("Failed to create upload fence");
+            }
+        }
+        _recording.ticket = _next_ticket;
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(_recording.cmdbuf, &begin_info) != VK_SUCCESS) {
+            Utils::Fatal("Failed to begin recording to upload command buffer");
+        }
+
+        _recording_open = true;
+        return _recording.cmdbuf;
+    }
+
+    void UploadScheduler::_BeginBufferWrite(VkBuffer buffer) {
+        VkCommandBuffer cmdbuf = _GetRecordingCommandBuffer();
+
+        auto owner = _buffer_owners.find(buffer);
+        if (owner == _buffer_owners.end()) {
+            // copies recorded into the same batch aren't ordered against each other without a barrier
+            if (std::find(_recording.written_buffers.begin(), _recording.written_buffers.end(), buffer) != _recording.written_buffers.end()) {
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr,
+                    0, nullptr);
+            } else {
+                _recording.written_buffers.push_back(buffer);
+            }
+            return;
+        }
+
+        // the buffer was handed to the graphics queue, and frames already submitted may still be reading it. A graphics-queue
+        // submission signals a semaphore the batch waits on, so the write is ordered after all of them
+        TransientCommandPool &graphics = _device.GetGraphicsTransientPool();
+        VkCommandBuffer graphics_cmdbuf = graphics.Begin();
+        std::vector<VkSemaphore> graphics_waits;
+
+        if (TransfersOwnership()) {
+            if (owner->second == _BufferOwner::ReleasedToGraphics) {
+                // the graphics queue can only release what it has acquired, so the acquires waiting for the next frame are recorded
+                // here instead, with the semaphores of the batches they came from
+                graphics_waits = _signalled_sems;
+                _signalled_sems.clear();
+                _RecordPendingAcquires(graphics_cmdbuf);
+            }
+
+            // released on the graphics queue, and acquired by the transfer queue before the copy. The whole buffer changes owner,
+            // so the parts not written keep their contents
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = 0;
+            barrier.srcQueueFamilyIndex = _graphics_family;
+            barrier.dstQueueFamilyIndex = _transfer_family;
+            barrier.buffer = buffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            vkCmdPipelineBarrier(graphics_cmdbuf, WAIT_STAGES, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier,
+                0, nullptr);
+
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier,
+                0, nullptr);
+        }
+
+        VkSemaphore signal = _GetSemaphore();
+        graphics.Submit(graphics_cmdbuf, graphics_waits, std::vector<VkPipelineStageFlags>(graphics_waits.size(), WAIT_STAGES), { signal });
+
+        // the graphics submission's waits have finished by the time the batch has, so their semaphores are reused along with it
+        _recording.wait_sems.push_back(signal);
+        _recording.retire_sems.insert(_recording.retire_sems.end(), graphics_waits.begin(), graphics_waits.end());
+
+        _buffer_owners.erase(owner);
+        _recording.written_buffers.push_back(buffer);
+    }
+
+    void UploadScheduler::_RecordPendingAcquires(VkCommandBuffer cmdbuf) {
+        if (cmdbuf != VK_NULL_HANDLE && (!_pending_buffer_acquires.empty() || !_pending_image_acquires.empty())) {
+            // the source scope matches the semaphore wait stages so that the acquire is chained after the release
+            for (VkBufferMemoryBarrier &b : _pending_buffer_acquires) {
+                b.srcAccessMask = 0;
+            }
+            for (VkImageMemoryBarrier &b : _pending_image_acquires) {
+                b.srcAccessMask = 0;
+            }
+            vkCmdPipelineBarrier(cmdbuf, WAIT_STAGES, WAIT_STAGES, 0, 0, nullptr,
+                static_cast<uint32_t>(_pending_buffer_acquires.size()), _pending_buffer_acquires.data(),
+                static_cast<uint32_t>(_pending_image_acquires.size()), _pending_image_acquires.data());
+        }
+
+        for (const VkBufferMemoryBarrier &b : _pending_buffer_acquires) {
+            auto owner = _buffer_owners.find(b.buffer);
+            if (owner != _buffer_owners.end()) {
+                owner->second = _BufferOwner::Graphics;
+            }
+        }
+        _pending_buffer_acquires.clear();
+        _pending_image_acquires.clear();
+    }
+
+    void UploadScheduler::_RecordImageCopies(VkCommandBuffer cmdbuf, VkBuffer src, VkDeviceSize src_offset, const std::vector<ImageCopy> &copies) {
+        if (copies.empty()) {
+            return;
+        }
+
+        std::vector<VkImageMemoryBarrier> barriers(copies.size());
+        for (size_t i = 0; i < copies.size(); i++) {
+            VkImageMemoryBarrier &barrier = barriers[i];
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = copies[i].dst;
+            barrier.subresourceRange = copies[i].range;
+
+            // UNDEFINED -> TRANSFER-DST: transfer writes that don't need to wait on anything
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        }
+        vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+            static_cast<uint32_t>(barriers.size()), barriers.data());
+
+        std::vector<VkBufferImageCopy> regions;
+        for (size_t i = 0; i < copies.size(); i++) {
+            const ImageCopy &copy = copies[i];
+
+            regions = copy.regions;
+            for (VkBufferImageCopy &r : regions) {
+                r.bufferOffset += src_offset;
+            }
+            vkCmdCopyBufferToImage(cmdbuf, src, copy.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()),
+                regions.data());
+
+            // the whole image ends up in this layout before the final transition
+            barriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            if (copy.generate_mips) {
+                _RecordMipBlits(cmdbuf, copy.dst, copy.range, copy.regions[0].imageExtent);
+                barriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            }
+            barriers[i].newLayout = copy.final_layout;
+            barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        }
+
+        // with an ownership transfer, the transition to the final layout is done by the release/acquire pair instead
+        if (TransfersOwnership()) {
+            for (VkImageMemoryBarrier &barrier : barriers) {
+                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                barrier.srcQueueFamilyIndex = _transfer_family;
+                barrier.dstQueueFamilyIndex = _graphics_family;
+
+                std::erase_if(_recording.image_transfers, [&barrier](const VkImageMemoryBarrier &b) {
+                    return b.image == barrier.image && b.subresourceRange.baseMipLevel == barrier.subresourceRange.baseMipLevel &&
+                           b.subresourceRange.baseArrayLayer == barrier.subresourceRange.baseArrayLayer;
+                });
+                _recording.image_transfers.push_back(barrier);
+            }
+            return;
+        }
+
+        // TRANSFER-DST -> final layout: the transfer queue may not support shader stages, so the batch's semaphore (waited on by
+        // the graphics queue) is what makes the writes visible to later reads
+        for (VkImageMemoryBarrier &barrier : barriers) {
+            barrier.dstAccessMask = 0;
+        }
+        vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+            static_cast<uint32_t>(barriers.size()), barriers.data());
+    }
+
+    void UploadScheduler::_RecordMipBlits(VkCommandBuffer cmdbuf, VkImage image, const VkImageSubresourceRange &range, VkExtent3D extent) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = range;
+        barrier.subresourceRange.levelCount = 1;
+
+        // every level starts out as a copy/blit destination, and is switched to a source once it has been written
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        int32_t w = static_cast<int32_t>(extent.width);
+        int32_t h = static_cast<int32_t>(extent.height);
+
+        uint32_t last = range.baseMipLevel + range.levelCount - 1;
+        for (uint32_t level = range.baseMipLevel; level <= last; level++) {
+            barrier.subresourceRange.baseMipLevel = level;
+            vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            if (level == last) {
+                break;
+            }
+
+            int32_t next_w = std::max(w / 2, 1);
+            int32_t next_h = std::max(h / 2, 1);
+
+            VkImageBlit blit{};
+            blit.srcSubresource.aspectMask = range.aspectMask;
+            blit.srcSubresource.mipLevel = level;
+            blit.srcSubresource.baseArrayLayer = range.baseArrayLayer;
+            blit.srcSubresource.layerCount = range.layerCount;
+            blit.srcOffsets[1] = { w, h, 1 };
+            blit.dstSubresource = blit.srcSubresource;
+            blit.dstSubresource.mipLevel = level + 1;
+            blit.dstOffsets[1] = { next_w, next_h, 1 };
+            vkCmdBlitImage(cmdbuf, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                VK_FILTER_LINEAR);
+
+            w = next_w;
+            h = next_h;
+        }
+    }
+
+    void UploadScheduler::_TransferBuffer(VkBuffer buffer) {
+        if (!TransfersOwnership()) {
+            return;
+        }
+        for (const VkBufferMemoryBarrier &b : _recording.buffer_transfers) {
+            if (b.buffer == buffer) {
+                return;
+            }
+        }
+
+        // the whole buffer changes owner, as parts not covered by a transfer would be left undefined to the graphics queue
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask =
+            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        barrier.srcQueueFamilyIndex = _transfer_family;
+        barrier.dstQueueFamilyIndex = _graphics_family;
+        barrier.buffer = buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        _recording.buffer_transfers.push_back(barrier);
+    }
+
+    void UploadScheduler::_RecordReleases() {
+        if (_recording.buffer_transfers.empty() && _recording.image_transfers.empty()) {
+            return;
+        }
+
+        // destination access masks are ignored for a release, so the stored barriers are recorded as-is and reused to acquire
+        vkCmdPipelineBarrier(_recording.cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+            static_cast<uint32_t>(_recording.buffer_transfers.size()), _recording.buffer_transfers.data(),
+            static_cast<uint32_t>(_recording.image_transfers.size()), _recording.image_transfers.data());
+    }
+
+    void UploadScheduler::_RetireCompleted() {
+        // batches go to a single queue and are retired strictly in order so that a ticket being complete implies all earlier
+        // tickets are too
+        while (!_in_flight.empty() && vkGetFenceStatus(_device.GetDevice(), _in_flight.front().fence) == VK_SUCCESS) {
+            Batch batch = std::move(_in_flight.front());
+            _in_flight.pop_front();
+
+            _completed_ticket = batch.ticket;
+            _ring.Reclaim(batch.ring_mark);
+            _RetireBatch(batch);
+        }
+    }
+
+    void UploadScheduler::_RetireBatch(Batch &batch) {
+        for (Release &r : batch.releases) {
+            vkDestroyBuffer(_device.GetDevice(), r.buffer, nullptr);
+            _device.GetAllocator().Free(r.allocation);
+        }
+        batch.releases.clear();
+
+        _free_sems.insert(_free_sems.end(), batch.retire_sems.begin(), batch.retire_sems.end());
+        batch.retire_sems.clear();
+
+        vkResetFences(_device.GetDevice(), 1, &batch.fence);
+        vkResetCommandBuffer(batch.cmdbuf, 0);
+
+        _free_batches.push_back(std::move(batch));
+    }
+
+    VkSemaphore UploadScheduler::_GetSemaphore() {
+        if (!_free_sems.empty()) {
+            VkSemaphore s = _free_sems.back();
+            _free_sems.pop_back();
+            return s;
+        }
+
+        VkSemaphoreCreateInfo sem_info{};
+        sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        VkSemaphore s;
+        if (vkCreateSemaphore(_device.GetDevice(), &sem_info, nullptr, &s) != VK_SUCCESS) {
+            Utils::Fatal("Failed to create upload semaphore");
+        }
+        return s;
+    }
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include "renderer/memory/allocator.hpp"
+#include "renderer/resource/staging_ring.hpp"
+
+#include <volk/volk.h>
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace mcvk::Renderer {
+    class Device;
+
+    // Collects staging copies from any number of buffers and images into a single transfer-queue command buffer, which is
+    // submitted as one batch when flushed (the renderer does this once per frame). Each batch signals a fence that can be polled
+    // via its ticket, and a semaphore that the next graphics submission waits on so that draws never see half-uploaded data.
+    // Upload data is staged through a shared ring buffer whose space is reclaimed as batches complete.
+    //
+    // Destination resources are created with exclusive sharing. When the transfer queue is in a different family to the graphics
+    // queue, each batch ends by releasing ownership of everything it wrote, and the matching acquire barriers are handed out
+    // alongside the batch's semaphore to be recorded on the graphics queue.
+    //
+    // Writing again to a buffer that an earlier batch handed to the graphics queue first submits a small graphics-queue command
+    // buffer, which the batch waits on: that orders the write after every frame already submitted (which may still be reading
+    // the buffer), and releases the buffer back to the transfer queue if ownership is transferred.
+    class UploadScheduler {
+    public:
+        // identifies the batch a copy was recorded into; tickets increase monotonically, 0 is always complete
+        using Ticket = uint64_t;
+
+        // stages of the graphics submission that wait on upload semaphores, i.e. those that may read uploaded data
+        static constexpr VkPipelineStageFlags WAIT_STAGES =
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+        struct Config {
+            // size of the staging ring; uploads larger than this get a temporary staging buffer of their own
+            VkDeviceSize staging_budget;
+
+            static Config Defaults();
+        };
+
+        // one image's share of a multi-image upload
+        struct ImageCopy {
+            VkImage dst;
+            // buffer offsets are relative to the uploaded data
+            std::vector<VkBufferImageCopy> regions;
+            VkImageSubresourceRange range;
+            VkImageLayout final_layout;
+            // see UploadToImage()
+            bool generate_mips;
+        };
+
+        struct Stats {
+            VkDeviceSize bytes_staged{0};
+            // times an upload had to wait for the GPU to release ring space
+            uint32_t ring_stalls{0};
+            // uploads that were too large for the ring
+            uint32_t oversized_uploads{0};
+        };
+
+        UploadScheduler(const Device &device, const Config &config);
+        ~UploadScheduler();
+
+        UploadScheduler(const UploadScheduler &) = delete;
+        UploadScheduler &operator=(const UploadScheduler &) = delete;
+
+        // stage the given data and record a copy of it into the buffer
+        Ticket UploadToBuffer(VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size);
+        // stage the given data and record a copy of it into the image; the regions' buffer offsets are relative to data. If
+        // generate_mips is set, the first region must cover the base level and the rest of range is filled by blitting down
+        // from it, which needs CanBlit() and a format that supports linear blits.
+        Ticket UploadToImage(VkImage dst, const void *data, VkDeviceSize size, const std::vector<VkBufferImageCopy> &regions,
+            const VkImageSubresourceRange &range, VkImageLayout final_layout, bool generate_mips = false);
+        // stage data for any number of images in one allocation, and record a single barrier into transfer-dst for all of them,
+        // their copies (and mip blits), then a single barrier (or set of ownership releases) out to their final layouts
+        Ticket UploadToImages(const void *data, VkDeviceSize size, const std::vector<ImageCopy> &copies);
+
+        Ticket CopyBuffer(VkBuffer src, VkBuffer dst, const VkBufferCopy &region);
+        // the image is transitioned from UNDEFINED to transfer-dst, copied into, and then transitioned to final_layout
+        Ticket CopyBufferToImage(VkBuffer src, VkImage dst, const std::vector<VkBufferImageCopy> &regions,
+            const VkImageSubresourceRange &range, VkImageLayout final_layout);
+
+        // destroy a (staging) buffer and free its memory once the batch currently being recorded has completed
+        void ReleaseOnComplete(VkBuffer buffer, const MemoryAllocation &allocation);
+
+        // submit all copies recorded so far, returning the ticket of the submitted batch
+        Ticket Flush();
+        // flush and roll the per-frame counters over; called by the renderer once per frame
+        void EndFrame();
+
+        bool IsComplete(Ticket ticket);
+        void Wait(Ticket ticket);
+        void WaitIdle();
+
+        // semaphores signalled by submitted batches that have not yet been waited on by a graphics submission; the caller
+        // must wait on all of them and then hand them back via ReleaseWaitSemaphores() with the same frame index once that
+        // frame's submission has completed. If TransfersOwnership(), the batches' acquire barriers are recorded into
+        // acquire_cmdbuf, which must be recording and be submitted to the graphics queue in the same batch as the wait.
+        std::vector<VkSemaphore> TakeWaitSemaphores(uint32_t frame, VkCommandBuffer acquire_cmdbuf = VK_NULL_HANDLE);
+        void ReleaseWaitSemaphores(uint32_t frame);
+
+        // for a buffer the host has written directly and handed to the graphics queue: later uploads into it are then ordered
+        // after the frames already submitted, as for buffers written through the scheduler
+        void TrackGraphicsUse(VkBuffer buffer);
+
+        // drop any ownership acquire (or tracked owner) still pending for a resource that is about to be destroyed
+        void CancelAcquire(VkBuffer buffer);
+        void CancelAcquire(VkImage image);
+
+        // true if the transfer and graphics queues are in different families, so uploads need ownership transfers
+        inline bool TransfersOwnership() const { return _transfer_family != _graphics_family; }
+        // true if the upload queue supports blits (i.e. is graphics-capable), so mip chains can be generated on the GPU
+        inline bool CanBlit() const { return _can_blit; }
+
+        inline Ticket GetPendingTicket() const { return _next_ticket; }
+        inline const Stats &GetLastFrameStats() const { return _last_frame_stats; }
+
+        void LogStats() const;
+
+    private:
+        struct Release {
+            VkBuffer buffer;
+            MemoryAllocation allocation;
+        };
+
+        struct Batch {
+            Ticket ticket;
+            VkCommandBuffer cmdbuf;
+            VkFence fence;
+
+            std::vector<Release> releases;
+
+            // ownership release barriers recorded at the end of the batch, which double as the acquire barriers once submitted
+            std::vector<VkBufferMemoryBarrier> buffer_transfers;
+            std::vector<VkImageMemoryBarrier> image_transfers;
+
+            std::vector<VkBuffer> written_buffers;
+            // signalled by graphics-queue submissions the batch waits on before its transfers
+            std::vector<VkSemaphore> wait_sems;
+            // semaphores that can be reused once the batch completes, including those waited on by the submissions above
+            std::vector<VkSemaphore> retire_sems;
+
+            // staging ring position at submission; everything before it can be reused once the batch completes
+            uint64_t ring_mark;
+        };
+
+        // where a buffer written by a submitted batch is; buffers not listed belong to the transfer queue (or are unused)
+        enum class _BufferOwner {
+            // released by the transfer queue, with the acquire not yet recorded on the graphics queue
+            ReleasedToGraphics,
+            Graphics
+        };
+
+        static constexpr VkDeviceSize _STAGING_ALIGNMENT = 16;
+
+        Ticket _Flush();
+        // only sub-allocates from the ring, so never allocates device memory (and never runs eviction) with the lock held
+        bool _AllocateStaging(VkDeviceSize size, StagingRing::Region &region);
+        // allocates device memory, so must be called without the lock held
+        void _CreateTemporaryStage(VkDeviceSize size, VkBuffer *buffer, MemoryAllocation *allocation, StagingRing::Region &region);
+
+        VkCommandBuffer _GetRecordingCommandBuffer();
+        // make the recording batch safe to write to the buffer, taking it back from the graphics queue if needed
+        void _BeginBufferWrite(VkBuffer buffer);
+        void _RecordPendingAcquires(VkCommandBuffer cmdbuf);
+        void _RecordImageCopies(VkCommandBuffer cmdbuf, VkBuffer src, VkDeviceSize src_offset, const std::vector<ImageCopy> &copies);
+        void _RecordMipBlits(VkCommandBuffer cmdbuf, VkImage image, const VkImageSubresourceRange &range, VkExtent3D extent);
+        void _TransferBuffer(VkBuffer buffer);
+        void _RecordReleases();
+        void _RetireCompleted();
+        void _RetireBatch(Batch &batch);
+
+        VkSemaphore _GetSemaphore();
+
+        const Device &_device;
+
+        uint32_t _graphics_family;
+        uint32_t _transfer_family;
+        bool _can_blit;
+
+        StagingRing _ring;
+
+        Batch _recording{};
+        bool _recording_open{false};
+
+        std::deque<Batch> _in_flight;
+        std::vector<Batch> _free_batches;
+
+        Ticket _next_ticket{1};
+        Ticket _completed_ticket{0};
+
+        std::vector<VkSemaphore> _signalled_sems;
+        std::vector<std::vector<VkSemaphore>> _awaiting_release_sems; // indexed by frame
+        std::vector<VkSemaphore> _free_sems;
+
+        // acquire halves of ownership transfers released by submitted batches, recorded with their semaphores
+        std::vector<VkBufferMemoryBarrier> _pending_buffer_acquires;
+        std::vector<VkImageMemoryBarrier> _pending_image_acquires;
+
+        std::unordered_map<VkBuffer, _BufferOwner> _buffer_owners;
+
+        Stats _frame_stats{};
+        Stats _last_frame_stats{};
+        Stats _total_stats{};
+        VkDeviceSize _peak_frame_bytes{0};
+        uint64_t _frame_count{0};
+
+        mutable std::mutex _mutex;
+    };
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "shader_module_cache.hpp"
+
+#include "renderer/device.hpp"
+#include "utils/hash.hpp"
+#include "utils/log.hpp"
+#include "utils/mapped_file.hpp"
+
+#include <cstring>
+
+namespace mcvk::Renderer {
+    static constexpr uint32_t __SPIRV_MAGIC = 0x07230203;
+
+    ShaderModuleCache::ShaderModuleCache(const Device &device)
+        : _device{device} {
+    }
+
+    ShaderModuleCache::~ShaderModuleCache() {
+        if (!_modules.empty()) {
+            Utils::Warn(std::to_string(_modules.size()) + " cached shader modules were still in use at device destruction");
+        }
+        for (auto &[hash, entry] : _modules) {
+            vkDestroyShaderModule(_device.GetDevice(), entry.module, nullptr);
+        }
+    }
+
+    VkShaderModule ShaderModuleCache::Acquire(const std::string &path) {
+        Utils::MappedFile file{path};
+        if (!file.IsMapped()) {
+            Utils::Error("Failed to read SPIR-V at path \"" + path + "\"");
+            return VK_NULL_HANDLE;
+        }
+
+        // mappings are page-aligned, so the code can be passed to the driver as-is
+        uint32_t magic = 0;
+        if (file.GetSize() >= sizeof(magic) && file.GetSize() % sizeof(uint32_t) == 0) {
+            std::memcpy(&magic, file.GetData(), sizeof(magic));
+        }
+        if (magic != __SPIRV_MAGIC) {
+            Utils::Error("File at path \"" + path + "\" is not valid SPIR-V");
+            return VK_NULL_HANDLE;
+        }
+
+        uint64_t hash = Utils::HashBytes(file.GetData(), file.GetSize());
+        const uint32_t *code = reinterpret_cast<const uint32_t *>(file.GetData());
+
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+
+            _requests++;
+
+            auto it = _modules.find(hash);
+            if (it != _modules.end()) {
+                _hits++;
+                it->second.refs++;
+                return it->second.module;
+            }
+        }
+
+        // reflected and created outside the lock so that pipelines being built in parallel don't wait on each other's modules
+        ShaderReflection reflection;
+        if (!ReflectSpirv(code, file.GetSize() / sizeof(uint32_t), reflection)) {
+            Utils::Error("Failed to reflect SPIR-V at path \"" + path + "\"");
+            return VK_NULL_HANDLE;
+        }
+
+        VkShaderModuleCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        info.codeSize = file.GetSize();
+        info.pCode = code;
+
+        VkShaderModule module;
+        if (vkCreateShaderModule(_device.GetDevice(), &info, nullptr, &module) != VK_SUCCESS) {
+            Utils::Error("Failed to create shader module from \"" + path + "\"");
+            return VK_NULL_HANDLE;
+        }
+
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        // another thread may have created the same module in the meantime, in which case theirs is shared
+        auto [it, inserted] = _modules.try_emplace(hash, _Entry{ module, 1, std::move(reflection) });
+        if (!inserted) {
+            vkDestroyShaderModule(_device.GetDevice(), module, nullptr);
+            _hits++;
+            it->second.refs++;
+            return it->second.module;
+        }
+
+        _hashes.emplace(module, hash);
+        return module;
+    }
+
+    void ShaderModuleCache::Release(VkShaderModule module) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        auto hash_it = _hashes.find(module);
+        if (hash_it == _hashes.end()) {
+            Utils::Error("Attempted to release a shader module that isn't from the shader module cache");
+            return;
+        }
+
+        auto it = _modules.find(hash_it->second);
+        if (--it->second.refs > 0) {
+            return;
+        }
+
+        vkDestroyShaderModule(_device.GetDevice(), module, nullptr);
+        _modules.erase(it);
+        _hashes.erase(hash_it);
+    }
+
+    const ShaderReflection &ShaderModuleCache::GetReflection(VkShaderModule module) const {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        auto hash_it = _hashes.find(module);
+        if (hash_it == _hashes.end()) {
+            Utils::Fatal("Attempted to get the reflection of a shader module that isn't from the shader module cache");
+        }
+
+        // entries aren't moved while held, so the reference stays valid until the module is released
+        return _modules.at(hash_it->second).reflection;
+    }
+
+    void ShaderModuleCache::LogStats() const {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        Utils::Info("Shader module cache: " + std::to_string(_modules.size()) + " modules live, " + std::to_string(_hits) + " of " +
+            std::to_string(_requests) + " requests shared an existing module");
+    }
+}
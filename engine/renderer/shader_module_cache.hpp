@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include "shader_reflection.hpp"
+
+#include <volk/volk.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace mcvk::Renderer {
+    class Device;
+
+    // Hands out shader modules shared between every user of identical SPIR-V, keyed by a hash of the code rather than its path, so
+    // that pipelines sharing shaders (or different files with the same contents) create each module once. SPIR-V files are memory
+    // mapped and modules created straight from the mapping. Modules are reference counted, and destroyed as soon as their last
+    // user releases them, as pipelines don't need their modules once built. Each module is reflected once, when created.
+    class ShaderModuleCache {
+    public:
+        ShaderModuleCache(const Device &device);
+        ~ShaderModuleCache();
+
+        ShaderModuleCache(const ShaderModuleCache &) = delete;
+        ShaderModuleCache &operator=(const ShaderModuleCache &) = delete;
+
+        // returns VK_NULL_HANDLE (with an error reported) if the file can't be read or isn't valid SPIR-V
+        VkShaderModule Acquire(const std::string &path);
+        void Release(VkShaderModule module);
+
+        // valid until the module is released
+        const ShaderReflection &GetReflection(VkShaderModule module) const;
+
+        void LogStats() const;
+
+    private:
+        struct _Entry {
+            VkShaderModule module;
+            uint32_t refs;
+            ShaderReflection reflection;
+        };
+
+        const Device &_device;
+
+        std::unordered_map<uint64_t, _Entry> _modules;
+        std::unordered_map<VkShaderModule, uint64_t> _hashes;
+
+        uint64_t _requests{0};
+        uint64_t _hits{0};
+
+        mutable std::mutex _mutex;
+    };
+}
@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "shader_reflection.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+
+namespace mcvk::Renderer {
+    // just the parts of the SPIR-V spec needed here
+    static constexpr uint32_t __SPIRV_MAGIC = 0x07230203;
+
+    enum __Op : uint32_t {
+        __OP_ENTRY_POINT = 15,
+        __OP_TYPE_BOOL = 20,
+        __OP_TYPE_INT = 21,
+        __OP_TYPE_FLOAT = 22,
+        __OP_TYPE_VECTOR = 23,
+        __OP_TYPE_MATRIX = 24,
+        __OP_TYPE_IMAGE = 25,
+        __OP_TYPE_SAMPLER = 26,
+        __OP_TYPE_SAMPLED_IMAGE = 27,
+        __OP_TYPE_ARRAY = 28,
+        __OP_TYPE_RUNTIME_ARRAY = 29,
+        __OP_TYPE_STRUCT = 30,
+        __OP_TYPE_POINTER = 32,
+        __OP_CONSTANT = 43,
+        __OP_VARIABLE = 59,
+        __OP_DECORATE = 71,
+        __OP_MEMBER_DECORATE = 72,
+    };
+
+    enum __Decoration : uint32_t {
+        __DECORATION_BLOCK = 2,
+        __DECORATION_BUFFER_BLOCK = 3,
+        __DECORATION_ARRAY_STRIDE = 6,
+        __DECORATION_MATRIX_STRIDE = 7,
+        __DECORATION_BUILT_IN = 11,
+        __DECORATION_LOCATION = 30,
+        __DECORATION_BINDING = 33,
+        __DECORATION_DESCRIPTOR_SET = 34,
+        __DECORATION_OFFSET = 35,
+    };
+
+    enum __StorageClass : uint32_t {
+        __STORAGE_UNIFORM_CONSTANT = 0,
+        __STORAGE_INPUT = 1,
+        __STORAGE_UNIFORM = 2,
+        __STORAGE_PUSH_CONSTANT = 9,
+        __STORAGE_STORAGE_BUFFER = 12,
+    };
+
+    static constexpr uint32_t __DIM_BUFFER = 5;
+    static constexpr uint32_t __DIM_SUBPASS_DATA = 6;
+
+    struct __Decorations {
+        std::optional<uint32_t> set;
+        std::optional<uint32_t> binding;
+        std::optional<uint32_t> location;
+        std::optional<uint32_t> array_stride;
+        bool block{false};
+        bool buffer_block{false};
+        bool built_in{false};
+    };
+
+    struct __MemberDecorations {
+        uint32_t offset{0};
+        uint32_t matrix_stride{0};
+    };
+
+    struct __Variable {
+        uint32_t id;
+        uint32_t type;
+        uint32_t storage;
+    };
+
+    struct __Module {
+        // each type's opcode followed by its operands, excluding the result ID
+        std::unordered_map<uint32_t, std::vector<uint32_t>> types;
+        std::unordered_map<uint32_t, uint32_t> constants;
+        std::unordered_map<uint32_t, __Decorations> decorations;
+        std::unordered_map<uint32_t, std::vector<__MemberDecorations>> member_decorations;
+        std::vector<__Variable> variables;
+    };
+
+    static const std::vector<uint32_t> *__GetType(const __Module &module, uint32_t id) {
+        auto it = module.types.find(id);
+        return it != module.types.end() && !it->second.empty() ? &it->second : nullptr;
+    }
+
+    // approximate size of a type as laid out in a block, from its explicit offsets and strides
+    static uint32_t __GetTypeSize(const __Module &module, uint32_t id, uint32_t matrix_stride = 0) {
+        const std::vector<uint32_t> *type = __GetType(module, id);
+        if (!type) {
+            return 0;
+        }
+
+        switch ((*type)[0]) {
+            case __OP_TYPE_BOOL:
+                return 4;
+            case __OP_TYPE_INT:
+            case __OP_TYPE_FLOAT:
+                return type->size() > 1 ? (*type)[1] / 8 : 0;
+            case __OP_TYPE_VECTOR:
+                return type->size() > 2 ? __GetTypeSize(module, (*type)[1]) * (*type)[2] : 0;
+            case __OP_TYPE_MATRIX:
+                if (type->size() < 3) {
+                    return 0;
+                }
+                return (matrix_stride ? matrix_stride : __GetTypeSize(module, (*type)[1])) * (*type)[2];
+            case __OP_TYPE_ARRAY: {
+                if (type->size() < 3) {
+                    return 0;
+                }
+                auto length = module.constants.find((*type)[2]);
+                auto decorations = module.decorations.find(id);
+                uint32_t stride = decorations != module.decorations.end() && decorations->second.array_stride ?
+                    *decorations->second.array_stride : __GetTypeSize(module, (*type)[1]);
+                return length != module.constants.end() ? stride * length->second : 0;
+            }
+            case __OP_TYPE_STRUCT: {
+                auto members = module.member_decorations.find(id);
+                uint32_t size = 0;
+                for (size_t m = 1; m < type->size(); m++) {
+                    __MemberDecorations member{};
+                    if (members != module.member_decorations.end() && m - 1 < members->second.size()) {
+                        member = members->second[m - 1];
+                    }
+                    size = std::max(size, member.offset + __GetTypeSize(module, (*type)[m], member.matrix_stride));
+                }
+                return size;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    static VkFormat __GetInputFormat(const __Module &module, uint32_t id) {
+        const std::vector<uint32_t> *type = __GetType(module, id);
+        if (!type) {
+            return VK_FORMAT_UNDEFINED;
+        }
+
+        uint32_t components = 1;
+        if ((*type)[0] == __OP_TYPE_VECTOR && type->size() > 2) {
+            components = (*type)[2];
+            type = __GetType(module, (*type)[1]);
+            if (!type) {
+                return VK_FORMAT_UNDEFINED;
+            }
+        }
+        if (components < 1 || components > 4 || type->size() < 2 || (*type)[1] != 32) {
+            return VK_FORMAT_UNDEFINED;
+        }
+
+        static const VkFormat float_formats[] = {
+            VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+        static const VkFormat sint_formats[] = {
+            VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+        static const VkFormat uint_formats[] = {
+            VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+        if ((*type)[0] == __OP_TYPE_FLOAT) {
+            return float_formats[components - 1];
+        }
+        if ((*type)[0] == __OP_TYPE_INT && type->size() > 2) {
+            return (*type)[2] ? sint_formats[components - 1] : uint_formats[components - 1];
+        }
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    static VkShaderStageFlagBits __GetStage(uint32_t execution_model) {
+        switch (execution_model) {
+            case 0:
+                return VK_SHADER_STAGE_VERTEX_BIT;
+            case 1:
+                return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+            case 2:
+                return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+            case 3:
+                return VK_SHADER_STAGE_GEOMETRY_BIT;
+            case 4:
+                return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case 5:
+                return VK_SHADER_STAGE_COMPUTE_BIT;
+            default:
+                return VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM;
+        }
+    }
+
+    // the descriptor type of a resource variable's (unwrapped) type, or VK_DESCRIPTOR_TYPE_MAX_ENUM if it isn't a descriptor
+    static VkDescriptorType __GetDescriptorType(const __Module &module, uint32_t storage, uint32_t type_id) {
+        const std::vector<uint32_t> *type = __GetType(module, type_id);
+        if (!type) {
+            return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+        }
+
+        auto decorations = module.decorations.find(type_id);
+        bool block = decorations != module.decorations.end() && decorations->second.block;
+        bool buffer_block = decorations != module.decorations.end() && decorations->second.buffer_block;
+
+        switch (storage) {
+            case __STORAGE_UNIFORM:
+                // old-style storage buffers are uniform-class structs decorated BufferBlock
+                return buffer_block ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER :
+                    (block ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_MAX_ENUM);
+            case __STORAGE_STORAGE_BUFFER:
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            case __STORAGE_UNIFORM_CONSTANT:
+                break;
+            default:
+                return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+        }
+
+        switch ((*type)[0]) {
+            case __OP_TYPE_SAMPLED_IMAGE:
+                return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            case __OP_TYPE_SAMPLER:
+                return VK_DESCRIPTOR_TYPE_SAMPLER;
+            case __OP_TYPE_IMAGE: {
+                if (type->size() < 7) {
+                    return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+                }
+                uint32_t dim = (*type)[2];
+                // 1 if used with a sampler, 2 if used for storage
+                uint32_t sampled = (*type)[6];
+                if (dim == __DIM_SUBPASS_DATA) {
+                    return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                }
+                if (dim == __DIM_BUFFER) {
+                    return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                }
+                return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+            default:
+                return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+        }
+    }
+
+    bool ReflectSpirv(const uint32_t *code, size_t word_count, ShaderReflection &reflection) {
+        // magic, version, generator, bound, schema
+        if (word_count < 5 || code[0] != __SPIRV_MAGIC) {
+            return false;
+        }
+
+        reflection = {};
+        reflection.stage = VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM;
+
+        __Module module;
+        for (size_t i = 5; i < word_count;) {
+            uint32_t opcode = code[i] & 0xffff;
+            uint32_t count = code[i] >> 16;
+            if (count == 0 || i + count > word_count) {
+                return false;
+            }
+            const uint32_t *ops = code + i + 1;
+            uint32_t op_count = count - 1;
+
+            switch (opcode) {
+                case __OP_ENTRY_POINT:
+                    if (op_count >= 1 && reflection.stage == VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM) {
+                        reflection.stage = __GetStage(ops[0]);
+                    }
+                    break;
+                case __OP_TYPE_BOOL:
+                case __OP_TYPE_INT:
+                case __OP_TYPE_FLOAT:
+                case __OP_TYPE_VECTOR:
+                case __OP_TYPE_MATRIX:
+                case __OP_TYPE_IMAGE:
+                case __OP_TYPE_SAMPLER:
+                case __OP_TYPE_SAMPLED_IMAGE:
+                case __OP_TYPE_ARRAY:
+                case __OP_TYPE_RUNTIME_ARRAY:
+                case __OP_TYPE_STRUCT:
+                case __OP_TYPE_POINTER:
+                    if (op_count >= 1) {
+                        std::vector<uint32_t> &type = module.types[ops[0]];
+                        type.push_back(opcode);
+                        type.insert(type.end(), ops + 1, ops + op_count);
+                    }
+                    break;
+                case __OP_CONSTANT:
+                    // only 32-bit (and narrower) integer constants matter, as array lengths
+                    if (op_count >= 3) {
+                        module.constants[ops[1]] = ops[2];
+                    }
+                    break;
+                case __OP_VARIABLE:
+                    if (op_count >= 3) {
+                        module.variables.push_back({ ops[1], ops[0], ops[2] });
+                    }
+                    break;
+                case __OP_DECORATE:
+                    if (op_count >= 2) {
+                        __Decorations &d = module.decorations[ops[0]];
+                        uint32_t literal = op_count >= 3 ? ops[2] : 0;
+                        switch (ops[1]) {
+                            case __DECORATION_BLOCK: d.block = true; break;
+                            case __DECORATION_BUFFER_BLOCK: d.buffer_block = true; break;
+                            case __DECORATION_BUILT_IN: d.built_in = true; break;
+                            case __DECORATION_ARRAY_STRIDE: d.array_stride = literal; break;
+                            case __DECORATION_LOCATION: d.location = literal; break;
+                            case __DECORATION_BINDING: d.binding = literal; break;
+                            case __DECORATION_DESCRIPTOR_SET: d.set = literal; break;
+                            default: break;
+                        }
+                    }
+                    break;
+                case __OP_MEMBER_DECORATE:
+                    if (op_count >= 4) {
+                        std::vector<__MemberDecorations> &members = module.member_decorations[ops[0]];
+                        if (members.size() <= ops[1]) {
+                            members.resize(ops[1] + 1);
+                        }
+                        if (ops[2] == __DECORATION_OFFSET) {
+                            members[ops[1]].offset = ops[3];
+                        } else if (ops[2] == __DECORATION_MATRIX_STRIDE) {
+                            members[ops[1]].matrix_stride = ops[3];
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            i += count;
+        }
+
+        if (reflection.stage == VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM) {
+            return false;
+        }
+
+        for (const __Variable &var : module.variables) {
+            const std::vector<uint32_t> *pointer = __GetType(module, var.type);
+            if (!pointer || (*pointer)[0] != __OP_TYPE_POINTER || pointer->size() < 3) {
+                continue;
+            }
+            uint32_t type_id = (*pointer)[2];
+
+            auto decorations_it = module.decorations.find(var.id);
+            __Decorations decorations = decorations_it != module.decorations.end() ? decorations_it->second : __Decorations{};
+
+            if (var.storage == __STORAGE_PUSH_CONSTANT) {
+                reflection.push_constant_size = std::max(reflection.push_constant_size, __GetTypeSize(module, type_id));
+                continue;
+            }
+
+            if (var.storage == __STORAGE_INPUT) {
+                if (decorations.location && !decorations.built_in) {
+                    reflection.inputs.push_back({ *decorations.location, __GetInputFormat(module, type_id) });
+                }
+                continue;
+            }
+
+            if (!decorations.binding) {
+                continue;
+            }
+
+            // arrays of descriptors take one binding with a count; runtime-sized ones aren't supported, and are counted as one
+            uint32_t count = 1;
+            for (const std::vector<uint32_t> *type = __GetType(module, type_id);
+                type && (((*type)[0] == __OP_TYPE_ARRAY && type->size() >= 3) || ((*type)[0] == __OP_TYPE_RUNTIME_ARRAY && type->size() >= 2));
+                type = __GetType(module, type_id)) {
+                if ((*type)[0] == __OP_TYPE_ARRAY) {
+                    auto length = module.constants.find((*type)[2]);
+                    count *= length != module.constants.end() ? length->second : 1;
+                }
+                type_id = (*type)[1];
+            }
+
+            VkDescriptorType descriptor_type = __GetDescriptorType(module, var.storage, type_id);
+            if (descriptor_type == VK_DESCRIPTOR_TYPE_MAX_ENUM) {
+                continue;
+            }
+
+            reflection.bindings.push_back({ decorations.set.value_or(0), *decorations.binding, descriptor_type, count });
+        }
+
+        std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ReflectedBinding &a, const ReflectedBinding &b) {
+            return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+        });
+        std::sort(reflection.inputs.begin(), reflection.inputs.end(), [](const ReflectedInput &a, const ReflectedInput &b) {
+            return a.location < b.location;
+        });
+
+        return true;
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <volk/volk.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mcvk::Renderer {
+    struct ReflectedBinding {
+        uint32_t set;
+        uint32_t binding;
+        VkDescriptorType type;
+        uint32_t count;
+    };
+
+    struct ReflectedInput {
+        uint32_t location;
+        VkFormat format;
+    };
+
+    // the interface a shader module declares to the rest of a pipeline
+    struct ShaderReflection {
+        VkShaderStageFlagBits stage;
+
+        // every descriptor the module declares, used or not. Uniform and storage buffers are reflected as non-dynamic
+        std::vector<ReflectedBinding> bindings;
+        // size of the push constant block, or 0 if there is none
+        uint32_t push_constant_size{0};
+        // user-defined (located) inputs; for vertex shaders, the attributes the shader reads
+        std::vector<ReflectedInput> inputs;
+    };
+
+    // Reads descriptor bindings, push constants and inputs from a SPIR-V module's decorations and types; returns false if the code
+    // isn't valid SPIR-V or has no entry point. Only the first entry point is considered.
+    bool ReflectSpirv(const uint32_t *code, size_t word_count, ShaderReflection &reflection);
+}
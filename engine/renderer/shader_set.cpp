@@ -7,10 +7,9 @@
 
 #include "shader_set.hpp"
 
+#include "renderer/device.hpp"
 #include "utils/log.hpp"
 
-#include <fstream>
-
 namespace mcvk::Renderer {
     VkShaderStageFlagBits ShaderStageToFlagBits(ShaderStage s) {
         switch (s) {
@@ -36,22 +35,37 @@ namespace mcvk::Renderer {
         }
     }
 
-    ShaderSet::ShaderSet(const VkDevice &device, const std::vector<ShaderInfo> &shaders)
+    ShaderSet::ShaderSet(const Device &device, const std::vector<ShaderInfo> &shaders)
         : _device{device}, _shader_modules{} {
-        // create modules for each specified shader
+        // acquire modules for each specified shader
         for (ShaderInfo shad : shaders) {
-            auto src = _ReadFile(shad.path);
-            _AddShaderModule(shad.stage, src);
+            VkShaderModule mod = _device.GetShaderModuleCache().Acquire(shad.path);
+            if (!mod) {
+                // the destructor won't run
+                for (auto &[_, acquired] : _shader_modules) {
+                    _device.GetShaderModuleCache().Release(acquired);
+                }
+                Utils::Fatal("Failed to create shader module");
+            }
+
+            VkShaderStageFlagBits s = ShaderStageToFlagBits(shad.stage);
+            if (_device.GetShaderModuleCache().GetReflection(mod).stage != s) {
+                Utils::Warn("Shader \"" + shad.path + "\" has an entry point for a different stage than it is used for");
+            }
+            if (_shader_modules.contains(s)) {
+                _device.GetShaderModuleCache().Release(_shader_modules[s]);
+            }
+            _shader_modules[s] = mod;
         }
     }
 
     ShaderSet::~ShaderSet() {
         for (auto &[_, mod] : _shader_modules) {
-            vkDestroyShaderModule(_device, mod, nullptr);
+            _device.GetShaderModuleCache().Release(mod);
         }
     }
 
-    std::vector<VkPipelineShaderStageCreateInfo> ShaderSet::BuildShaderStageInfos() {
+    std::vector<VkPipelineShaderStageCreateInfo> ShaderSet::BuildShaderStageInfos(const VkSpecializationInfo *specialization) {
         std::vector<VkPipelineShaderStageCreateInfo> infos(_shader_modules.size());
 
         uint32_t i = 0;
@@ -62,7 +76,7 @@ namespace mcvk::Renderer {
             infos[i].stage = stage;
             infos[i].module = mod;
             infos[i].pName = "main";
-            infos[i].pSpecializationInfo = nullptr;
+            infos[i].pSpecializationInfo = specialization;
 
             i++;
         }
@@ -70,36 +84,14 @@ namespace mcvk::Renderer {
         return infos;
     }
 
-    std::vector<char> ShaderSet::_ReadFile(const std::string &path) {
-        std::ifstream file{path, std::ios::ate | std::ios::binary};
-
-        if (!file.is_open()) {
-            Utils::Fatal("Failed to open file at path \"" + path + "\"");
-        }
-
-        size_t fileSize = static_cast<size_t>(file.tellg());
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-
-        file.close();
-
-        return buffer;
-    }
-
-    void ShaderSet::_AddShaderModule(ShaderStage stage, const std::vector<char> &src) {
-        VkShaderModuleCreateInfo info{};
-        info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        info.codeSize = src.size();
-        info.pCode = reinterpret_cast<const uint32_t *>(src.data());
+    std::vector<const ShaderReflection *> ShaderSet::GetReflections() const {
+        std::vector<const ShaderReflection *> reflections;
+        reflections.reserve(_shader_modules.size());
 
-        VkShaderModule mod;
-        if (vkCreateShaderModule(_device, &info, nullptr, &mod) != VK_SUCCESS) {
-            Utils::Fatal("Failed to create shader module");
+        for (auto &[_, mod] : _shader_modules) {
+            reflections.push_back(&_device.GetShaderModuleCache().GetReflection(mod));
         }
 
-        VkShaderStageFlagBits s = ShaderStageToFlagBits(stage);
-        _shader_modules[s] = mod;
+        return reflections;
     }
 }
@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include "shader_reflection.hpp"
+
 #include <volk/volk.h>
 
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -27,21 +30,29 @@ namespace mcvk::Renderer {
         std::string path;
     };
 
+    // specialization constant IDs to their values; bool, int, uint and float constants are all 32 bits wide, so values are stored
+    // as raw bits
+    using SpecializationConstants = std::map<uint32_t, uint32_t>;
+
+    class Device;
+
+    // the shader modules for one pipeline's stages, acquired from (and released back to) the device's shader module cache
     class ShaderSet {
     public:
-        ShaderSet(const VkDevice &device, const std::vector<ShaderInfo> &shaders);
+        ShaderSet(const Device &device, const std::vector<ShaderInfo> &shaders);
         ~ShaderSet();
 
         ShaderSet(const ShaderSet &) = delete;
         ShaderSet &operator=(const ShaderSet &) = delete;
 
-        std::vector<VkPipelineShaderStageCreateInfo> BuildShaderStageInfos();
+        // specialization is applied to every stage; stages ignore any constants they don't declare
+        std::vector<VkPipelineShaderStageCreateInfo> BuildShaderStageInfos(const VkSpecializationInfo *specialization = nullptr);
 
-    private:
-        std::vector<char> _ReadFile(const std::string &path);
-        void _AddShaderModule(ShaderStage stage, const std::vector<char> &src);
+        // one reflection per stage, valid for the lifetime of the set
+        std::vector<const ShaderReflection *> GetReflections() const;
 
-        const VkDevice &_device;
+    private:
+        const Device &_device;
 
         std::unordered_map<VkShaderStageFlagBits, VkShaderModule> _shader_modules;
     };
@@ -7,66 +7,43 @@
 
 #pragma once
 
-#include "renderer/resource/image.hpp"
-#include "renderer/device.hpp"
+#include "renderer/render_target.hpp"
 
 #include <memory>
 #include <vector>
 
 namespace mcvk::Renderer {
-    class Swapchain {
+    class Swapchain : public RenderTarget {
     public:
-        Swapchain(const Device &device, const VkSurfaceKHR &surface, VkExtent2D window_extent);
-        Swapchain(const Device &device, const VkSurfaceKHR &surface, VkExtent2D window_extent, std::unique_ptr<Swapchain> &old);
+        Swapchain(const Device &device, const VkSurfaceKHR &surface, VkExtent2D window_extent, uint32_t frames_in_flight);
+        Swapchain(const Device &device, const VkSurfaceKHR &surface, VkExtent2D window_extent, uint32_t frames_in_flight,
+            std::unique_ptr<Swapchain> &old);
         ~Swapchain();
 
-        Swapchain(const Swapchain &) = delete;
-        Swapchain &operator=(const Swapchain &) = delete;
-
-        inline const VkRenderPass &GetRenderPass() const { return _render_pass; }
-        inline const VkFramebuffer &GetFramebuffer(uint32_t index) const { return _swapchain_framebuffers[index]; }
-        inline const VkExtent2D &GetExtent() const { return _swapchain_extent; }
-
-        inline const VkFormat GetColourImageFormat() const { return _swapchain_image_format; }
-        inline const VkFormat GetDepthImageFormat() const { return _depth_image_format; }
-
-        VkResult AcquireNextImage(uint32_t *const image_index);
-        VkResult SubmitCommandBuffers(const std::vector<VkCommandBuffer> &cmdbufs, uint32_t *const image_index);
+        VkResult AcquireNextImage(uint32_t *const image_index) override;
+        VkResult SubmitCommandBuffers(const std::vector<VkCommandBuffer> &cmdbufs, const std::vector<VkSemaphore> &upload_sems,
+            uint32_t *const image_index) override;
 
     private:
         void _Init();
 
         void _CreateSwapchain();
         void _ManageSwapchainImages();
-        void _CreateDepthImages();
-        void _CreateRenderPass();
-        void _CreateFramebuffers();
         void _CreateSynchronisationPrims();
 
         VkSurfaceFormatKHR _ChooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &candidates);
         VkPresentModeKHR _ChoosePresentMode(const std::vector<VkPresentModeKHR> &candidates);
         VkExtent2D _ChooseExtent(const VkSurfaceCapabilitiesKHR &caps);
-        VkFormat _FindDepthImageFormat();
-
-        VkExtent2D _swapchain_extent;
-        VkFormat _swapchain_image_format;
-        VkFormat _depth_image_format;
-
-        VkRenderPass _render_pass;
-        std::vector<VkFramebuffer> _swapchain_framebuffers;
-
-        std::vector<std::unique_ptr<Image>> _swapchain_images;
-        std::vector<std::unique_ptr<Image>> _depth_images;
 
-        const Device &_device;
         const VkSurfaceKHR &_surface;
         VkExtent2D _window_extent;
 
         VkSwapchainKHR _swapchain;
         std::unique_ptr<Swapchain> _old_swapchain;
 
-        VkSemaphore _image_available_sem;
+        std::vector<VkSemaphore> _image_available_sems;
         std::vector<VkSemaphore> _draw_complete_sems;
-        VkFence _frame_fence;
+        // the frame fence last associated with each swapchain image, in case images are acquired out of order
+        std::vector<VkFence> _image_fences;
     };
 }
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "transient_command_pool.hpp"
+
+#include "renderer/device.hpp"
+#include "utils/log.hpp"
+
+#include <limits>
+
+namespace mcvk::Renderer {
+    TransientCommandPool::TransientCommandPool(const Device &device, uint32_t queue_family, VkQueue queue)
+        : _device{device}, _queue_family{queue_family}, _queue{queue} {
+    }
+
+    TransientCommandPool::~TransientCommandPool() {
+        WaitIdle();
+
+        // destroying a pool frees every command buffer allocated from it
+        for (auto &[id, tp] : _thread_pools) {
+            vkDestroyCommandPool(_device.GetDevice(), tp.pool, nullptr);
+        }
+        for (std::vector<VkFence> *fences : { &_free_fences, &_signalled_fences }) {
+            for (VkFence f : *fences) {
+                vkDestroyFence(_device.GetDevice(), f, nullptr);
+            }
+        }
+    }
+
+    VkCommandBuffer TransientCommandPool::Begin() {
+        VkCommandBuffer cmdbuf;
+        ThreadPool *tp;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+
+            _RetireCompleted();
+
+            tp = &_GetThreadPool();
+            if (!tp->free.empty()) {
+                cmdbuf = tp->free.back();
+                tp->free.pop_back();
+            } else {
+                cmdbuf = VK_NULL_HANDLE;
+            }
+        }
+
+        // the pool belongs to this thread, so it can be used without holding the lock
+        if (cmdbuf == VK_NULL_HANDLE) {
+            VkCommandBufferAllocateInfo alloc_info{};
+            alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            alloc_info.commandPool = tp->pool;
+            alloc_info.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(_device.GetDevice(), &alloc_info, &cmdbuf) != VK_SUCCESS) {
+                Utils::Fatal("Failed to allocate transient command buffer");
+            }
+        }
+
+        // beginning implicitly resets a recycled command buffer
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(cmdbuf, &begin_info) != VK_SUCCESS) {
+            Utils::Fatal("Failed to begin recording to transient command buffer");
+        }
+
+        return cmdbuf;
+    }
+
+    TransientCommandPool::Ticket TransientCommandPool::Submit(VkCommandBuffer cmdbuf, const std::vector<VkSemaphore> &wait_sems,
+        const std::vector<VkPipelineStageFlags> &wait_stages, const std::vector<VkSemaphore> &signal_sems) {
+        if (vkEndCommandBuffer(cmdbuf) != VK_SUCCESS) {
+            Utils::Fatal("Failed to record transient command buffer");
+        }
+
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        VkFence fence = _GetFence();
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.waitSemaphoreCount = static_cast<uint32_t>(wait_sems.size());
+        submit_info.pWaitSemaphores = wait_sems.data();
+        submit_info.pWaitDstStageMask = wait_stages.data();
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &cmdbuf;
+        submit_info.signalSemaphoreCount = static_cast<uint32_t>(signal_sems.size());
+        submit_info.pSignalSemaphores = signal_sems.data();
+
+        {
+            auto queue_lock = _device.LockQueue(_queue);
+            if (vkQueueSubmit(_queue, 1, &submit_info, fence) != VK_SUCCESS) {
+                Utils::Fatal("Failed to submit transient command buffer");
+            }
+        }
+
+        Ticket ticket = _next_ticket++;
+        _in_flight.push_back({ ticket, cmdbuf, fence, &_GetThreadPool() });
+
+        return ticket;
+    }
+
+    bool TransientCommandPool::IsComplete(Ticket ticket) {
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _RetireCompleted();
+        return ticket <= _completed_ticket;
+    }
+
+    void TransientCommandPool::Wait(Ticket ticket) {
+        std::vector<VkFence> fences;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+
+            for (Submission &s : _in_flight) {
+                if (s.ticket > ticket) {
+                    break;
+                }
+                fences.push_back(s.fence);
+            }
+            if (fences.empty()) {
+                return;
+            }
+            _waiters++;
+        }
+
+        // waited on without the lock so that other threads can keep submitting and polling their own work; fences aren't reset
+        // for reuse while anyone is waiting, so these can't be recycled from under the wait
+        vkWaitForFences(_device.GetDevice(), static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE,
+            std::numeric_limits<uint64_t>::max());
+
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        _waiters--;
+        _RetireCompleted();
+    }
+
+    void TransientCommandPool::WaitIdle() {
+        Ticket last;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            last = _next_ticket - 1;
+        }
+        Wait(last);
+    }
+
+    TransientCommandPool::ThreadPool &TransientCommandPool::_GetThreadPool() {
+        auto it = _thread_pools.find(std::this_thread::get_id());
+        if (it != _thread_pools.end()) {
+            return it->second;
+        }
+
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.queueFamilyIndex = _queue_family;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        ThreadPool tp{};
+        if (vkCreateCommandPool(_device.GetDevice(), &pool_info, nullptr, &tp.pool) != VK_SUCCESS) {
+            Utils::Fatal("Failed to create transient command pool");
+        }
+
+        return _thread_pools.emplace(std::this_thread::get_id(), std::move(tp)).first->second;
+    }
+
+    VkFence TransientCommandPool::_GetFence() {
+        if (!_free_fences.empty()) {
+            VkFence f = _free_fences.back();
+            _free_fences.pop_back();
+            return f;
+        }
+
+        VkFenceCreateInfo fence_info{};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        VkFence f;
+        if (vkCreateFence(_device.GetDevice(), &fence_info, nullptr, &f) != VK_SUCCESS) {
+            Utils::Fatal("Failed to create transient submission fence");
+        }
+        return f;
+    }
+
+    void TransientCommandPool::_RetireCompleted() {
+        // submissions go to a single queue, so they are retired in order
+        while (!_in_flight.empty() && vkGetFenceStatus(_device.GetDevice(), _in_flight.front().fence) == VK_SUCCESS) {
+            Submission s = _in_flight.front();
+            _in_flight.pop_front();
+
+            _completed_ticket = s.ticket;
+
+            _signalled_fences.push_back(s.fence);
+            s.owner->free.push_back(s.cmdbuf);
+        }
+
+        if (_waiters == 0 && !_signalled_fences.empty()) {
+            vkResetFences(_device.GetDevice(), static_cast<uint32_t>(_signalled_fences.size()), _signalled_fences.data());
+            _free_fences.insert(_free_fences.end(), _signalled_fences.begin(), _signalled_fences.end());
+            _signalled_fences.clear();
+        }
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <volk/volk.h>
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mcvk::Renderer {
+    class Device;
+
+    // Hands out short-lived command buffers for one-shot work on a single queue. Each thread records from a command pool of its
+    // own, and every submission is given a fence from a shared pool; command buffers and fences are recycled once that fence has
+    // signalled, so nothing is allocated or freed per submission and callers only wait on their own work rather than the queue.
+    class TransientCommandPool {
+    public:
+        // identifies a submission; tickets increase monotonically, 0 is always complete
+        using Ticket = uint64_t;
+
+        TransientCommandPool(const Device &device, uint32_t queue_family, VkQueue queue);
+        ~TransientCommandPool();
+
+        TransientCommandPool(const TransientCommandPool &) = delete;
+        TransientCommandPool &operator=(const TransientCommandPool &) = delete;
+
+        // returns a command buffer in the recording state; it must be submitted from the same thread
+        VkCommandBuffer Begin();
+        // end recording and submit; the command buffer is reclaimed once the returned ticket is complete
+        Ticket Submit(VkCommandBuffer cmdbuf, const std::vector<VkSemaphore> &wait_sems = {},
+            const std::vector<VkPipelineStageFlags> &wait_stages = {}, const std::vector<VkSemaphore> &signal_sems = {});
+
+        bool IsComplete(Ticket ticket);
+        void Wait(Ticket ticket);
+        void WaitIdle();
+
+    private:
+        struct ThreadPool {
+            VkCommandPool pool;
+            // recycled command buffers; not reset until they are next begun, as only the owning thread may touch the pool
+            std::vector<VkCommandBuffer> free;
+        };
+
+        struct Submission {
+            Ticket ticket;
+            VkCommandBuffer cmdbuf;
+            VkFence fence;
+            ThreadPool *owner;
+        };
+
+        ThreadPool &_GetThreadPool();
+        VkFence _GetFence();
+        void _RetireCompleted();
+
+        const Device &_device;
+        uint32_t _queue_family;
+        VkQueue _queue;
+
+        std::unordered_map<std::thread::id, ThreadPool> _thread_pools;
+        std::deque<Submission> _in_flight;
+        std::vector<VkFence> _free_fences;
+        // retired, but not yet reset as a thread may be waiting on them outside the lock
+        std::vector<VkFence> _signalled_fences;
+        uint32_t _waiters{0};
+
+        Ticket _next_ticket{1};
+        Ticket _completed_ticket{0};
+
+        std::mutex _mutex;
+    };
+}
@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "block_compression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace mcvk::ResourceMgr {
+    // a 4x4 block of RGBA texels, row by row
+    using __Block = uint8_t[64];
+
+    static void __FetchBlock(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, __Block block) {
+        for (uint32_t y = 0; y < 4; y++) {
+            // blocks hanging over the edge of the image repeat its last row/column
+            uint32_t sy = std::min(by * 4 + y, height - 1);
+            for (uint32_t x = 0; x < 4; x++) {
+                uint32_t sx = std::min(bx * 4 + x, width - 1);
+                std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+            }
+        }
+    }
+
+    // Pick the texels at either end of the principal axis of the masked texels, found by power iteration on their covariance.
+    // Only the first `channels` channels are considered; returns false if the mask is empty.
+    static bool __FitEndpoints(const __Block block, uint32_t channels, uint32_t mask, uint8_t e0[4], uint8_t e1[4]) {
+        float mean[4]{};
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < 16; i++) {
+            if (mask & (1u << i)) {
+                for (uint32_t c = 0; c < channels; c++) {
+                    mean[c] += block[i * 4 + c];
+                }
+                count++;
+            }
+        }
+        if (count == 0) {
+            return false;
+        }
+        for (uint32_t c = 0; c < channels; c++) {
+            mean[c] /= static_cast<float>(count);
+        }
+
+        float cov[4][4]{};
+        for (uint32_t i = 0; i < 16; i++) {
+            if (mask & (1u << i)) {
+                for (uint32_t a = 0; a < channels; a++) {
+                    for (uint32_t b = 0; b < channels; b++) {
+                        cov[a][b] += (block[i * 4 + a] - mean[a]) * (block[i * 4 + b] - mean[b]);
+                    }
+                }
+            }
+        }
+
+        float axis[4]{ 1.0f, 1.0f, 1.0f, 1.0f };
+        for (uint32_t iter = 0; iter < 8; iter++) {
+            float next[4]{};
+            float len = 0.0f;
+            for (uint32_t a = 0; a < channels; a++) {
+                for (uint32_t b = 0; b < channels; b++) {
+                    next[a] += cov[a][b] * axis[b];
+                }
+                len = std::max(len, std::abs(next[a]));
+            }
+            if (len == 0.0f) {
+                break; // every texel is the same
+            }
+            for (uint32_t a = 0; a < channels; a++) {
+                axis[a] = next[a] / len;
+            }
+        }
+
+        float min_proj = INFINITY, max_proj = -INFINITY;
+        uint32_t min_i = 0, max_i = 0;
+        for (uint32_t i = 0; i < 16; i++) {
+            if (mask & (1u << i)) {
+                float proj = 0.0f;
+                for (uint32_t c = 0; c < channels; c++) {
+                    proj += (block[i * 4 + c] - mean[c]) * axis[c];
+                }
+                if (proj < min_proj) {
+                    min_proj = proj;
+                    min_i = i;
+                }
+                if (proj > max_proj) {
+                    max_proj = proj;
+                    max_i = i;
+                }
+            }
+        }
+
+        std::memcpy(e0, block + max_i * 4, 4);
+        std::memcpy(e1, block + min_i * 4, 4);
+        return true;
+    }
+
+    static uint32_t __Distance(const uint8_t *a, const int32_t *b, uint32_t channels) {
+        uint32_t d = 0;
+        for (uint32_t c = 0; c < channels; c++) {
+            int32_t diff = static_cast<int32_t>(a[c]) - b[c];
+            d += static_cast<uint32_t>(diff * diff);
+        }
+        return d;
+    }
+
+    static uint16_t __To565(const uint8_t *c) {
+        return static_cast<uint16_t>(((c[0] * 31 + 127) / 255) << 11 | ((c[1] * 63 + 127) / 255) << 5 | ((c[2] * 31 + 127) / 255));
+    }
+
+    static void __From565(uint16_t v, int32_t out[3]) {
+        int32_t r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+        out[0] = (r << 3) | (r >> 2);
+        out[1] = (g << 2) | (g >> 4);
+        out[2] = (b << 3) | (b >> 2);
+    }
+
+    // BC1 colour block; BC3 reuses this for its colour half, which is always decoded in four-colour mode
+    static void __EncodeColourBlock(const __Block block, uint8_t out[8], bool punchthrough) {
+        uint32_t opaque_mask = 0;
+        for (uint32_t i = 0; i < 16; i++) {
+            if (!punchthrough || block[i * 4 + 3] >= 128) {
+                opaque_mask |= 1u << i;
+            }
+        }
+        // three-colour mode gives up a palette entry for transparent black
+        bool three_colour = (opaque_mask != 0xFFFF);
+
+        uint8_t e0[4]{}, e1[4]{};
+        __FitEndpoints(block, 3, opaque_mask, e0, e1);
+
+        uint16_t c0 = __To565(e0);
+        uint16_t c1 = __To565(e1);
+        // the order of the endpoints selects the mode
+        if ((!three_colour && c0 < c1) || (three_colour && c0 > c1)) {
+            std::swap(c0, c1);
+        }
+
+        int32_t palette[4][3];
+        __From565(c0, palette[0]);
+        __From565(c1, palette[1]);
+        for (uint32_t c = 0; c < 3; c++) {
+            if (three_colour) {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            } else {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+        }
+
+        uint32_t indices = 0;
+        // equal endpoints would decode as three-colour mode, where index 3 is transparent, so only index 0 is safe then
+        if (c0 != c1 || three_colour) {
+            for (uint32_t i = 0; i < 16; i++) {
+                uint32_t best = 0;
+                if (!(opaque_mask & (1u << i))) {
+                    best = 3;
+                } else {
+                    uint32_t best_dist = UINT32_MAX;
+                    for (uint32_t p = 0; p < (three_colour ? 3u : 4u); p++) {
+                        uint32_t dist = __Distance(block + i * 4, palette[p], 3);
+                        if (dist < best_dist) {
+                            best_dist = dist;
+                            best = p;
+                        }
+                    }
+                }
+                indices |= best << (i * 2);
+            }
+        }
+
+        out[0] = static_cast<uint8_t>(c0 & 0xFF);
+        out[1] = static_cast<uint8_t>(c0 >> 8);
+        out[2] = static_cast<uint8_t>(c1 & 0xFF);
+        out[3] = static_cast<uint8_t>(c1 >> 8);
+        for (uint32_t b = 0; b < 4; b++) {
+            out[4 + b] = static_cast<uint8_t>(indices >> (b * 8));
+        }
+    }
+
+    static void __EncodeAlphaBlock(const __Block block, uint8_t out[8]) {
+        uint8_t a0 = 0, a1 = 255;
+        for (uint32_t i = 0; i < 16; i++) {
+            a0 = std::max(a0, block[i * 4 + 3]);
+            a1 = std::min(a1, block[i * 4 + 3]);
+        }
+
+        // with a0 > a1 the six entries between the endpoints are interpolated
+        int32_t palette[8];
+        palette[0] = a0;
+        palette[1] = a1;
+        for (int32_t i = 2; i < 8; i++) {
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+        }
+
+        uint64_t indices = 0;
+        if (a0 != a1) {
+            for (uint32_t i = 0; i < 16; i++) {
+                uint64_t best = 0;
+                uint32_t best_dist = UINT32_MAX;
+                for (uint32_t p = 0; p < 8; p++) {
+                    uint32_t dist = __Distance(block + i * 4 + 3, &palette[p], 1);
+                    if (dist < best_dist) {
+                        best_dist = dist;
+                        best = p;
+                    }
+                }
+                indices |= best << (i * 3);
+            }
+        }
+
+        out[0] = a0;
+        out[1] = a1;
+        for (uint32_t b = 0; b < 6; b++) {
+            out[2 + b] = static_cast<uint8_t>(indices >> (b * 8));
+        }
+    }
+
+    static void __WriteBits(uint8_t *out, uint32_t &pos, uint32_t value, uint32_t count) {
+        for (uint32_t b = 0; b < count; b++, pos++) {
+            if (value & (1u << b)) {
+                out[pos / 8] |= static_cast<uint8_t>(1u << (pos % 8));
+            }
+        }
+    }
+
+    // BC7 mode 6: one RGBA subset with 7-bit endpoints (plus a p-bit each) and 16 interpolated palette entries
+    static void __EncodeBC7Block(const __Block block, uint8_t out[16]) {
+        static constexpr int32_t WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        uint8_t e[2][4]{};
+        __FitEndpoints(block, 4, 0xFFFF, e[0], e[1]);
+
+        // quantise each endpoint to 7 bits per channel with whichever p-bit (shared by its channels) fits best
+        uint32_t q[2][4];
+        uint32_t pbit[2];
+        int32_t endpoint[2][4];
+        for (uint32_t n = 0; n < 2; n++) {
+            uint32_t best_err = UINT32_MAX;
+            for (uint32_t p = 0; p < 2; p++) {
+                uint32_t err = 0;
+                uint32_t cand[4];
+                for (uint32_t c = 0; c < 4; c++) {
+                    int32_t v = std::clamp(static_cast<int32_t>(std::lround((e[n][c] - static_cast<int32_t>(p)) / 2.0)), 0, 127);
+                    cand[c] = static_cast<uint32_t>(v);
+                    int32_t diff = ((v << 1) | static_cast<int32_t>(p)) - e[n][c];
+                    err += static_cast<uint32_t>(diff * diff);
+                }
+                if (err < best_err) {
+                    best_err = err;
+                    pbit[n] = p;
+                    std::memcpy(q[n], cand, sizeof(cand));
+                }
+            }
+            for (uint32_t c = 0; c < 4; c++) {
+                endpoint[n][c] = static_cast<int32_t>((q[n][c] << 1) | pbit[n]);
+            }
+        }
+
+        int32_t palette[16][4];
+        for (uint32_t p = 0; p < 16; p++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                palette[p][c] = ((64 - WEIGHTS[p]) * endpoint[0][c] + WEIGHTS[p] * endpoint[1][c] + 32) >> 6;
+            }
+        }
+
+        uint32_t indices[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            uint32_t best_dist = UINT32_MAX;
+            for (uint32_t p = 0; p < 16; p++) {
+                uint32_t dist = __Distance(block + i * 4, palette[p], 4);
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    indices[i] = p;
+                }
+            }
+        }
+
+        // the first index is stored without its top bit, so the endpoints are swapped if it would be set
+        if (indices[0] & 8) {
+            std::swap(q[0], q[1]);
+            std::swap(pbit[0], pbit[1]);
+            for (uint32_t i = 0; i < 16; i++) {
+                indices[i] = 15 - indices[i];
+            }
+        }
+
+        std::memset(out, 0, 16);
+        uint32_t pos = 0;
+        __WriteBits(out, pos, 1u << 6, 7); // mode 6
+        for (uint32_t c = 0; c < 4; c++) {
+            __WriteBits(out, pos, q[0][c], 7);
+            __WriteBits(out, pos, q[1][c], 7);
+        }
+        __WriteBits(out, pos, pbit[0], 1);
+        __WriteBits(out, pos, pbit[1], 1);
+        for (uint32_t i = 0; i < 16; i++) {
+            __WriteBits(out, pos, indices[i], (i == 0) ? 3 : 4);
+        }
+    }
+
+    const char *BlockFormatToString(BlockFormat format) {
+        switch (format) {
+            case BlockFormat::BC1:
+                return "BC1";
+            case BlockFormat::BC3:
+                return "BC3";
+            case BlockFormat::BC7:
+                return "BC7";
+            default:
+                return "unknown";
+        }
+    }
+
+    uint32_t GetBlockBytes(BlockFormat format) {
+        return (format == BlockFormat::BC1) ? 8 : 16;
+    }
+
+    size_t GetCompressedSize(uint32_t width, uint32_t height, BlockFormat format) {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+    }
+
+    std::vector<uint8_t> CompressImage(const uint8_t *rgba, uint32_t width, uint32_t height, BlockFormat format) {
+        std::vector<uint8_t> out(GetCompressedSize(width, height, format));
+        uint32_t block_bytes = GetBlockBytes(format);
+
+        uint32_t blocks_x = (width + 3) / 4;
+        uint32_t blocks_y = (height + 3) / 4;
+
+        __Block block;
+        for (uint32_t by = 0; by < blocks_y; by++) {
+            for (uint32_t bx = 0; bx < blocks_x; bx++) {
+                __FetchBlock(rgba, width, height, bx, by, block);
+                uint8_t *dst = out.data() + (static_cast<size_t>(by) * blocks_x + bx) * block_bytes;
+
+                switch (format) {
+                    case BlockFormat::BC1:
+                        __EncodeColourBlock(block, dst, true);
+                        break;
+                    case BlockFormat::BC3:
+                        __EncodeAlphaBlock(block, dst);
+                        __EncodeColourBlock(block, dst + 8, false);
+                        break;
+                    case BlockFormat::BC7:
+                        __EncodeBC7Block(block, dst);
+                        break;
+                }
+            }
+        }
+
+        return out;
+    }
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mcvk::ResourceMgr {
+    // block-compressed formats that 8-bit RGBA textures can be encoded to; every format works on 4x4 texel blocks
+    enum class BlockFormat : uint32_t {
+        BC1 = 1, // RGB, 1-bit alpha; 8 bytes per block
+        BC3 = 3, // RGB with interpolated alpha; 16 bytes per block
+        BC7 = 7, // RGBA with 7-bit endpoints; 16 bytes per block
+    };
+
+    const char *BlockFormatToString(BlockFormat format);
+    uint32_t GetBlockBytes(BlockFormat format);
+    // size of an image of the given dimensions once compressed; partial blocks at the edges take up a whole block
+    size_t GetCompressedSize(uint32_t width, uint32_t height, BlockFormat format);
+
+    // Encode a single mip level of 8-bit RGBA pixels into blocks, row by row. Endpoints are fitted along the block's principal
+    // axis, which is quick enough to run at load time, but doesn't search as exhaustively as offline encoders (BC7 only uses mode
+    // 6, a single RGBA subset with 4-bit indices).
+    std::vector<uint8_t> CompressImage(const uint8_t *rgba, uint32_t width, uint32_t height, BlockFormat format);
+}
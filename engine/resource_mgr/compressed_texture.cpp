@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "compressed_texture.hpp"
+
+#include "mipmap.hpp"
+#include "utils/log.hpp"
+
+#include <cstring>
+#include <fstream>
+
+namespace mcvk::ResourceMgr {
+    static constexpr char __MAGIC[8] = { 'M', 'C', 'V', 'K', 'T', 'E', 'X', '\0' };
+    // bump whenever the layout or the encoders' output changes, so stale caches are rebuilt
+    static constexpr uint32_t __VERSION = 1;
+
+    enum __Flags : uint32_t {
+        __FLAG_SRGB = 1 << 0,
+        __FLAG_ARRAY = 1 << 1,
+    };
+
+    struct __FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t format;
+        uint32_t flags;
+        uint32_t width;
+        uint32_t height;
+        uint32_t layer_count;
+        uint32_t level_count;
+        uint32_t reserved;
+        uint64_t source_hash;
+        uint64_t data_size;
+    };
+
+    struct __FileLevel {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    CompressedTexture CompressTexture(const TextureArrayData &data, BlockFormat format, bool srgb, bool mipmaps) {
+        CompressedTexture texture{};
+        texture.format = format;
+        texture.srgb = srgb;
+        texture.array = true;
+        texture.width = data.width;
+        texture.height = data.height;
+        texture.layer_count = data.layer_count;
+        texture.level_count = mipmaps ? GetMipLevelCount(data.width, data.height) : 1;
+
+        size_t layer_size = static_cast<size_t>(data.width) * data.height * 4;
+        for (uint32_t l = 0; l < data.layer_count; l++) {
+            const uint8_t *layer = data.bytes.data() + layer_size * l;
+
+            MipChain chain{};
+            if (mipmaps) {
+                chain = GenerateMipChain(layer, data.width, data.height, srgb);
+            } else {
+                chain.bytes.assign(layer, layer + layer_size);
+                chain.levels.push_back({ 0, data.width, data.height });
+            }
+
+            for (const MipLevel &level : chain.levels) {
+                std::vector<uint8_t> blocks = CompressImage(chain.bytes.data() + level.offset, level.width, level.height, format);
+
+                texture.levels.push_back({ texture.bytes.size(), blocks.size(), level.width, level.height });
+                texture.bytes.insert(texture.bytes.end(), blocks.begin(), blocks.end());
+            }
+        }
+
+        return texture;
+    }
+
+    bool SaveCompressedTexture(const std::filesystem::path &path, const CompressedTexture &texture, uint64_t source_hash) {
+        std::error_code err;
+        std::filesystem::create_directories(path.parent_path(), err);
+
+        // written to the side and moved into place, so an interrupted write never leaves a truncated cache file behind
+        std::filesystem::path temp = path;
+        temp += ".tmp";
+
+        {
+            std::ofstream file{temp, std::ios::binary | std::ios::trunc};
+            if (!file) {
+                Utils::Warn("Failed to open texture cache file \"" + temp.string() + "\" for writing");
+                return false;
+            }
+
+            __FileHeader header{};
+            std::memcpy(header.magic, __MAGIC, sizeof(__MAGIC));
+            header.version = __VERSION;
+            header.format = static_cast<uint32_t>(texture.format);
+            header.flags = (texture.srgb ? __FLAG_SRGB : 0) | (texture.array ? __FLAG_ARRAY : 0);
+            header.width = texture.width;
+            header.height = texture.height;
+            header.layer_count = texture.layer_count;
+            header.level_count = texture.level_count;
+            header.source_hash = source_hash;
+            header.data_size = texture.bytes.size();
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+            for (const CompressedLevel &level : texture.levels) {
+                __FileLevel entry{ level.offset, level.size, level.width, level.height };
+                file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+            }
+
+            file.write(reinterpret_cast<const char *>(texture.bytes.data()), static_cast<std::streamsize>(texture.bytes.size()));
+            if (!file) {
+                Utils::Warn("Failed to write texture cache file \"" + temp.string() + "\"");
+                return false;
+            }
+        }
+
+        std::filesystem::rename(temp, path, err);
+        if (err) {
+            Utils::Warn("Failed to move texture cache file into place at \"" + path.string() + "\": " + err.message());
+            return false;
+        }
+        return true;
+    }
+
+    bool LoadCompressedTexture(const std::filesystem::path &path, uint64_t source_hash, CompressedTexture &texture) {
+        std::ifstream file{path, std::ios::binary};
+        if (!file) {
+            return false;
+        }
+
+        __FileHeader header{};
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!file || std::memcmp(header.magic, __MAGIC, sizeof(__MAGIC)) != 0 || header.version != __VERSION) {
+            Utils::Warn("Ignoring texture cache file \"" + path.string() + "\" with unrecognised format");
+            return false;
+        }
+        if (header.source_hash != source_hash) {
+            // sources have changed since the cache was built
+            return false;
+        }
+
+        BlockFormat format = static_cast<BlockFormat>(header.format);
+        if (format != BlockFormat::BC1 && format != BlockFormat::BC3 && format != BlockFormat::BC7) {
+            Utils::Warn("Ignoring texture cache file \"" + path.string() + "\" with unknown block format");
+            return false;
+        }
+
+        texture = {};
+        texture.format = format;
+        texture.srgb = header.flags & __FLAG_SRGB;
+        texture.array = header.flags & __FLAG_ARRAY;
+        texture.width = header.width;
+        texture.height = header.height;
+        texture.layer_count = header.layer_count;
+        texture.level_count = header.level_count;
+
+        uint64_t level_entries = static_cast<uint64_t>(header.layer_count) * header.level_count;
+        for (uint64_t i = 0; i < level_entries; i++) {
+            __FileLevel entry{};
+            file.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+
+            // level table entries must describe whole, in-bounds levels
+            if (!file || entry.offset + entry.size > header.data_size || entry.size != GetCompressedSize(entry.width, entry.height, format)) {
+                Utils::Warn("Ignoring corrupt texture cache file \"" + path.string() + "\"");
+                return false;
+            }
+            texture.levels.push_back({ static_cast<size_t>(entry.offset), static_cast<size_t>(entry.size), entry.width, entry.height });
+        }
+
+        texture.bytes.resize(static_cast<size_t>(header.data_size));
+        file.read(reinterpret_cast<char *>(texture.bytes.data()), static_cast<std::streamsize>(header.data_size));
+        if (!file) {
+            Utils::Warn("Ignoring truncated texture cache file \"" + path.string() + "\"");
+            return false;
+        }
+
+        return true;
+    }
+}
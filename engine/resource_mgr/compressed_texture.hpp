@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include "block_compression.hpp"
+#include "texture_array.hpp"
+
+#include <filesystem>
+
+namespace mcvk::ResourceMgr {
+    struct CompressedLevel {
+        // byte offset of the level within CompressedTexture::bytes
+        size_t offset;
+        size_t size;
+
+        uint32_t width;
+        uint32_t height;
+    };
+
+    struct CompressedTexture {
+        BlockFormat format;
+        bool srgb;
+        // sampled as a texture array, even if it only has one layer
+        bool array;
+
+        uint32_t width;
+        uint32_t height;
+        uint32_t layer_count;
+        uint32_t level_count;
+
+        // mip level `l` of layer `a` is levels[a * level_count + l]
+        std::vector<CompressedLevel> levels;
+        std::vector<uint8_t> bytes;
+    };
+
+    // block-compress every layer of a texture array, with a full mip chain (filtered before compression) if mipmaps is set
+    CompressedTexture CompressTexture(const TextureArrayData &data, BlockFormat format, bool srgb, bool mipmaps);
+
+    // The on-disk cache holds one compressed texture per file along with the hash of the sources it was built from; loading fails
+    // if the file is missing, malformed, or was built from different sources.
+    bool SaveCompressedTexture(const std::filesystem::path &path, const CompressedTexture &texture, uint64_t source_hash);
+    bool LoadCompressedTexture(const std::filesystem::path &path, uint64_t source_hash, CompressedTexture &texture);
+}
@@ -8,9 +8,15 @@
 #include "image_load.hpp"
 
 #include "utils/log.hpp"
+#include "utils/mapped_file.hpp"
 
 #include <stb_image.h>
 
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
 namespace mcvk::ResourceMgr {
     ImageLoadResult::~ImageLoadResult() {
         stbi_image_free(bytes); // equiv to free()
@@ -18,8 +24,15 @@ namespace mcvk::ResourceMgr {
     }
 
     std::unique_ptr<ImageLoadResult> LoadImage(const std::string &path) {
+        // decoded straight from the page cache rather than through stdio
+        Utils::MappedFile file{path};
+        if (!file.IsMapped()) {
+            // the mapping failure has already been reported
+            return std::make_unique<ImageLoadResult>(nullptr, 0, 0, 0);
+        }
+
         int32_t width, height, channels;
-        stbi_uc *pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        stbi_uc *pixels = stbi_load_from_memory(file.GetData(), static_cast<int>(file.GetSize()), &width, &height, &channels, STBI_rgb_alpha);
         if (!pixels) {
             const char *err = stbi_failure_reason();
             Utils::Error("Failed to load image from " + path + ": \"" + err + "\"");
@@ -27,4 +40,68 @@ namespace mcvk::ResourceMgr {
 
         return std::make_unique<ImageLoadResult>(pixels, width, height, channels);
     }
+
+    ImageBatchLoadResult LoadImages(const std::vector<std::string> &paths, Utils::ThreadPool &workers) {
+        auto start = std::chrono::steady_clock::now();
+
+        ImageBatchLoadResult result{};
+        result.images.resize(paths.size());
+        result.decode_times.resize(paths.size());
+
+        // each task only writes its own slots, so the results need no locking
+        for (size_t i = 0; i < paths.size(); i++) {
+            workers.Submit([&result, &paths, i]() {
+                auto decode_start = std::chrono::steady_clock::now();
+                result.images[i] = LoadImage(paths[i]);
+                result.decode_times[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decode_start).count();
+            });
+        }
+        workers.Wait();
+
+        result.total_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    void LogImageBatchStats(const std::vector<std::string> &paths, const ImageBatchLoadResult &result, uint32_t threads) {
+        double decode_sum = 0.0;
+        for (double t : result.decode_times) {
+            decode_sum += t;
+        }
+
+        std::stringstream stream{};
+        stream << "Decoded " << paths.size() << " images in " << result.total_time << " ms across " << threads << " workers ("
+            << decode_sum << " ms of decoding):";
+        for (size_t i = 0; i < paths.size(); i++) {
+            stream << std::endl << "\t" << std::filesystem::path{paths[i]}.filename().string() << ": " << result.decode_times[i] << " ms";
+        }
+
+        Utils::Info(stream.str());
+    }
+
+    bool SaveImagePPM(const std::string &path, const uint8_t *rgba, uint32_t width, uint32_t height) {
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        if (!file) {
+            Utils::Error("Failed to open image file \"" + path + "\" for writing");
+            return false;
+        }
+
+        file << "P6\n" << width << " " << height << "\n255\n";
+
+        std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *src = rgba + static_cast<size_t>(y) * width * 4;
+            for (uint32_t x = 0; x < width; x++) {
+                row[x * 3 + 0] = src[x * 4 + 0];
+                row[x * 3 + 1] = src[x * 4 + 1];
+                row[x * 3 + 2] = src[x * 4 + 2];
+            }
+            file.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size()));
+        }
+
+        if (!file) {
+            Utils::Error("Failed to write image file \"" + path + "\"");
+            return false;
+        }
+        return true;
+    }
 }
@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include "utils/thread_pool.hpp"
+
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace mcvk::ResourceMgr {
     struct ImageLoadResult {
@@ -23,5 +26,21 @@ namespace mcvk::ResourceMgr {
         int32_t channels;
     };
 
+    struct ImageBatchLoadResult {
+        // in the same order as the requested paths; failed loads have null bytes
+        std::vector<std::unique_ptr<ImageLoadResult>> images;
+
+        // time spent decoding each image, in milliseconds
+        std::vector<double> decode_times;
+        // wall-clock time for the whole batch
+        double total_time;
+    };
+
     std::unique_ptr<ImageLoadResult> LoadImage(const std::string &path);
+    // decode many images concurrently across the pool's workers, blocking until all are done
+    ImageBatchLoadResult LoadImages(const std::vector<std::string> &paths, Utils::ThreadPool &workers);
+    void LogImageBatchStats(const std::vector<std::string> &paths, const ImageBatchLoadResult &result, uint32_t threads);
+
+    // write tightly packed 8-bit RGBA pixels out as a binary PPM, dropping alpha; used for frame captures, so kept dependency-free
+    bool SaveImagePPM(const std::string &path, const uint8_t *rgba, uint32_t width, uint32_t height);
 }
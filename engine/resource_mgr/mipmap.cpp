@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "mipmap.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace mcvk::ResourceMgr {
+    static const std::array<float, 256> &__SRGBToLinearTable() {
+        static const std::array<float, 256> table = []() {
+            std::array<float, 256> t{};
+            for (uint32_t i = 0; i < 256; i++) {
+                float c = static_cast<float>(i) / 255.0f;
+                t[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    static uint8_t __LinearToSRGB(float c) {
+        c = (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+    }
+
+    static void __Downsample(const uint8_t *src, uint32_t src_w, uint32_t src_h, uint8_t *dst, uint32_t dst_w, uint32_t dst_h, bool srgb) {
+        const std::array<float, 256> &to_linear = __SRGBToLinearTable();
+
+        for (uint32_t y = 0; y < dst_h; y++) {
+            // odd (or 1-texel) source dimensions repeat the last row/column rather than reading past the edge
+            const uint8_t *row0 = src + static_cast<size_t>(std::min(y * 2, src_h - 1)) * src_w * 4;
+            const uint8_t *row1 = src + static_cast<size_t>(std::min(y * 2 + 1, src_h - 1)) * src_w * 4;
+
+            for (uint32_t x = 0; x < dst_w; x++) {
+                uint32_t x0 = std::min(x * 2, src_w - 1) * 4;
+                uint32_t x1 = std::min(x * 2 + 1, src_w - 1) * 4;
+                uint8_t *out = dst + (static_cast<size_t>(y) * dst_w + x) * 4;
+
+                for (uint32_t c = 0; c < 4; c++) {
+                    if (srgb && c < 3) {
+                        float sum = to_linear[row0[x0 + c]] + to_linear[row0[x1 + c]] + to_linear[row1[x0 + c]] + to_linear[row1[x1 + c]];
+                        out[c] = __LinearToSRGB(sum * 0.25f);
+                    } else {
+                        uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                        out[c] = static_cast<uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+    }
+
+    uint32_t GetMipLevelCount(uint32_t width, uint32_t height) {
+        uint32_t levels = 1;
+        for (uint32_t size = std::max(width, height); size > 1; size /= 2) {
+            levels++;
+        }
+        return levels;
+    }
+
+    MipChain GenerateMipChain(const uint8_t *rgba, uint32_t width, uint32_t height, bool srgb) {
+        MipChain chain{};
+
+        uint32_t count = GetMipLevelCount(width, height);
+        chain.levels.reserve(count);
+
+        size_t total = 0;
+        uint32_t w = width, h = height;
+        for (uint32_t i = 0; i < count; i++) {
+            chain.levels.push_back({ total, w, h });
+            total += static_cast<size_t>(w) * h * 4;
+
+            w = std::max(w / 2, 1u);
+            h = std::max(h / 2, 1u);
+        }
+
+        chain.bytes.resize(total);
+        std::memcpy(chain.bytes.data(), rgba, static_cast<size_t>(width) * height * 4);
+
+        // each level is filtered from the one above it
+        for (uint32_t i = 1; i < count; i++) {
+            const MipLevel &src = chain.levels[i - 1];
+            const MipLevel &dst = chain.levels[i];
+            __Downsample(chain.bytes.data() + src.offset, src.width, src.height, chain.bytes.data() + dst.offset, dst.width, dst.height, srgb);
+        }
+
+        return chain;
+    }
+}
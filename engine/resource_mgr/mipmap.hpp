@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mcvk::ResourceMgr {
+    struct MipLevel {
+        // byte offset of the level within MipChain::bytes
+        size_t offset;
+
+        uint32_t width;
+        uint32_t height;
+    };
+
+    struct MipChain {
+        // every level, tightly packed one after another starting with the base level
+        std::vector<uint8_t> bytes;
+        std::vector<MipLevel> levels;
+    };
+
+    // number of levels in a full mip chain down to 1x1
+    uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+    // Build a full mip chain from 8-bit RGBA pixels with a 2x2 box filter. When srgb is set, colour channels are averaged in
+    // linear space (alpha is always linear), so that mips don't darken.
+    MipChain GenerateMipChain(const uint8_t *rgba, uint32_t width, uint32_t height, bool srgb);
+}
@@ -13,6 +13,8 @@
 #include <tiny_obj_loader.h>
 #include <volk/volk.h>
 
+#include <filesystem>
+#include <map>
 #include <vector>
 
 namespace mcvk::ResourceMgr {
@@ -21,8 +23,12 @@ namespace mcvk::ResourceMgr {
     };
 
     struct MaterialResource : public GenericResource {
-        // TODO: store separate colour maps (and normal+depth maps) for each side (top, bottom, and sides).
-        std::unique_ptr<ImageLoadResult> colourmap;
+        // colour map images for each side of the block; sides not given their own map share the same file. Images are only
+        // decoded when they are packed, so that a cached texture array doesn't need them at all.
+        // TODO: normal and depth maps.
+        std::filesystem::path top_colourmap;
+        std::filesystem::path bottom_colourmap;
+        std::filesystem::path side_colourmap;
     };
 
     struct ModelResource : public GenericResource {
@@ -38,10 +44,20 @@ namespace mcvk::ResourceMgr {
             RayTracing,
         } type;
 
+        // startup pipelines are built before the first frame; background ones are compiled afterwards, while frames are drawn
+        enum class Priority {
+            Startup,
+            Background,
+        } priority{Priority::Startup};
+
         std::string shader_name;
 
         VkPolygonMode polygon_mode{VK_POLYGON_MODE_FILL};
         VkCullModeFlags cull_mode{VK_CULL_MODE_NONE};
+
+        // each specialization constant ID's candidate values (raw 32-bit), the first being the default. One pipeline variant is
+        // built for every combination
+        std::map<uint32_t, std::vector<uint32_t>> specialization;
     };
 
     struct ShaderResource : public GenericResource {
@@ -9,10 +9,46 @@
 
 #include "utils/log.hpp"
 
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
 namespace mcvk::ResourceMgr {
+    // true, false, a base-10 integer, or a float (if written with a decimal point or exponent), as the raw 32 bits of a
+    // specialization constant
+    static bool __ParseSpecializationValue(const std::string &str, uint32_t &value) {
+        if (str == "true" || str == "false") {
+            value = str == "true";
+            return true;
+        }
+        if (str.empty()) {
+            return false;
+        }
+
+        char *end;
+        if (str.find_first_of(".eE") != std::string::npos) {
+            float f = std::strtof(str.c_str(), &end);
+            if (*end != '\0') {
+                return false;
+            }
+            std::memcpy(&value, &f, sizeof(f));
+            return true;
+        }
+
+        long long i = std::strtoll(str.c_str(), &end, 10);
+        if (*end != '\0' || i < INT32_MIN || i > UINT32_MAX) {
+            return false;
+        }
+        value = static_cast<uint32_t>(i);
+        return true;
+    }
+
     ResourceManager::ResourceManager(const std::filesystem::path &basedir)
         : _base{std::filesystem::canonical(basedir)} {
         Utils::Info("Instantiating resource manager for base path: \"" + _base.string() + "\"");
+
+        _workers = std::make_unique<Utils::ThreadPool>();
     }
 
     ResourceManager::~ResourceManager() {
@@ -45,7 +81,7 @@ namespace mcvk::ResourceMgr {
         res.name = detail_sect.get("name");
 
 
-        // colour map
+        // colour maps
 
         if (!ini.has("textures")) {
             Utils::Error("Invalid material: [textures] section is required.");
@@ -53,11 +89,24 @@ namespace mcvk::ResourceMgr {
         }
         auto textures_sect = ini.get("textures");
 
-        std::string colourmap_path = GetMaterialResourcesDir() / std::filesystem::path{textures_sect.get("colour")};
-        res.colourmap = LoadImage(colourmap_path);
-        if (!res.colourmap->bytes) {
-            Utils::Error("Failed to load material: failed to load colour map image");
-        }
+        // `colour` is used for every side unless `top`, `bottom`, or `side` override it
+        auto get_colourmap = [&](const std::string &key) -> std::filesystem::path {
+            std::string file = textures_sect.has(key) ? textures_sect.get(key) : textures_sect.get("colour");
+            if (file.empty()) {
+                Utils::Error("Invalid material: no colour map for side \"" + key + "\" and no [textures] colour map to fall back on.");
+                return {};
+            }
+
+            std::filesystem::path path = GetMaterialResourcesDir() / std::filesystem::path{file};
+            if (!std::filesystem::exists(path)) {
+                Utils::Error("Failed to load material: " + key + " colour map image \"" + path.string() + "\" does not exist");
+            }
+            return path;
+        };
+
+        res.top_colourmap = get_colourmap("top");
+        res.bottom_colourmap = get_colourmap("bottom");
+        res.side_colourmap = get_colourmap("side");
 
 
         Utils::Info("Loaded material \"" + res.name + "\"");
@@ -135,6 +184,17 @@ namespace mcvk::ResourceMgr {
             Utils::Error("Invalid pipeline: \"" + type_str + "\" is not a valid type.");
         }
 
+        if (detail_sect.has("priority")) {
+            std::string priority_str = detail_sect.get("priority");
+            if (priority_str == "startup") {
+                res.priority = PipelineResource::Priority::Startup;
+            } else if (priority_str == "background") {
+                res.priority = PipelineResource::Priority::Background;
+            } else {
+                Utils::Error("Invalid pipeline: \"" + priority_str + "\" is not a valid priority.");
+            }
+        }
+
 
         // shaders
 
@@ -178,6 +238,42 @@ namespace mcvk::ResourceMgr {
         }
 
 
+        // specialization
+
+        if (ini.has("specialization")) {
+            auto spec_sect = ini.get("specialization");
+
+            // each key is a constant ID, and each value a comma-separated list of the values to build variants with
+            for (const auto &[id_str, values_str] : spec_sect) {
+                char *end;
+                unsigned long id = std::strtoul(id_str.c_str(), &end, 10);
+                if (id_str.empty() || id_str[0] == '-' || *end != '\0' || id > UINT32_MAX) {
+                    Utils::Error("Invalid pipeline: \"" + id_str + "\" is not a valid specialization constant ID. Skipping this constant.");
+                    continue;
+                }
+
+                std::vector<uint32_t> values;
+                std::stringstream stream{values_str};
+                std::string value_str;
+                while (std::getline(stream, value_str, ',')) {
+                    value_str.erase(0, value_str.find_first_not_of(" \t"));
+                    value_str.erase(value_str.find_last_not_of(" \t") + 1);
+
+                    uint32_t value;
+                    if (!__ParseSpecializationValue(value_str, value)) {
+                        Utils::Error("Invalid pipeline: \"" + value_str + "\" is not a valid specialization constant value. Skipping this value.");
+                        continue;
+                    }
+                    values.push_back(value);
+                }
+
+                if (!values.empty()) {
+                    res.specialization[static_cast<uint32_t>(id)] = values;
+                }
+            }
+        }
+
+
         Utils::Info("Loaded pipeline \"" + res.name + "\"");
         return true;
     }
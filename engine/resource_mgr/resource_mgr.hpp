@@ -8,11 +8,13 @@
 #pragma once
 
 #include "resource_entity.hpp"
+#include "utils/thread_pool.hpp"
 
 #define MINI_CASE_SENSITIVE
 #include <mini/ini.h>
 
 #include <filesystem>
+#include <memory>
 
 namespace mcvk::ResourceMgr {
     class ResourceManager {
@@ -25,15 +27,22 @@ namespace mcvk::ResourceMgr {
         template<typename RT>
         bool Load(const std::string &name, RT &res) const;
 
+        // shared by batch loads, e.g. decoding many images at once
+        inline Utils::ThreadPool &GetWorkers() const { return *_workers; }
+
         inline std::string GetMaterialResourcesDir() const { return _base.string() + "/materials/"; }
         inline std::string GetModelResourcesDir() const { return _base.string() + "/models/"; }
         inline std::string GetPipelineResourcesDir() const { return _base.string() + "/pipelines/"; }
         inline std::string GetShaderResourcesDir() const { return _base.string() + "/shaders/"; }
+        // generated on first load, e.g. compressed textures
+        inline std::string GetCacheDir() const { return _base.string() + "/cache/"; }
 
     private:
         bool _ReadConfigFile(const std::filesystem::path &path, mINI::INIStructure &ini) const;
 
         std::filesystem::path _base;
+
+        std::unique_ptr<Utils::ThreadPool> _workers;
     };
 
     template<>
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "texture_array.hpp"
+
+#include "utils/hash.hpp"
+#include "utils/log.hpp"
+
+#include <cstring>
+
+namespace mcvk::ResourceMgr {
+    TextureArrayPacker::TextureArrayPacker(uint32_t layer_width, uint32_t layer_height)
+        : _width{layer_width}, _height{layer_height} {
+    }
+
+    MaterialLayers TextureArrayPacker::Add(const MaterialResource &material) {
+        MaterialLayers layers{};
+        layers.top = _AddLayer(material.top_colourmap);
+        layers.bottom = _AddLayer(material.bottom_colourmap);
+        layers.side = _AddLayer(material.side_colourmap);
+        return layers;
+    }
+
+    TextureArrayData TextureArrayPacker::Build(Utils::ThreadPool &workers) const {
+        TextureArrayData data{};
+        data.width = _width;
+        data.height = _height;
+        data.layer_count = GetLayerCount();
+        data.bytes.resize(_GetLayerSize() * data.layer_count);
+
+        std::vector<std::string> paths;
+        for (const std::filesystem::path &path : _sources) {
+            paths.push_back(path.string());
+        }
+        ImageBatchLoadResult images = LoadImages(paths, workers);
+        LogImageBatchStats(paths, images, workers.GetThreadCount());
+
+        for (uint32_t l = 0; l < data.layer_count; l++) {
+            _PackLayer(_sources[l], *images.images[l], data.bytes.data() + _GetLayerSize() * l);
+        }
+
+        return data;
+    }
+
+    uint64_t TextureArrayPacker::GetSourceHash() const {
+        uint64_t hash = Utils::HashBytes(&_width, sizeof(_width));
+        hash = Utils::HashBytes(&_height, sizeof(_height), hash);
+
+        for (const std::filesystem::path &path : _sources) {
+            std::string name = path.string();
+            hash = Utils::HashBytes(name.data(), name.size(), hash);
+
+            std::error_code err;
+            uint64_t size = std::filesystem::file_size(path, err);
+            int64_t mtime = std::filesystem::last_write_time(path, err).time_since_epoch().count();
+            hash = Utils::HashBytes(&size, sizeof(size), hash);
+            hash = Utils::HashBytes(&mtime, sizeof(mtime), hash);
+        }
+
+        return hash;
+    }
+
+    uint32_t TextureArrayPacker::_AddLayer(const std::filesystem::path &path) {
+        auto [it, inserted] = _layer_indices.try_emplace(path.string(), static_cast<uint32_t>(_sources.size()));
+        if (inserted) {
+            _sources.push_back(path);
+        }
+        return it->second;
+    }
+
+    void TextureArrayPacker::_PackLayer(const std::filesystem::path &path, const ImageLoadResult &image, uint8_t *dst) const {
+        if (!image.bytes) {
+            // the load error has already been reported; leave the layer black rather than failing the whole array
+            std::memset(dst, 0, _GetLayerSize());
+        } else if (static_cast<uint32_t>(image.width) == _width && static_cast<uint32_t>(image.height) == _height) {
+            std::memcpy(dst, image.bytes, _GetLayerSize());
+        } else {
+            Utils::Warn("Colour map \"" + path.filename().string() + "\" is " + std::to_string(image.width) + "x" +
+                std::to_string(image.height) + "; resampling to " + std::to_string(_width) + "x" + std::to_string(_height));
+
+            // nearest-neighbour, to keep block textures sharp
+            for (uint32_t y = 0; y < _height; y++) {
+                size_t src_y = static_cast<size_t>(y) * image.height / _height;
+                for (uint32_t x = 0; x < _width; x++) {
+                    size_t src_x = static_cast<size_t>(x) * image.width / _width;
+                    std::memcpy(dst + (static_cast<size_t>(y) * _width + x) * 4, image.bytes + (src_y * image.width + src_x) * 4, 4);
+                }
+            }
+        }
+    }
+}
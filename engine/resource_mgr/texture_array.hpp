@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include "image_load.hpp"
+#include "resource_entity.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+namespace mcvk::ResourceMgr {
+    // array layers holding each side of a material's block
+    struct MaterialLayers {
+        uint32_t top;
+        uint32_t bottom;
+        uint32_t side;
+    };
+
+    struct TextureArrayData {
+        uint32_t width;
+        uint32_t height;
+        uint32_t layer_count;
+
+        // 8-bit RGBA layers, tightly packed one after another
+        std::vector<uint8_t> bytes;
+    };
+
+    // Packs the colour maps of every material into the layers of a single texture array, so that all blocks can be drawn with one
+    // image binding. Every layer has the same size; colour maps of any other size are resampled to fit. Layers are only assigned
+    // when materials are added - images are decoded by Build(), which can be skipped if a cached copy of the array matches
+    // GetSourceHash().
+    class TextureArrayPacker {
+    public:
+        TextureArrayPacker(uint32_t layer_width, uint32_t layer_height);
+
+        TextureArrayPacker(const TextureArrayPacker &) = delete;
+        TextureArrayPacker &operator=(const TextureArrayPacker &) = delete;
+
+        // colour maps shared between sides or materials also share a layer
+        MaterialLayers Add(const MaterialResource &material);
+
+        // decode (concurrently across the workers) and resample every colour map into the array
+        TextureArrayData Build(Utils::ThreadPool &workers) const;
+
+        // identifies the packed array: changes if any colour map file is modified, or layers are assigned differently
+        uint64_t GetSourceHash() const;
+
+        inline uint32_t GetLayerWidth() const { return _width; }
+        inline uint32_t GetLayerHeight() const { return _height; }
+        inline uint32_t GetLayerCount() const { return static_cast<uint32_t>(_sources.size()); }
+
+    private:
+        uint32_t _AddLayer(const std::filesystem::path &path);
+        void _PackLayer(const std::filesystem::path &path, const ImageLoadResult &image, uint8_t *dst) const;
+
+        inline size_t _GetLayerSize() const { return static_cast<size_t>(_width) * _height * 4; }
+
+        uint32_t _width;
+        uint32_t _height;
+
+        std::vector<std::filesystem::path> _sources;
+        std::unordered_map<std::string, uint32_t> _layer_indices;
+    };
+}
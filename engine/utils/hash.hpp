@@ -10,6 +10,9 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
 
+#include <cstddef>
+#include <cstdint>
+
 namespace mcvk::Utils {
     // from: https://stackoverflow.com/a/57595105
     template <typename T, typename... Rest>
@@ -17,4 +20,19 @@ namespace mcvk::Utils {
         seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
         (HashCombine(seed, rest), ...);
     };
+
+    // FNV-1a offset basis, i.e. the hash of no data
+    static constexpr uint64_t HASH_BYTES_BASIS = 0xcbf29ce484222325ull;
+
+    // 64-bit FNV-1a, for identifying blobs of data such as file contents; pass a previous result as the seed to hash data given
+    // in pieces, which gives the same result as hashing the pieces concatenated
+    inline uint64_t HashBytes(const void *data, size_t size, uint64_t seed = HASH_BYTES_BASIS) {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        }
+        return hash;
+    }
 }
@@ -12,9 +12,14 @@
 
 #include <ctime>
 #include <iostream>
+#include <mutex>
 
 static std::string __GetCurrentDateTime(const bool with_time);
 
+// messages are logged from worker threads too, so each one (along with its colour changes) is written under this lock so that
+// lines don't interleave
+static std::mutex __log_mutex;
+
 namespace mcvk::Utils {
     void ResetLogColour() {
         ciocolstatedef(stdout);
@@ -23,30 +28,37 @@ namespace mcvk::Utils {
     void Log(const std::string &msg) {
         // verbose messages not shown in release
 #       ifdef DEBUG
+            std::lock_guard<std::mutex> lock{__log_mutex};
             std::cout << "[" << __GetCurrentDateTime(true) << "] DEBUG: " << msg << std::endl;
 #       endif
     }
 
     void Info(const std::string &msg) {
+        std::lock_guard<std::mutex> lock{__log_mutex};
         std::cout << "[" << __GetCurrentDateTime(true) << "] " << msg << std::endl;
     }
 
     void Warn(const std::string &msg) {
+        std::lock_guard<std::mutex> lock{__log_mutex};
         ciocolstateset(CIOCOL_YELLOW, 0xff, stdout);
         std::cout << "[" << __GetCurrentDateTime(true) << "] WARN: " << msg << std::endl;
         ciocolstatedef(stdout);
     }
 
     void Error(const std::string &msg) {
+        std::lock_guard<std::mutex> lock{__log_mutex};
         ciocolstateset(CIOCOL_RED, 0xff, stdout);
         std::cout << "[" << __GetCurrentDateTime(true) << "] ERROR: " << msg << std::endl;
         ciocolstatedef(stdout);
     }
 
     void Fatal(const std::string &msg, bool except) {
-        ciocolstateset(CIOCOL_RED, 0xff, stdout);
-        std::cout << "[" << __GetCurrentDateTime(true) << "] FATAL: " << msg << std::endl;
-        ciocolstatedef(stdout);
+        {
+            std::lock_guard<std::mutex> lock{__log_mutex};
+            ciocolstateset(CIOCOL_RED, 0xff, stdout);
+            std::cout << "[" << __GetCurrentDateTime(true) << "] FATAL: " << msg << std::endl;
+            ciocolstatedef(stdout);
+        }
 
         if (except) {
             throw new std::runtime_error(msg);
@@ -56,7 +68,14 @@ namespace mcvk::Utils {
 
 static std::string __GetCurrentDateTime(const bool with_time) {
     std::time_t t = std::time(nullptr);
-    std::tm *tm = std::localtime(&t);
+
+    // std::localtime() returns a buffer shared between threads
+    std::tm tm_buf;
+#   ifdef _WIN32
+        std::tm *tm = (localtime_s(&tm_buf, &t) == 0) ? &tm_buf : nullptr;
+#   else
+        std::tm *tm = localtime_r(&t, &tm_buf);
+#   endif
 
     char buf[64];
 
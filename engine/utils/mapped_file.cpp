@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "mapped_file.hpp"
+
+#include "log.hpp"
+
+#ifdef WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+namespace mcvk::Utils {
+#   ifdef WIN32
+        MappedFile::MappedFile(const std::string &path) {
+            _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (_file == INVALID_HANDLE_VALUE) {
+                _file = nullptr;
+                Error("Failed to open file \"" + path + "\" for mapping");
+                return;
+            }
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0) {
+                return;
+            }
+
+            _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!_mapping) {
+                Error("Failed to map file \"" + path + "\"");
+                return;
+            }
+
+            _data = static_cast<const uint8_t *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+            if (!_data) {
+                Error("Failed to map file \"" + path + "\"");
+                return;
+            }
+            _size = static_cast<size_t>(size.QuadPart);
+        }
+
+        MappedFile::~MappedFile() {
+            if (_data) {
+                UnmapViewOfFile(_data);
+            }
+            if (_mapping) {
+                CloseHandle(_mapping);
+            }
+            if (_file) {
+                CloseHandle(_file);
+            }
+        }
+#   else
+        MappedFile::MappedFile(const std::string &path) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                Error("Failed to open file \"" + path + "\" for mapping");
+                return;
+            }
+
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED) {
+                    Error("Failed to map file \"" + path + "\"");
+                } else {
+                    _data = static_cast<const uint8_t *>(data);
+                    _size = static_cast<size_t>(st.st_size);
+                }
+            }
+
+            // the mapping stays valid once the descriptor is closed
+            close(fd);
+        }
+
+        MappedFile::~MappedFile() {
+            if (_data) {
+                munmap(const_cast<uint8_t *>(_data), _size);
+            }
+        }
+#   endif
+}
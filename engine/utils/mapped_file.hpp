@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mcvk::Utils {
+    // A read-only view of a whole file mapped into memory, unmapped on destruction. Empty files and files that fail to open are
+    // left unmapped (with an error reported in the latter case).
+    class MappedFile {
+    public:
+        MappedFile(const std::string &path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        inline bool IsMapped() const { return _data != nullptr; }
+        inline const uint8_t *GetData() const { return _data; }
+        inline size_t GetSize() const { return _size; }
+
+    private:
+        const uint8_t *_data{nullptr};
+        size_t _size{0};
+
+#       ifdef WIN32
+            void *_file{nullptr};
+            void *_mapping{nullptr};
+#       endif
+    };
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace mcvk::Utils {
+    ThreadPool::ThreadPool(uint32_t threads) {
+        if (threads == 0) {
+            threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        }
+
+        _workers.reserve(threads);
+        for (uint32_t i = 0; i < threads; i++) {
+            _workers.emplace_back(&ThreadPool::_WorkerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _stopping = true;
+        }
+        _task_cv.notify_all();
+
+        // queued tasks are finished before the workers exit
+        for (std::thread &worker : _workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::Submit(std::function<void()> &&task) {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _tasks.push(std::move(task));
+            _pending++;
+        }
+        _task_cv.notify_one();
+    }
+
+    void ThreadPool::Wait() {
+        std::unique_lock<std::mutex> lock{_mutex};
+        _idle_cv.wait(lock, [this]() { return _pending == 0; });
+    }
+
+    void ThreadPool::_WorkerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock{_mutex};
+                _task_cv.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+                if (_tasks.empty()) {
+                    return;
+                }
+
+                task = std::move(_tasks.front());
+                _tasks.pop();
+            }
+
+            task();
+
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                _pending--;
+                if (_pending == 0) {
+                    _idle_cv.notify_all();
+                }
+            }
+        }
+    }
+}
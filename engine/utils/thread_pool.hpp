@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace mcvk::Utils {
+    // A fixed set of worker threads running submitted tasks in order of submission. Tasks must not throw.
+    class ThreadPool {
+    public:
+        // 0 threads uses one fewer than the number of hardware threads (at least 1), leaving one for the calling thread
+        ThreadPool(uint32_t threads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        void Submit(std::function<void()> &&task);
+        // block until every task submitted so far has finished
+        void Wait();
+
+        inline uint32_t GetThreadCount() const { return static_cast<uint32_t>(_workers.size()); }
+
+    private:
+        void _WorkerLoop();
+
+        std::vector<std::thread> _workers;
+
+        std::queue<std::function<void()>> _tasks;
+        // tasks queued or running
+        uint32_t _pending{0};
+        bool _stopping{false};
+
+        std::mutex _mutex;
+        std::condition_variable _task_cv;
+        std::condition_variable _idle_cv;
+    };
+}
@@ -9,13 +9,18 @@
 
 #include "engine/renderer/resource/buffer.hpp"
 #include "engine/renderer/resource/descriptor.hpp"
+#include "engine/renderer/resource/image_upload_batch.hpp"
+#include "engine/renderer/resource/uniform_allocator.hpp"
 #include "engine/renderer/data/model.hpp"
+#include "engine/resource_mgr/compressed_texture.hpp"
+#include "engine/resource_mgr/texture_array.hpp"
 #include "engine/utils/log.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <chrono>
 #include <cmath>
 
 namespace mcvk::Game {
@@ -25,94 +30,222 @@ namespace mcvk::Game {
     };
     struct ModelUniformData {
         glm::mat4 transform{1.0f};
+        // texture array layers for the top, bottom, and side faces (w unused)
+        glm::uvec4 layers{0};
     };
 
-    Game::Game(const std::filesystem::path &resourcedir)
-        : _resources{resourcedir}, _window{720, 540, "Minecraft Vulkan"}, _renderer{_window, _resources} {
+    Game::Config Game::Config::Defaults() {
+        Config config{};
+
+        config.headless = false;
+        config.extent = { 720, 540 };
+        config.frame_limit = 0;
+        config.capture_path = "";
+
+        config.frames_in_flight = 2;
+        config.render_scale = 1.0f;
+        config.frame_time_budget = 0.0f;
+
+        config.benchmark_uploads = false;
+
+        return config;
+    }
+
+    Game::Game(const std::filesystem::path &resourcedir, const Config &config)
+        : _config{config},
+        _resources{resourcedir},
+        _window{config.headless ? nullptr :
+            std::make_unique<Renderer::Window>(config.extent.width, config.extent.height, "Minecraft Vulkan")},
+        _renderer{_window.get(), config.extent, _resources, _GetRendererConfig(config)} {
+        if (_config.headless && _config.frame_limit == 0) {
+            _config.frame_limit = _DEFAULT_HEADLESS_FRAMES;
+        }
     }
 
     Game::~Game() {
     }
 
+    Renderer::Renderer::Config Game::_GetRendererConfig(const Config &config) {
+        auto renderer_config = Renderer::Renderer::Config::Defaults();
+
+        renderer_config.frames_in_flight = config.frames_in_flight;
+        renderer_config.render_scale = config.render_scale;
+        renderer_config.frame_time_budget = config.frame_time_budget;
+
+        return renderer_config;
+    }
+
+    double Game::_TimeGeometryUpload(const Renderer::Model &model, bool allow_direct, uint32_t iterations, bool &direct) {
+        const Renderer::Device &device = _renderer.GetDevice();
+
+        std::chrono::duration<double, std::milli> total{0.0};
+        for (uint32_t i = 0; i < iterations; i++) {
+            auto start = std::chrono::steady_clock::now();
+            Renderer::VertexBuffer vbo{device, model.GetVertexDataSize(), allow_direct};
+            vbo.Write(model.GetVertexDataPtr());
+            Renderer::IndexBuffer ibo{device, model.GetIndexDataSize(), Renderer::Model::GetIndexType(), allow_direct};
+            ibo.Write(model.GetIndexDataPtr());
+            device.GetUploadScheduler().WaitIdle();
+            total += std::chrono::steady_clock::now() - start;
+
+            direct = vbo.IsDirectWrite();
+        }
+
+        // the buffers are only queued for deletion, so release them before the next path is timed; nothing has been rendered yet,
+        // so idling the device here is cheap
+        device.WaitIdle();
+        device.GetDeletionQueue().RetireAll();
+
+        return total.count() / iterations;
+    }
+
+    void Game::_BenchmarkGeometryUpload(const Renderer::Model &model) {
+        bool direct;
+        double direct_time = _TimeGeometryUpload(model, true, _UPLOAD_BENCHMARK_ITERATIONS, direct);
+        bool staged_direct;
+        double staged_time = _TimeGeometryUpload(model, false, _UPLOAD_BENCHMARK_ITERATIONS, staged_direct);
+
+        if (!direct) {
+            Utils::Info("Geometry upload benchmark: no host-visible device-local memory for direct writes; staged upload took " +
+                std::to_string(staged_time) + " ms");
+            return;
+        }
+        Utils::Info("Geometry upload benchmark (mean of " + std::to_string(_UPLOAD_BENCHMARK_ITERATIONS) + "): direct write took " +
+            std::to_string(direct_time) + " ms, staged took " + std::to_string(staged_time) + " ms");
+    }
+
     void Game::Run() {
         ResourceMgr::ModelResource mdl;
         _resources.Load("cube.model", mdl);
         auto model = Renderer::Model::CreateFromResource(mdl);
 
+        if (_config.benchmark_uploads) {
+            _BenchmarkGeometryUpload(model);
+        }
+
+        // time geometry upload up to the point the data is usable by the device
+        auto upload_start = std::chrono::steady_clock::now();
         Renderer::VertexBuffer vbo{_renderer.GetDevice(), model.GetVertexDataSize()};
-        vbo.Map();
         vbo.Write(model.GetVertexDataPtr());
-        vbo.Unmap();
         Renderer::IndexBuffer ibo{_renderer.GetDevice(), model.GetIndexDataSize(), Renderer::Model::GetIndexType()};
-        ibo.Map();
         ibo.Write(model.GetIndexDataPtr());
-        ibo.Unmap();
+        _renderer.GetDevice().GetUploadScheduler().WaitIdle();
+        std::chrono::duration<double, std::milli> upload_time = std::chrono::steady_clock::now() - upload_start;
+        Utils::Info("Geometry upload took " + std::to_string(upload_time.count()) + " ms (" +
+                   (vbo.IsDirectWrite() ? "direct write" : "staged") + ")");
 
         Renderer::UniformBuffer ubo_global{_renderer,
                                            Renderer::UniformBuffer::AlignOffset(_renderer.GetDevice(), sizeof(GlobalUniformData))};
-        Renderer::UniformBuffer ubo_model{_renderer,
-                                           Renderer::UniformBuffer::AlignOffset(_renderer.GetDevice(), sizeof(ModelUniformData))};
+        // per-object data is pushed into a per-frame linear allocator and selected with a dynamic offset at bind time
+        Renderer::UniformAllocator model_uniforms{_renderer,
+                                                  _MAX_OBJECTS_PER_FRAME * Renderer::UniformBuffer::AlignOffset(_renderer.GetDevice(), sizeof(ModelUniformData))};
+
+        // every block material is packed into one texture array, so the world is drawn with a single descriptor set
+        ResourceMgr::TextureArrayPacker block_textures{_BLOCK_TEXTURE_SIZE, _BLOCK_TEXTURE_SIZE};
+        ResourceMgr::MaterialLayers grass_layers{};
+        {
+            ResourceMgr::MaterialResource mat;
+            _resources.Load("grass_block.material", mat);
+            grass_layers = block_textures.Add(mat);
+        }
+        auto block_img_config = Renderer::Image::Config::Defaults({_BLOCK_TEXTURE_SIZE, _BLOCK_TEXTURE_SIZE}, VK_FORMAT_R8G8B8A8_SRGB);
+        block_img_config.generate_mipmaps = true;
 
-        ResourceMgr::MaterialResource mat;
-        _resources.Load("grass_block.material", mat);
-        auto grass_img_config = Renderer::Image::Config::Defaults(
-            {(uint32_t) mat.colourmap->width, (uint32_t) mat.colourmap->height}, VK_FORMAT_R8G8B8A8_SRGB);
-        Renderer::Image grass_img{_renderer.GetDevice(), grass_img_config, *mat.colourmap};
+        // block-compressed textures are cached on disk, so colour maps are only decoded and encoded again when they change
+        auto textures_start = std::chrono::steady_clock::now();
+        // every texture created at startup is staged together and transitioned in one pass
+        Renderer::ImageUploadBatch texture_uploads{_renderer.GetDevice()};
+        std::unique_ptr<Renderer::Image> block_img;
+        VkFormat block_compressed_format = Renderer::Image::GetBlockCompressedFormat(_BLOCK_TEXTURE_FORMAT, true);
+        if (_renderer.GetDevice().SupportsBlockCompression() && _renderer.GetDevice().SupportsSampledImage(block_compressed_format)) {
+            std::filesystem::path cache_path = _resources.GetCacheDir() + "block_textures." +
+                ResourceMgr::BlockFormatToString(_BLOCK_TEXTURE_FORMAT) + ".mcvktex";
+            uint64_t source_hash = block_textures.GetSourceHash();
 
-        VkDescriptorSetLayout dset_layout = Renderer::DescriptorSetLayoutBuilder::New()
-            .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT)
-            .AddBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT)
-            .AddBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT) // TODO find out how to properly do multiple samplers
-            .AddBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
-            .Build(_renderer.GetDevice());
+            ResourceMgr::CompressedTexture compressed;
+            if (!ResourceMgr::LoadCompressedTexture(cache_path, source_hash, compressed)) {
+                compressed = ResourceMgr::CompressTexture(block_textures.Build(_resources.GetWorkers()), _BLOCK_TEXTURE_FORMAT, true, true);
+                if (ResourceMgr::SaveCompressedTexture(cache_path, compressed, source_hash)) {
+                    Utils::Info("Cached compressed block textures at \"" + cache_path.string() + "\"");
+                }
+            }
+            block_img = std::make_unique<Renderer::Image>(_renderer.GetDevice(), block_img_config, compressed, &texture_uploads);
+        } else {
+            block_img = std::make_unique<Renderer::Image>(_renderer.GetDevice(), block_img_config, block_textures.Build(_resources.GetWorkers()),
+                &texture_uploads);
+        }
+        texture_uploads.Submit();
+        std::chrono::duration<double, std::milli> textures_time = std::chrono::steady_clock::now() - textures_start;
+        bool block_img_compressed = block_img->GetFormat() == block_compressed_format;
+        Utils::Log("Block textures took " + std::to_string(textures_time.count()) + " ms (" +
+                   std::to_string(block_textures.GetLayerCount()) + " layers, " +
+                   (block_img_compressed ? ResourceMgr::BlockFormatToString(_BLOCK_TEXTURE_FORMAT) : "uncompressed") + ")");
 
-        _renderer.BuildPipelines({ dset_layout });
+        // set layouts are reflected from the shaders; the uniform buffers are bound with dynamic offsets, and the block textures'
+        // sampler is baked into the layout
+        _renderer.BuildPipelines({
+            { 0, 0, true },
+            { 0, 1, true },
+            { 0, 2, false, block_img->GetSampler() },
+        });
+
+        const Renderer::GraphicsPipeline &g_simple = _renderer.Pipelines().GraphicsByName("g_simple");
+        VkDescriptorSetLayout dset_layout = g_simple.GetSetLayout(0);
 
         std::vector<Renderer::DescriptorAllocatorGrowable::PoolSizeRatio> descriptor_ratios{
-            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
-            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2 },
             { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 },
         };
         Renderer::DescriptorAllocatorGrowable dalloc{_renderer.GetDevice(), 2, descriptor_ratios};
 
         VkDescriptorSet dset = dalloc.AllocateSet(dset_layout);
         Renderer::DescriptorWriter::New()
-            .AddWriteBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, ubo_global)
-            .AddWriteBuffer(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, ubo_model, 0,
-                            Renderer::UniformBuffer::AlignOffset(_renderer.GetDevice(), sizeof(ModelUniformData)))
-            .AddWriteImage(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, grass_img)
+            .AddWriteBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, ubo_global)
+            .AddWriteBuffer(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, model_uniforms, 0, sizeof(ModelUniformData))
+            .AddWriteImage(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, *block_img)
             .UpdateSet(_renderer.GetDevice(), dset);
 
-        const Renderer::GraphicsPipeline &g_simple = _renderer.Pipelines().GraphicsByName("g_simple");
-        const Renderer::GraphicsPipeline &g_wireframe = _renderer.Pipelines().GraphicsByName("g_wireframe");
+        _renderer.GetDevice().GetAllocator().LogStats();
+        _renderer.GetDevice().GetMemoryBudget().LogStats();
+        _renderer.GetDevice().GetSamplerCache().LogStats();
+        _renderer.GetDevice().GetShaderModuleCache().LogStats();
+        _renderer.GetDevice().GetLayoutCache().LogStats();
 
         Utils::Info("Entering main loop...");
+        auto loop_start = std::chrono::steady_clock::now();
         while (true) {
-            if (!_window.Update()) {
+            if (_window && !_window->Update()) {
                 break;
             }
-
-            {
-                GlobalUniformData d;
-                d.projection = glm::perspective(glm::radians(70.0f), _window.GetAspectRatio(), 0.1f, 100.0f);
-                d.view = glm::lookAt(glm::vec3{0.0f, -1.5f, -2.0f}, glm::vec3{0.0f}, glm::vec3{0.0f, 3.5f, 0.0f});
-                ubo_global.Write(&d);
-            }
-            {
-                ModelUniformData d;
-                d.transform = glm::rotate(glm::mat4{1.0f}, (float) glm::radians(std::fmod(glfwGetTime() * 100, 360)), glm::vec3{0, 1, 0});
-                ubo_model.Write(&d);
+            if (_config.frame_limit > 0 && _renderer.GetFrameNumber() >= _config.frame_limit) {
+                break;
             }
 
             if (auto drawbuf = _renderer.BeginDrawCommandBuffer()) {
-                drawbuf->BeginRenderPass({ (float) std::abs(sin(glfwGetTime() * 2)), 0.0, 0.0 });
+                double time = _window ? std::chrono::duration<double>(std::chrono::steady_clock::now() - loop_start).count()
+                    : static_cast<double>(_renderer.GetFrameNumber()) / _HEADLESS_FRAME_RATE;
+
+                // uniform data is written once the frame slot is acquired, as its copy may be in use by the GPU until then
+                {
+                    GlobalUniformData d;
+                    d.projection = glm::perspective(glm::radians(70.0f), _renderer.GetAspectRatio(), 0.1f, 100.0f);
+                    d.view = glm::lookAt(glm::vec3{0.0f, -1.5f, -2.0f}, glm::vec3{0.0f}, glm::vec3{0.0f, 3.5f, 0.0f});
+                    ubo_global.Write(&d);
+                }
+
+                ModelUniformData cube_data;
+                cube_data.transform = glm::rotate(glm::mat4{1.0f}, (float) glm::radians(std::fmod(time * 100, 360)), glm::vec3{0, 1, 0});
+                cube_data.layers = { grass_layers.top, grass_layers.bottom, grass_layers.side, 0 };
+                uint32_t cube_offset = model_uniforms.Push(cube_data);
+
+                drawbuf->BeginRenderPass({ (float) std::abs(sin(time * 2)), 0.0, 0.0 });
 
                 drawbuf->UpdateViewportAndScissor();
 
                 drawbuf->BindPipeline(g_simple);
                 drawbuf->BindVertexBuffer(vbo);
                 drawbuf->BindIndexBuffer(ibo);
-                drawbuf->BindDescriptorSets(g_simple, { dset }, { 0 });
+                drawbuf->BindDescriptorSets(g_simple, { dset }, { ubo_global.GetFrameOffset(), cube_offset });
                 drawbuf->DrawIndexed(model.indices.size());
 
                 drawbuf->EndRenderPass();
@@ -123,8 +256,15 @@ namespace mcvk::Game {
         // wait for the GPU to complete work
         _renderer.WaitDeviceIdle();
 
-        Utils::Info("Window closed");
+        bool limit_reached = _config.frame_limit > 0 && _renderer.GetFrameNumber() >= _config.frame_limit;
+        Utils::Info(limit_reached ? "Frame limit reached" : "Window closed");
+
+        if (!_config.capture_path.empty() && _renderer.CaptureLastFrame(_config.capture_path)) {
+            Utils::Info("Captured final frame to \"" + _config.capture_path + "\"");
+        }
 
-        vkDestroyDescriptorSetLayout(_renderer.GetDevice().GetDevice(), dset_layout, nullptr);
+        _renderer.LogFrameStats();
+        _renderer.GetDevice().GetUploadScheduler().LogStats();
+        _renderer.GetDevice().GetDeletionQueue().LogStats();
     }
 }
@@ -7,24 +7,70 @@
 
 #pragma once
 
+#include "engine/renderer/data/model.hpp"
 #include "engine/renderer/renderer.hpp"
 #include "engine/renderer/window.hpp"
+#include "engine/resource_mgr/block_compression.hpp"
 #include "engine/resource_mgr/resource_mgr.hpp"
 
 #include <filesystem>
+#include <memory>
+#include <string>
 
 namespace mcvk::Game {
     class Game {
     public:
-        Game(const std::filesystem::path &resourcedir);
+        struct Config {
+            // render offscreen rather than opening a window, e.g. for benchmarking on a machine with no display
+            bool headless;
+            VkExtent2D extent;
+
+            // exit after this many frames; 0 runs until the window is closed, or for _DEFAULT_HEADLESS_FRAMES when headless
+            uint64_t frame_limit;
+            // headless only: the last frame is written here as a PPM image before exiting, unless empty
+            std::string capture_path;
+
+            // see Renderer::Config
+            uint32_t frames_in_flight;
+            float render_scale;
+            float frame_time_budget;
+
+            // time geometry uploads through both direct writes and staging at startup, and report the two
+            bool benchmark_uploads;
+
+            static Config Defaults();
+        };
+
+        Game(const std::filesystem::path &resourcedir, const Config &config = Config::Defaults());
         ~Game();
 
         void Run();
 
     private:
+        static constexpr uint32_t _MAX_OBJECTS_PER_FRAME = 4096;
+        // width and height of every layer in the block texture array
+        static constexpr uint32_t _BLOCK_TEXTURE_SIZE = 64;
+        // used when the device supports it; BC7 keeps the quality of alpha-tested textures at a quarter of the size
+        static constexpr ResourceMgr::BlockFormat _BLOCK_TEXTURE_FORMAT = ResourceMgr::BlockFormat::BC7;
+        static constexpr uint64_t _DEFAULT_HEADLESS_FRAMES = 600;
+        // headless frames are animated at a fixed rate rather than by wall-clock time, so that captures are reproducible
+        static constexpr double _HEADLESS_FRAME_RATE = 60.0;
+        // geometry is uploaded this many times per path when benchmarking uploads, to average out timer and scheduling noise
+        static constexpr uint32_t _UPLOAD_BENCHMARK_ITERATIONS = 64;
+
+        static Renderer::Renderer::Config _GetRendererConfig(const Config &config);
+
+        // returns the mean time in milliseconds to upload the model's geometry until it is usable by the device; direct is set to
+        // whether the buffers were written directly
+        double _TimeGeometryUpload(const Renderer::Model &model, bool allow_direct, uint32_t iterations, bool &direct);
+        void _BenchmarkGeometryUpload(const Renderer::Model &model);
+
+        Config _config;
+
         ResourceMgr::ResourceManager _resources;
 
-        Renderer::Window _window;
+        // null when headless
+        std::unique_ptr<Renderer::Window> _window;
         Renderer::Renderer _renderer;
     };
 }
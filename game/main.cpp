@@ -8,16 +8,109 @@
 #include "game/game.hpp"
 #include "engine/utils/log.hpp"
 
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
 using namespace mcvk;
 
+static bool __ParseUInt(const char *str, uint64_t &value) {
+    const char *end = str + std::strlen(str);
+    auto [ptr, err] = std::from_chars(str, end, value);
+    return err == std::errc{} && ptr == end;
+}
+
+static bool __ParseFloat(const char *str, float &value) {
+    char *end;
+    value = std::strtof(str, &end);
+    return end != str && *end == '\0';
+}
+
+static bool __ParseExtent(const char *str, VkExtent2D &extent) {
+    const char *sep = std::strchr(str, 'x');
+    if (!sep) {
+        return false;
+    }
+
+    uint64_t width, height;
+    std::string wstr{str, sep};
+    if (!__ParseUInt(wstr.c_str(), width) || !__ParseUInt(sep + 1, height) || width == 0 || height == 0) {
+        return false;
+    }
+
+    extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+    return true;
+}
+
+static bool __ParseArgs(int argc, char **argv, Game::Game::Config &config) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg{argv[i]};
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--headless") {
+            config.headless = true;
+        } else if (arg == "--frames" && has_value) {
+            if (!__ParseUInt(argv[++i], config.frame_limit)) {
+                Utils::Error("Invalid frame count \"" + std::string{argv[i]} + "\"");
+                return false;
+            }
+        } else if (arg == "--size" && has_value) {
+            if (!__ParseExtent(argv[++i], config.extent)) {
+                Utils::Error("Invalid size \"" + std::string{argv[i]} + "\"; expected WIDTHxHEIGHT");
+                return false;
+            }
+        } else if (arg == "--frames-in-flight" && has_value) {
+            uint64_t frames;
+            if (!__ParseUInt(argv[++i], frames) || frames == 0 || frames > Renderer::Renderer::MAX_FRAMES_IN_FLIGHT) {
+                Utils::Error("Invalid frames in flight \"" + std::string{argv[i]} + "\"; expected 1 to " +
+                    std::to_string(Renderer::Renderer::MAX_FRAMES_IN_FLIGHT));
+                return false;
+            }
+            config.frames_in_flight = static_cast<uint32_t>(frames);
+        } else if (arg == "--render-scale" && has_value) {
+            if (!__ParseFloat(argv[++i], config.render_scale) || config.render_scale <= 0.0f || config.render_scale > 1.0f) {
+                Utils::Error("Invalid render scale \"" + std::string{argv[i]} + "\"; expected a fraction in (0, 1]");
+                return false;
+            }
+        } else if (arg == "--frame-budget" && has_value) {
+            if (!__ParseFloat(argv[++i], config.frame_time_budget) || config.frame_time_budget <= 0.0f) {
+                Utils::Error("Invalid frame time budget \"" + std::string{argv[i]} + "\"; expected a number of milliseconds");
+                return false;
+            }
+        } else if (arg == "--capture" && has_value) {
+            config.capture_path = argv[++i];
+        } else if (arg == "--benchmark-uploads") {
+            config.benchmark_uploads = true;
+        } else {
+            Utils::Error("Unrecognised or incomplete argument \"" + arg + "\"");
+            return false;
+        }
+    }
+
+    if (!config.capture_path.empty() && !config.headless) {
+        Utils::Error("--capture requires --headless");
+        return false;
+    }
+
+    return true;
+}
+
 int main(int argc, char **argv) {
     Utils::ResetLogColour();
 
     auto execdir = std::filesystem::path{argv[0]};
     auto resourcedir = std::filesystem::path{execdir.remove_filename().string() + "/resources/"};
 
+    auto config = Game::Game::Config::Defaults();
+    if (!__ParseArgs(argc, argv, config)) {
+        Utils::Info("Usage: " + std::string{argv[0]} + " [--headless] [--frames COUNT] [--size WIDTHxHEIGHT] [--capture PATH.ppm] "
+            "[--frames-in-flight COUNT] [--render-scale FRACTION] [--frame-budget MS] [--benchmark-uploads]");
+        return EXIT_FAILURE;
+    }
+
     try {
-        Game::Game game{resourcedir};
+        Game::Game game{resourcedir, config};
 
         game.Run();
     } catch (const std::exception &e) {
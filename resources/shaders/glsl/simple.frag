@@ -3,11 +3,12 @@
 
 layout(location = 0) in vec3 i_VERTEX_COLOUR;
 layout(location = 1) in vec2 i_UV;
+layout(location = 2) flat in uint i_LAYER;
 
 layout(location = 0) out vec4 o_COLOUR;
 
-layout(set = 0, binding = 2) uniform sampler2D u_SAMPLER;
+layout(set = 0, binding = 2) uniform sampler2DArray u_BLOCK_TEXTURES;
 
 void main() {
-    o_COLOUR = texture(u_SAMPLER, i_UV);
+    o_COLOUR = texture(u_BLOCK_TEXTURES, vec3(i_UV, float(i_LAYER)));
 }
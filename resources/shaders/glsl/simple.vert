@@ -8,6 +8,7 @@ layout(location = 3) in vec2 i_UV;
 
 layout(location = 0) out vec3 o_VERTEX_COLOUR;
 layout(location = 1) out vec2 o_UV;
+layout(location = 2) flat out uint o_LAYER;
 
 layout(set = 0, binding = 0) uniform GlobalUbo_t {
     mat4 projection;
@@ -16,6 +17,7 @@ layout(set = 0, binding = 0) uniform GlobalUbo_t {
 
 layout(set = 0, binding = 1) uniform ModelUbo_t {
     mat4 transform;
+    uvec4 layers; // top, bottom, side
 } u_MODEL;
 
 void main() {
@@ -23,4 +25,6 @@ void main() {
 
     o_VERTEX_COLOUR = i_COLOUR;
     o_UV = i_UV;
+    // faces are flat, so the model-space normal picks the texture layer
+    o_LAYER = (i_NORMAL.y > 0.5) ? u_MODEL.layers.x : ((i_NORMAL.y < -0.5) ? u_MODEL.layers.y : u_MODEL.layers.z);
 }
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Minimal support shared by the CPU-side tests, which are built against only the engine sources they cover so that they run
+// without Vulkan, a window, or any of the other dependencies.
+
+namespace mcvk::Tests {
+    inline int failures = 0;
+
+    // returns the condition, so that loops can stop at the first failure rather than repeating it
+    inline bool Check(bool condition, const char *expr, const char *file, int line) {
+        if (!condition) {
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+            failures++;
+        }
+        return condition;
+    }
+
+    // report the result of a test program; returned from main()
+    inline int Finish(const char *name) {
+        if (failures > 0) {
+            std::fprintf(stderr, "%s: %d check(s) failed\n", name, failures);
+            return EXIT_FAILURE;
+        }
+        std::printf("%s: passed\n", name);
+        return EXIT_SUCCESS;
+    }
+
+    class Timer {
+    public:
+        inline void Start() { _start = std::chrono::steady_clock::now(); }
+        inline void Stop() { _elapsed += std::chrono::steady_clock::now() - _start; }
+
+        inline double GetSeconds() const { return _elapsed.count(); }
+
+    private:
+        std::chrono::steady_clock::time_point _start{};
+        std::chrono::duration<double> _elapsed{0.0};
+    };
+}
+
+#define MCVK_CHECK(condition) ::mcvk::Tests::Check((condition), #condition, __FILE__, __LINE__)
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "harness.hpp"
+
+#include "resource_mgr/mipmap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace mcvk;
+
+static std::vector<uint8_t> __RandomImage(uint32_t width, uint32_t height, uint64_t seed) {
+    std::mt19937_64 rng{seed};
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+    for (uint8_t &b : rgba) {
+        b = static_cast<uint8_t>(rng());
+    }
+    return rgba;
+}
+
+static double __SRGBToLinear(double c) {
+    return (c <= 0.04045) ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+}
+
+static double __LinearToSRGB(double c) {
+    return (c <= 0.0031308) ? c * 12.92 : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+}
+
+// a straightforward 2x2 box filter in double precision: odd source dimensions drop their last row/column, and 1-texel ones are
+// repeated
+static std::vector<uint8_t> __NaiveDownsample(const std::vector<uint8_t> &src, uint32_t src_w, uint32_t src_h, bool srgb) {
+    uint32_t dst_w = std::max(src_w / 2, 1u);
+    uint32_t dst_h = std::max(src_h / 2, 1u);
+    std::vector<uint8_t> dst(static_cast<size_t>(dst_w) * dst_h * 4);
+
+    for (uint32_t y = 0; y < dst_h; y++) {
+        for (uint32_t x = 0; x < dst_w; x++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                bool linearise = srgb && c < 3;
+
+                double sum = 0.0;
+                for (uint32_t sy = 0; sy < 2; sy++) {
+                    for (uint32_t sx = 0; sx < 2; sx++) {
+                        uint32_t px = std::min(x * 2 + sx, src_w - 1);
+                        uint32_t py = std::min(y * 2 + sy, src_h - 1);
+                        double v = src[(static_cast<size_t>(py) * src_w + px) * 4 + c];
+                        sum += linearise ? __SRGBToLinear(v / 255.0) : v;
+                    }
+                }
+
+                // halves round up
+                double mean = linearise ? __LinearToSRGB(sum / 4.0) * 255.0 : sum / 4.0;
+                dst[(static_cast<size_t>(y) * dst_w + x) * 4 + c] = static_cast<uint8_t>(std::lround(mean));
+            }
+        }
+    }
+    return dst;
+}
+
+// level count, extents, and tight packing of the levels
+static void __CheckLayout(uint32_t width, uint32_t height, uint32_t expected_levels) {
+    MCVK_CHECK(ResourceMgr::GetMipLevelCount(width, height) == expected_levels);
+
+    std::vector<uint8_t> rgba = __RandomImage(width, height, 0);
+    ResourceMgr::MipChain chain = ResourceMgr::GenerateMipChain(rgba.data(), width, height, false);
+    if (!MCVK_CHECK(chain.levels.size() == expected_levels)) {
+        return;
+    }
+
+    size_t offset = 0;
+    uint32_t w = width, h = height;
+    for (const ResourceMgr::MipLevel &level : chain.levels) {
+        MCVK_CHECK(level.offset == offset);
+        MCVK_CHECK(level.width == w && level.height == h);
+
+        offset += static_cast<size_t>(w) * h * 4;
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+    MCVK_CHECK(chain.bytes.size() == offset);
+
+    const ResourceMgr::MipLevel &last = chain.levels.back();
+    MCVK_CHECK(last.width == 1 && last.height == 1);
+    MCVK_CHECK(std::equal(rgba.begin(), rgba.end(), chain.bytes.begin()));
+}
+
+// every level against the naive filter applied to the generated level above it; linear averaging rounds exactly, while sRGB may
+// be a step off from float precision and the lookup table
+static void __CheckAgainstNaive(uint32_t width, uint32_t height, bool srgb, uint64_t seed) {
+    std::vector<uint8_t> rgba = __RandomImage(width, height, seed);
+    ResourceMgr::MipChain chain = ResourceMgr::GenerateMipChain(rgba.data(), width, height, srgb);
+    int tolerance = srgb ? 1 : 0;
+
+    for (size_t i = 1; i < chain.levels.size(); i++) {
+        const ResourceMgr::MipLevel &src = chain.levels[i - 1];
+        const ResourceMgr::MipLevel &dst = chain.levels[i];
+
+        std::vector<uint8_t> src_bytes(chain.bytes.begin() + src.offset,
+            chain.bytes.begin() + src.offset + static_cast<size_t>(src.width) * src.height * 4);
+        std::vector<uint8_t> expected = __NaiveDownsample(src_bytes, src.width, src.height, srgb);
+
+        for (size_t b = 0; b < expected.size(); b++) {
+            if (!MCVK_CHECK(std::abs(chain.bytes[dst.offset + b] - expected[b]) <= tolerance)) {
+                std::fprintf(stderr, "  %ux%u %s, level %zu, byte %zu: got %u, expected %u\n", width, height, srgb ? "sRGB" : "linear",
+                    i, b, chain.bytes[dst.offset + b], expected[b]);
+                return;
+            }
+        }
+    }
+}
+
+// a black and white checkerboard averages to mid-grey; in sRGB that is linear 0.5 (188), not the encoded midpoint (128), while
+// alpha is averaged linearly either way
+static void __CheckSRGBAveraging() {
+    std::vector<uint8_t> rgba = {
+        0, 0, 0, 0,          255, 255, 255, 255,
+        255, 255, 255, 255,  0, 0, 0, 0,
+    };
+
+    ResourceMgr::MipChain linear = ResourceMgr::GenerateMipChain(rgba.data(), 2, 2, false);
+    ResourceMgr::MipChain srgb = ResourceMgr::GenerateMipChain(rgba.data(), 2, 2, true);
+    const uint8_t *l = linear.bytes.data() + linear.levels[1].offset;
+    const uint8_t *s = srgb.bytes.data() + srgb.levels[1].offset;
+
+    for (uint32_t c = 0; c < 3; c++) {
+        MCVK_CHECK(l[c] == 128);
+        MCVK_CHECK(s[c] == 188);
+    }
+    MCVK_CHECK(l[3] == 128);
+    MCVK_CHECK(s[3] == 128);
+}
+
+// a 1-texel-wide column only averages vertically, and an odd width drops its last column
+static void __CheckEdges() {
+    std::vector<uint8_t> column(1 * 4 * 4);
+    for (uint32_t y = 0; y < 4; y++) {
+        std::fill_n(column.begin() + y * 4, 4, static_cast<uint8_t>(y * 40));
+    }
+    ResourceMgr::MipChain chain = ResourceMgr::GenerateMipChain(column.data(), 1, 4, false);
+    if (MCVK_CHECK(chain.levels.size() == 3)) {
+        const uint8_t *l1 = chain.bytes.data() + chain.levels[1].offset;
+        const uint8_t *l2 = chain.bytes.data() + chain.levels[2].offset;
+        MCVK_CHECK(l1[0] == 20 && l1[4] == 100);
+        MCVK_CHECK(l2[0] == 60);
+    }
+
+    std::vector<uint8_t> row(3 * 1 * 4);
+    std::fill_n(row.begin(), 4, 10);
+    std::fill_n(row.begin() + 4, 4, 30);
+    std::fill_n(row.begin() + 8, 4, 255);
+    chain = ResourceMgr::GenerateMipChain(row.data(), 3, 1, false);
+    if (MCVK_CHECK(chain.levels.size() == 2)) {
+        MCVK_CHECK(chain.bytes[chain.levels[1].offset] == 20);
+    }
+}
+
+int main() {
+    __CheckLayout(1, 1, 1);
+    __CheckLayout(2, 2, 2);
+    __CheckLayout(64, 64, 7);
+    __CheckLayout(5, 3, 3);
+    __CheckLayout(1, 7, 3);
+    __CheckLayout(9, 1, 4);
+    __CheckLayout(300, 17, 9);
+
+    __CheckSRGBAveraging();
+    __CheckEdges();
+
+    uint64_t seed = 1;
+    for (auto [w, h] : { std::pair{ 64u, 64u }, { 7u, 5u }, { 1u, 13u }, { 33u, 1u }, { 129u, 66u } }) {
+        __CheckAgainstNaive(w, h, false, seed++);
+        __CheckAgainstNaive(w, h, true, seed++);
+    }
+
+    return Tests::Finish("mipmap");
+}
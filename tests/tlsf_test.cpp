@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2024 Jack Bennett.
+ * All Rights Reserved.
+ *
+ * See the LICENCE file for more information.
+ */
+
+#include "harness.hpp"
+
+#include "renderer/memory/tlsf.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace mcvk;
+using Renderer::TLSFMetadata;
+
+struct __Allocation {
+    uint32_t handle;
+    uint64_t offset;
+};
+
+// live allocations (offset -> size), as the reference the allocator is checked against
+using __Model = std::map<uint64_t, uint64_t>;
+
+static uint64_t __RandomSize(std::mt19937_64 &rng, uint64_t max_size) {
+    // mostly small sizes, with the occasional one large enough to fail once the range is fragmented; 0 is allowed and counts as 1
+    switch (rng() % 8) {
+        case 0:
+            return rng() % (max_size + 1);
+        case 1:
+        case 2:
+            return rng() % std::min<uint64_t>(max_size / 16 + 1, 65536);
+        default:
+            return rng() % std::min<uint64_t>(max_size, 256);
+    }
+}
+
+static uint64_t __RandomAlignment(std::mt19937_64 &rng) {
+    return 1ull << (rng() % 13);
+}
+
+// free regions are coalesced as soon as they meet, so the allocator's free regions must be exactly the gaps between live
+// allocations
+static bool __CheckAgainstModel(const TLSFMetadata &tlsf, const __Model &live) {
+    uint64_t used = 0;
+    uint32_t gaps = 0;
+    uint64_t largest_gap = 0;
+
+    uint64_t end = 0;
+    for (auto &[offset, size] : live) {
+        if (offset > end) {
+            gaps++;
+            largest_gap = std::max(largest_gap, offset - end);
+        }
+        used += size;
+        end = offset + size;
+    }
+    if (tlsf.GetSize() > end) {
+        gaps++;
+        largest_gap = std::max(largest_gap, tlsf.GetSize() - end);
+    }
+
+    return MCVK_CHECK(tlsf.GetUsedSize() == used) &&
+        MCVK_CHECK(tlsf.GetAllocationCount() == live.size()) &&
+        MCVK_CHECK(tlsf.GetFreeRegionCount() == gaps) &&
+        MCVK_CHECK(tlsf.GetLargestFreeRegion() == largest_gap);
+}
+
+static uint64_t __GetLargestGap(const TLSFMetadata &tlsf, const __Model &live) {
+    uint64_t largest = 0;
+    uint64_t end = 0;
+    for (auto &[offset, size] : live) {
+        largest = std::max(largest, offset - end);
+        end = offset + size;
+    }
+    return std::max(largest, tlsf.GetSize() - end);
+}
+
+// the new allocation must be aligned, inside the range, and clear of its neighbours
+static bool __CheckPlacement(const TLSFMetadata &tlsf, const __Model &live, uint64_t offset, uint64_t size, uint64_t alignment) {
+    if (!MCVK_CHECK(offset % alignment == 0) || !MCVK_CHECK(offset + size <= tlsf.GetSize())) {
+        return false;
+    }
+
+    auto next = live.lower_bound(offset);
+    if (next != live.end() && !MCVK_CHECK(offset + size <= next->first)) {
+        return false;
+    }
+    if (next != live.begin()) {
+        auto prev = std::prev(next);
+        if (!MCVK_CHECK(prev->first + prev->second <= offset)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// random allocations and frees, checking every placement and regularly comparing the free regions against the model; once done,
+// everything is freed and the range must coalesce back into a single free region
+static void __Fuzz(uint64_t capacity, uint32_t ops, uint64_t seed) {
+    TLSFMetadata tlsf{capacity};
+    std::mt19937_64 rng{seed};
+
+    std::vector<__Allocation> allocations;
+    __Model live;
+
+    for (uint32_t op = 0; op < ops; op++) {
+        // slightly favour allocation, so that the range fills up and allocations start failing
+        if (allocations.empty() || rng() % 100 < 55) {
+            uint64_t size = __RandomSize(rng, capacity / 8);
+            uint64_t alignment = __RandomAlignment(rng);
+
+            uint64_t offset;
+            uint32_t handle = tlsf.Allocate(size, alignment, &offset);
+            if (handle == TLSFMetadata::NULL_HANDLE) {
+                // TLSF only looks in lists guaranteed to fit, so it can fail with a barely large enough region free, but never
+                // with one comfortably larger than the request
+                if (!MCVK_CHECK(__GetLargestGap(tlsf, live) < 2 * (size + alignment))) {
+                    return;
+                }
+                continue;
+            }
+
+            size = std::max<uint64_t>(size, 1);
+            if (!__CheckPlacement(tlsf, live, offset, size, alignment)) {
+                return;
+            }
+            live.emplace(offset, size);
+            allocations.push_back({ handle, offset });
+        } else {
+            size_t i = rng() % allocations.size();
+            tlsf.Free(allocations[i].handle);
+            live.erase(allocations[i].offset);
+
+            allocations[i] = allocations.back();
+            allocations.pop_back();
+        }
+
+        if (op % 16 == 0 && !__CheckAgainstModel(tlsf, live)) {
+            return;
+        }
+    }
+
+    std::shuffle(allocations.begin(), allocations.end(), rng);
+    for (const __Allocation &a : allocations) {
+        tlsf.Free(a.handle);
+    }
+
+    MCVK_CHECK(tlsf.IsEmpty());
+    MCVK_CHECK(tlsf.GetUsedSize() == 0);
+    MCVK_CHECK(tlsf.GetFreeRegionCount() == 1);
+    MCVK_CHECK(tlsf.GetLargestFreeRegion() == capacity);
+}
+
+// fills a large range with a batch of allocations, frees a random half and allocates into the holes, then frees everything,
+// timing only the allocator calls
+static void __Benchmark(uint32_t rounds, uint32_t batch) {
+    TLSFMetadata tlsf{1ull << 30};
+    std::mt19937_64 rng{0};
+
+    std::vector<uint64_t> sizes(batch);
+    std::vector<uint64_t> alignments(batch);
+    for (uint32_t i = 0; i < batch; i++) {
+        sizes[i] = 1 + __RandomSize(rng, 1ull << 20);
+        alignments[i] = __RandomAlignment(rng);
+    }
+    std::vector<uint32_t> handles(batch);
+
+    Tests::Timer alloc_timer;
+    Tests::Timer free_timer;
+    uint64_t allocs = 0;
+    uint64_t frees = 0;
+
+    auto allocate = [&](uint32_t begin, uint32_t end) {
+        uint64_t offset;
+        alloc_timer.Start();
+        for (uint32_t i = begin; i < end; i++) {
+            handles[i] = tlsf.Allocate(sizes[i], alignments[i], &offset);
+        }
+        alloc_timer.Stop();
+        allocs += end - begin;
+    };
+    auto release = [&](uint32_t begin, uint32_t end) {
+        free_timer.Start();
+        for (uint32_t i = begin; i < end; i++) {
+            if (handles[i] != TLSFMetadata::NULL_HANDLE) {
+                tlsf.Free(handles[i]);
+            }
+        }
+        free_timer.Stop();
+        frees += end - begin;
+    };
+
+    for (uint32_t r = 0; r < rounds; r++) {
+        allocate(0, batch);
+
+        // sizes and alignments are shuffled along with the handles, so the refill doesn't simply reuse each hole as it was
+        for (uint32_t i = batch - 1; i > 0; i--) {
+            uint32_t j = static_cast<uint32_t>(rng() % (i + 1));
+            std::swap(handles[i], handles[j]);
+            std::swap(sizes[i], sizes[j]);
+            std::swap(alignments[i], alignments[j]);
+        }
+        release(0, batch / 2);
+        allocate(0, batch / 2);
+        release(0, batch);
+    }
+
+    MCVK_CHECK(tlsf.IsEmpty());
+
+    std::printf("tlsf: %.2f million allocations/s, %.2f million frees/s (%u rounds of %u)\n",
+        allocs / alloc_timer.GetSeconds() / 1e6, frees / free_timer.GetSeconds() / 1e6, rounds, batch);
+}
+
+int main() {
+    // small enough that most sizes land in the first-level list of linearly mapped small sizes
+    __Fuzz(4096, 20000, 1);
+    __Fuzz(1ull << 20, 200000, 2);
+    __Fuzz(1ull << 32, 200000, 3);
+
+    __Benchmark(64, 16384);
+
+    return Tests::Finish("tlsf");
+}